@@ -0,0 +1,405 @@
+#ifndef PACKED_STRING_BENCH_H
+#define PACKED_STRING_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "perf.h"
+#include "workload.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Shared benchmark driver.
+//
+// A phase loop is timed in batches of BENCH_BATCH operations against a
+// monotonic clock, each batch giving one ns/op sample. Warmup trials run
+// the same loops with a NULL series so nothing is recorded. Results are
+// the median and p99 over all batch samples plus the overall mean, and
+// can be printed as a text table, CSV or JSON. With -p, hardware counters
+// from perf.h are added to every row as per-op averages.
+
+#define BENCH_BATCH 1024
+
+typedef enum {
+  BENCH_TEXT,
+  BENCH_CSV,
+  BENCH_JSON
+} bench_format;
+
+typedef enum {
+  BENCH_DIST_UNIFORM,   // length 1-20, uniform
+  BENCH_DIST_SHORT,     // length 1-8
+  BENCH_DIST_LONG,      // length 12-20
+  BENCH_DIST_IDENT,     // realistic identifiers, see workload.h
+  BENCH_DIST_FIXED      // every key has fixed_len chars
+} bench_dist;
+
+typedef struct {
+  size_t       n;          // keys per phase
+  unsigned     trials;     // measured trials
+  unsigned     warmup;     // discarded trials before them
+  double       load;       // target table load factor, see bench_load
+  bench_dist   dist;
+  unsigned     fixed_len;  // for BENCH_DIST_FIXED
+  bench_format format;
+  uint64_t     seed;
+  const char*  label;      // free-form tag, e.g. a commit hash
+  bool         perf;       // report hardware counters
+  double       zipf;       // lookup skew, 0 = every key once in order
+  const char*  keys_file;  // newline-delimited identifiers instead of generated keys
+} bench_config;
+
+typedef struct {
+  double*  samples;        // ns/op per batch
+  size_t   count;
+  size_t   capacity;
+  uint64_t total_ns;
+  size_t   total_ops;
+} bench_series;
+
+typedef struct {
+  double median;
+  double p99;
+  double mean;
+  double min;
+  size_t samples;
+} bench_stats;
+
+static inline uint64_t bench_now_ns(void) {
+#if defined(_WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER t;
+  if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Keeps a computed value alive without a volatile store in the hot loop
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_KEEP(x) __asm__ volatile("" : : "g"(x) : "memory")
+#else
+static volatile uint64_t bench_sink;
+#define BENCH_KEEP(x) (bench_sink += (uint64_t)(x))
+#endif
+
+// Time body for every i in [0, n), one sample per batch; s may be NULL
+#define BENCH_LOOP(s, n, i, body)                                          \
+  for (size_t bench_b_ = 0; bench_b_ < (n); bench_b_ += BENCH_BATCH) {     \
+    const size_t bench_e_ =                                                \
+      (n) - bench_b_ < BENCH_BATCH ? (n) : bench_b_ + BENCH_BATCH;         \
+    const uint64_t bench_t_ = bench_now_ns();                              \
+    for (size_t i = bench_b_; i < bench_e_; i++) { body; }                 \
+    bench_record((s), bench_now_ns() - bench_t_, bench_e_ - bench_b_);     \
+  }
+
+static inline void bench_series_free(bench_series* s) {
+  free(s->samples);
+  memset(s, 0, sizeof(*s));
+}
+
+static inline void bench_record(bench_series* s, const uint64_t ns, const size_t ops) {
+  if (!s || ops == 0) return;
+
+  if (s->count == s->capacity) {
+    const size_t cap = s->capacity ? s->capacity * 2 : 256;
+    double* samples = (double*)realloc(s->samples, cap * sizeof(double));
+    if (!samples) return;
+
+    s->samples = samples;
+    s->capacity = cap;
+  }
+
+  s->samples[s->count++] = (double)ns / (double)ops;
+  s->total_ns += ns;
+  s->total_ops += ops;
+}
+
+static inline int bench_compare_double(const void* a, const void* b) {
+  const double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+// Sorts the samples in place
+static inline bench_stats bench_summarize(bench_series* s) {
+  bench_stats r = {0};
+  if (s->count == 0) return r;
+
+  qsort(s->samples, s->count, sizeof(double), bench_compare_double);
+
+  r.samples = s->count;
+  r.min = s->samples[0];
+  r.median = s->samples[s->count / 2];
+  r.p99 = s->samples[s->count * 99 / 100];
+  r.mean = (double)s->total_ns / (double)s->total_ops;
+  return r;
+}
+
+// =========================
+// KEYS
+// =========================
+
+static inline unsigned bench_length(const bench_config* c, uint64_t* rng) {
+  switch (c->dist) {
+    case BENCH_DIST_SHORT: return 1 + (unsigned)(bench_rng(rng) % 8);
+    case BENCH_DIST_LONG:  return 12 + (unsigned)(bench_rng(rng) % 9);
+    case BENCH_DIST_FIXED: return c->fixed_len;
+    default: return 1 + (unsigned)(bench_rng(rng) % 20);
+  }
+}
+
+// Writes a NUL-terminated random key of the configured distribution
+static inline void bench_random_key(const bench_config* c, uint64_t* rng, char out[21]) {
+  if (c->dist == BENCH_DIST_IDENT) {
+    bench_identifier(rng, out);
+    return;
+  }
+
+  const unsigned len = bench_length(c, rng);
+  for (unsigned i = 0; i < len; i++)
+    out[i] = BENCH_ALPHABET[bench_rng(rng) & 63];
+  out[len] = '\0';
+}
+
+static inline const char* bench_dist_name(const bench_config* c) {
+  if (c->keys_file) return "file";
+  switch (c->dist) {
+    case BENCH_DIST_SHORT: return "short";
+    case BENCH_DIST_LONG:  return "long";
+    case BENCH_DIST_IDENT: return "ident";
+    case BENCH_DIST_FIXED: return "fixed";
+    default:               return "uniform";
+  }
+}
+
+// =========================
+// COMMAND LINE
+// =========================
+
+static inline void bench_usage(const char* prog) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  -n N            keys per phase (default 1000000)\n"
+    "  -t TRIALS       measured trials (default 5)\n"
+    "  -w WARMUP       warmup trials (default 1)\n"
+    "  -l LOAD         max table load factor, 0 < LOAD <= 0.5 (default 0.5);\n"
+    "                  capacity rounds up to a power of two, the report\n"
+    "                  shows the load it gives\n"
+    "  -d DIST         uniform, short, long, ident or fixed:LEN (default uniform)\n"
+    "  -s SEED         key generator seed\n"
+    "  -f FORMAT       text, csv or json (default text)\n"
+    "  -z THETA        Zipfian lookups with skew 0 < THETA < 1, e.g. 0.99\n"
+    "  -i FILE         use the identifiers in FILE, one per line (at most N)\n"
+    "  -L LABEL        tag copied to every output row\n"
+    "  -p              add hardware counters per op (Linux perf_event_open)\n", prog);
+}
+
+static inline bool bench_parse_dist(bench_config* c, const char* s) {
+  if (strcmp(s, "uniform") == 0) c->dist = BENCH_DIST_UNIFORM;
+  else if (strcmp(s, "short") == 0) c->dist = BENCH_DIST_SHORT;
+  else if (strcmp(s, "long") == 0) c->dist = BENCH_DIST_LONG;
+  else if (strcmp(s, "ident") == 0) c->dist = BENCH_DIST_IDENT;
+  else if (strncmp(s, "fixed:", 6) == 0) {
+    c->dist = BENCH_DIST_FIXED;
+    c->fixed_len = (unsigned)strtoul(s + 6, NULL, 10);
+    return c->fixed_len >= 1 && c->fixed_len <= 20;
+  }
+  else return false;
+  return true;
+}
+
+// Fills c with defaults and applies argv, false on a bad option
+static inline bool bench_parse_args(bench_config* c, const int argc, char** argv) {
+  c->n = 1000000;
+  c->trials = 5;
+  c->warmup = 1;
+  c->load = 0.5;
+  c->dist = BENCH_DIST_UNIFORM;
+  c->fixed_len = 0;
+  c->format = BENCH_TEXT;
+  c->seed = 0x9E3779B97F4A7C15ULL;
+  c->label = "";
+  c->perf = false;
+  c->zipf = 0.0;
+  c->keys_file = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    const char* opt = argv[i];
+    const char* val = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (strcmp(opt, "-p") == 0) {
+      c->perf = true;
+      continue;
+    }
+
+    if (opt[0] != '-' || opt[1] == '\0' || opt[2] != '\0' || !val) {
+      bench_usage(argv[0]);
+      return false;
+    }
+    i++;
+
+    switch (opt[1]) {
+      case 'n': c->n = strtoull(val, NULL, 10); break;
+      case 't': c->trials = (unsigned)strtoul(val, NULL, 10); break;
+      case 'w': c->warmup = (unsigned)strtoul(val, NULL, 10); break;
+      case 'l': c->load = strtod(val, NULL); break;
+      case 's': c->seed = strtoull(val, NULL, 0) | 1; break;
+      case 'L': c->label = val; break;
+      case 'z': c->zipf = strtod(val, NULL); break;
+      case 'i': c->keys_file = val; break;
+      case 'd':
+        if (!bench_parse_dist(c, val)) {
+          bench_usage(argv[0]);
+          return false;
+        }
+        break;
+      case 'f':
+        if (strcmp(val, "text") == 0) c->format = BENCH_TEXT;
+        else if (strcmp(val, "csv") == 0) c->format = BENCH_CSV;
+        else if (strcmp(val, "json") == 0) c->format = BENCH_JSON;
+        else {
+          bench_usage(argv[0]);
+          return false;
+        }
+        break;
+      default:
+        bench_usage(argv[0]);
+        return false;
+    }
+  }
+
+  if (c->n == 0 || c->trials == 0 || !(c->load > 0.0 && c->load <= 0.5) ||
+      !(c->zipf == 0.0 || (c->zipf > 0.0 && c->zipf < 1.0))) {
+    bench_usage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+// Smallest power of two holding n keys at the configured load
+static inline size_t bench_capacity(const bench_config* c) {
+  size_t cap = 1;
+  while ((double)cap * c->load < (double)c->n) cap <<= 1;
+  return cap;
+}
+
+// Load the tables really run at: n over the rounded-up capacity, at most
+// c->load. This is what the report prints.
+static inline double bench_load(const bench_config* c) {
+  return (double)c->n / (double)bench_capacity(c);
+}
+
+// =========================
+// REPORT
+// =========================
+
+typedef struct {
+  const bench_config* config;
+  size_t rows;
+} bench_report;
+
+static inline void bench_report_begin(bench_report* r, const bench_config* c) {
+  r->config = c;
+  r->rows = 0;
+
+  switch (c->format) {
+    case BENCH_CSV:
+      printf("label,impl,phase,n,load,dist,zipf,trials,samples,median_ns,p99_ns,mean_ns,min_ns");
+      for (int e = 0; c->perf && e < BENCH_PERF_EVENTS; e++) printf(",%s", BENCH_PERF_NAMES[e]);
+      printf("\n");
+      break;
+    case BENCH_JSON:
+      printf("{\"label\":\"%s\",\"n\":%zu,\"load\":%.3f,\"target_load\":%.3f,\"dist\":\"%s\","
+        "\"fixed_len\":%u,\"zipf\":%.3f,\"trials\":%u,\"warmup\":%u,\"results\":[", c->label, c->n,
+        bench_load(c), c->load, bench_dist_name(c), c->fixed_len, c->zipf, c->trials, c->warmup);
+      break;
+    default:
+      printf("N = %zu, load %.3f (-l %.3f), %s keys", c->n, bench_load(c), c->load, bench_dist_name(c));
+      if (c->zipf > 0.0) printf(", zipf %.2f", c->zipf);
+      printf(", %u trials (+%u warmup)\n\n", c->trials, c->warmup);
+      printf("%-14s %-16s %11s %10s %10s %10s", "impl", "phase", "median", "p99", "mean", "min");
+      if (c->perf) printf(" %8s %5s %6s %6s %6s %6s", "cycles", "IPC", "L1D", "LLC", "branch", "dTLB");
+      printf("\n");
+      break;
+  }
+}
+
+// Counter columns of a row, per op; unavailable counters are left empty
+static inline void bench_report_counters(const bench_config* c, const bench_counters* pc, const size_t ops) {
+  for (int e = 0; e < BENCH_PERF_EVENTS; e++) {
+    const bool valid = pc && pc->valid[e] && ops > 0;
+    const double v = valid ? pc->value[e] / (double)ops : 0.0;
+
+    switch (c->format) {
+      case BENCH_CSV:
+        if (valid) printf(",%.4f", v);
+        else printf(",");
+        break;
+      case BENCH_JSON:
+        if (valid) printf(",\"%s\":%.4f", BENCH_PERF_NAMES[e], v);
+        break;
+      default:
+        if (e == BENCH_PERF_INSTRUCTIONS) {
+          // Shown as instructions per cycle
+          if (valid && pc->valid[BENCH_PERF_CYCLES] && pc->value[BENCH_PERF_CYCLES] > 0)
+            printf(" %5.2f", pc->value[e] / pc->value[BENCH_PERF_CYCLES]);
+          else printf(" %5s", "-");
+        } else if (e == BENCH_PERF_CYCLES) {
+          if (valid) printf(" %8.1f", v);
+          else printf(" %8s", "-");
+        } else {
+          if (valid) printf(" %6.3f", v);
+          else printf(" %6s", "-");
+        }
+        break;
+    }
+  }
+}
+
+// One row, ns/op plus counters per op if enabled; summarizes (and sorts) s
+static inline void bench_report_row_counters(bench_report* r, const char* impl, const char* phase,
+  bench_series* s, const bench_counters* pc) {
+  const bench_config* c = r->config;
+  const bench_stats st = bench_summarize(s);
+
+  switch (c->format) {
+    case BENCH_CSV:
+      printf("%s,%s,%s,%zu,%.3f,%s,%.3f,%u,%zu,%.2f,%.2f,%.2f,%.2f", c->label, impl, phase,
+        c->n, bench_load(c), bench_dist_name(c), c->zipf, c->trials, st.samples, st.median, st.p99, st.mean, st.min);
+      break;
+    case BENCH_JSON:
+      printf("%s\n  {\"impl\":\"%s\",\"phase\":\"%s\",\"samples\":%zu,\"median_ns\":%.2f,"
+        "\"p99_ns\":%.2f,\"mean_ns\":%.2f,\"min_ns\":%.2f", r->rows ? "," : "",
+        impl, phase, st.samples, st.median, st.p99, st.mean, st.min);
+      break;
+    default:
+      printf("%-14s %-16s %8.1f ns %7.1f ns %7.1f ns %7.1f ns",
+        impl, phase, st.median, st.p99, st.mean, st.min);
+      break;
+  }
+
+  if (c->perf) bench_report_counters(c, pc, s->total_ops);
+  printf(c->format == BENCH_JSON ? "}" : "\n");
+  r->rows++;
+}
+
+static inline void bench_report_row(bench_report* r, const char* impl, const char* phase, bench_series* s) {
+  bench_report_row_counters(r, impl, phase, s, NULL);
+}
+
+static inline void bench_report_end(bench_report* r) {
+  if (r->config->format == BENCH_JSON) printf("\n]}\n");
+}
+
+#endif // PACKED_STRING_BENCH_H
@@ -0,0 +1,146 @@
+#ifndef PACKED_STRING_BENCH_PERF_H
+#define PACKED_STRING_BENCH_PERF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters around benchmark phases through perf_event_open.
+//
+// All events are opened as one group led by cycles, user space only, so
+// they count over the same interval. Events the machine or the
+// perf_event_paranoid setting refuses are left out; if the leader itself
+// cannot be opened (no PMU, containers, non-Linux) every call is a no-op
+// and bench_perf_available() reports false.
+
+enum {
+  BENCH_PERF_CYCLES,
+  BENCH_PERF_INSTRUCTIONS,
+  BENCH_PERF_L1D_MISSES,
+  BENCH_PERF_LLC_MISSES,
+  BENCH_PERF_BRANCH_MISSES,
+  BENCH_PERF_DTLB_MISSES,
+  BENCH_PERF_EVENTS
+};
+
+static const char* const BENCH_PERF_NAMES[BENCH_PERF_EVENTS] = {
+  "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+};
+
+typedef struct {
+  double   value[BENCH_PERF_EVENTS];   // scaled totals
+  bool     valid[BENCH_PERF_EVENTS];
+  uint64_t runs;                       // start/stop pairs added
+} bench_counters;
+
+typedef struct {
+  int      fd[BENCH_PERF_EVENTS];      // -1 if not opened
+  int      slot[BENCH_PERF_EVENTS];    // position in the group read
+  int      opened;
+} bench_perf;
+
+static inline bool bench_perf_available(const bench_perf* p) {
+  return p->opened > 0;
+}
+
+#if defined(__linux__)
+
+static inline int bench_perf_open_event(const uint32_t type, const uint64_t config, const int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static inline void bench_perf_open(bench_perf* p) {
+  static const struct { uint32_t type; uint64_t config; } events[BENCH_PERF_EVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+  };
+
+  p->opened = 0;
+  for (int e = 0; e < BENCH_PERF_EVENTS; e++) {
+    p->fd[e] = -1;
+    p->slot[e] = -1;
+  }
+
+  p->fd[0] = bench_perf_open_event(events[0].type, events[0].config, -1);
+  if (p->fd[0] < 0) return;
+  p->slot[0] = p->opened++;
+
+  for (int e = 1; e < BENCH_PERF_EVENTS; e++) {
+    p->fd[e] = bench_perf_open_event(events[e].type, events[e].config, p->fd[0]);
+    if (p->fd[e] >= 0) p->slot[e] = p->opened++;
+  }
+}
+
+static inline void bench_perf_close(bench_perf* p) {
+  for (int e = 0; e < BENCH_PERF_EVENTS; e++) {
+    if (p->fd[e] >= 0) close(p->fd[e]);
+    p->fd[e] = -1;
+  }
+  p->opened = 0;
+}
+
+static inline void bench_perf_start(const bench_perf* p) {
+  if (!bench_perf_available(p)) return;
+  ioctl(p->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(p->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Adds the counts since bench_perf_start to c, scaled up if the group was multiplexed
+static inline void bench_perf_stop(const bench_perf* p, bench_counters* c) {
+  if (!bench_perf_available(p)) return;
+  ioctl(p->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  if (!c) return;
+
+  uint64_t data[3 + BENCH_PERF_EVENTS];   // nr, time_enabled, time_running, values
+  if (read(p->fd[0], data, sizeof(data)) < (ssize_t)(3 * sizeof(uint64_t))) return;
+  if (data[2] == 0) return;
+
+  const double scale = (double)data[1] / (double)data[2];
+  for (int e = 0; e < BENCH_PERF_EVENTS; e++) {
+    if (p->slot[e] < 0 || (uint64_t)p->slot[e] >= data[0]) continue;
+    c->value[e] += (double)data[3 + p->slot[e]] * scale;
+    c->valid[e] = true;
+  }
+  c->runs++;
+}
+
+#else
+
+static inline void bench_perf_open(bench_perf* p) {
+  for (int e = 0; e < BENCH_PERF_EVENTS; e++) {
+    p->fd[e] = -1;
+    p->slot[e] = -1;
+  }
+  p->opened = 0;
+}
+
+static inline void bench_perf_close(bench_perf* p) { p->opened = 0; }
+static inline void bench_perf_start(const bench_perf* p) { (void)p; }
+static inline void bench_perf_stop(const bench_perf* p, bench_counters* c) { (void)p; (void)c; }
+
+#endif
+
+#endif // PACKED_STRING_BENCH_PERF_H
@@ -0,0 +1,179 @@
+#include "../packed16/packed-string.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Usage: ps-codec [bench options]
+//
+// Encodes N keys with ps_encode_many and times encoding and decoding in
+// batches of BENCH_BATCH records, ns per record. Decoding runs on every
+// dispatch tier the CPU has. The text report ends with the stream size
+// against 16 bytes per string and the decode rate in GB/s of PackedString
+// output. Exits with 1 if a round trip does not give the input back.
+
+static const char* const PHASE_NAMES[] = { "encode", "decode" };
+
+// Record offset of every batch start, plus the stream end
+static size_t* batch_offsets(const ps_t* pss, const size_t n, size_t* batches) {
+    *batches = (n + BENCH_BATCH - 1) / BENCH_BATCH;
+    size_t* offsets = malloc((*batches + 1) * sizeof(size_t));
+    if (!offsets) return NULL;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i % BENCH_BATCH == 0) offsets[i / BENCH_BATCH] = pos;
+        pos += ps_encoded_size(pss[i]);
+    }
+    offsets[*batches] = pos;
+    return offsets;
+}
+
+static void run_encode(bench_series* s, const ps_t* pss, const size_t n, const size_t* offsets,
+    u8* buf) {
+    for (size_t b = 0; b * BENCH_BATCH < n; b++) {
+        const size_t first = b * BENCH_BATCH;
+        const size_t count = n - first < BENCH_BATCH ? n - first : BENCH_BATCH;
+
+        const uint64_t t = bench_now_ns();
+        BENCH_KEEP(ps_encode_many(pss + first, count, buf + offsets[b]));
+        bench_record(s, bench_now_ns() - t, count);
+    }
+}
+
+static bool run_decode(bench_series* s, const u8* buf, const size_t n, const size_t* offsets,
+    ps_t* out) {
+    bool ok = true;
+
+    for (size_t b = 0; b * BENCH_BATCH < n; b++) {
+        const size_t first = b * BENCH_BATCH;
+        const size_t count = n - first < BENCH_BATCH ? n - first : BENCH_BATCH;
+        const size_t len = offsets[b + 1] - offsets[b];
+        size_t consumed = 0;
+
+        const uint64_t t = bench_now_ns();
+        const size_t got = ps_decode_many(buf + offsets[b], len, out + first, count, &consumed);
+        bench_record(s, bench_now_ns() - t, count);
+
+        ok &= got == count && consumed == len;
+    }
+    return ok;
+}
+
+int main(const int argc, char** argv) {
+    bench_config cfg;
+    if (!bench_parse_args(&cfg, argc, argv)) return 1;
+
+    char** file_keys = NULL;
+    size_t loaded = 0;
+    if (cfg.keys_file) {
+        size_t skipped = 0;
+        file_keys = bench_load_lines(cfg.keys_file, &loaded, &skipped);
+        if (!file_keys || loaded == 0) {
+            fprintf(stderr, "no usable identifiers in %s\n", cfg.keys_file);
+            return 1;
+        }
+        if (skipped)
+            fprintf(stderr, "note: skipped %zu lines that do not fit a PackedString\n", skipped);
+        if (loaded < cfg.n) cfg.n = loaded;
+    }
+
+    const size_t n = cfg.n;
+    uint64_t rng = cfg.seed;
+
+    ps_t* pss = malloc(n * sizeof(ps_t));
+    ps_t* decoded = malloc(n * sizeof(ps_t));
+    u8* buf = malloc(n * PS_ENCODED_MAX);
+    if (!pss || !decoded || !buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        char key[PACKED_STRING_MAX_LEN + 1];
+        if (file_keys) pss[i] = ps_pack(file_keys[i]);
+        else {
+            bench_random_key(&cfg, &rng, key);
+            pss[i] = ps_pack(key);
+        }
+    }
+
+    size_t batches = 0;
+    size_t* offsets = batch_offsets(pss, n, &batches);
+    if (!offsets) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    const size_t bytes = offsets[batches];
+
+    // =========================
+    // RUN
+    // =========================
+
+    const PsTier tier = ps_tier();
+    const unsigned tiers = (unsigned)ps_cpu_tier() + 1;
+
+    bench_series encode = {0};
+    bench_series* decode = calloc(tiers, sizeof(bench_series));
+    if (!decode) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    bool ok = true;
+    for (unsigned trial = 0; trial < cfg.warmup + cfg.trials; ++trial) {
+        const bool measure = trial >= cfg.warmup;
+        run_encode(measure ? &encode : NULL, pss, n, offsets, buf);
+
+        for (unsigned t = 0; t < tiers; t++) {
+            ps_set_tier((PsTier)t);
+            memset(decoded, 0, n * sizeof(ps_t));
+            ok &= run_decode(measure ? &decode[t] : NULL, buf, n, offsets, decoded);
+            ok &= memcmp(decoded, pss, n * sizeof(ps_t)) == 0;
+        }
+        ps_set_tier(tier);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "round trip mismatch\n");
+        return 1;
+    }
+
+    // =========================
+    // REPORT
+    // =========================
+
+    double decode_mean[PS_TIER_COUNT] = {0};
+    for (unsigned t = 0; t < tiers; t++)
+        decode_mean[t] = decode[t].total_ops ? (double)decode[t].total_ns / (double)decode[t].total_ops : 0.0;
+
+    bench_report report;
+    bench_report_begin(&report, &cfg);
+    bench_report_row(&report, ps_tier_name(tier), PHASE_NAMES[0], &encode);
+    for (unsigned t = 0; t < tiers; t++)
+        bench_report_row(&report, ps_tier_name((PsTier)t), PHASE_NAMES[1], &decode[t]);
+    bench_report_end(&report);
+
+    if (cfg.format == BENCH_TEXT) {
+        const size_t raw = n * sizeof(ps_t);
+        printf("\n%zu bytes encoded, %zu as PackedString[], %.1f%% saved, %.2f bytes/string\n",
+            bytes, raw, 100.0 * (1.0 - (double)bytes / (double)raw), (double)bytes / (double)n);
+
+        // 16 output bytes per record, mean ns per record
+        for (unsigned t = 0; t < tiers; t++) {
+            if (decode_mean[t] > 0.0)
+                printf("decode %-8s %6.2f GB/s\n", ps_tier_name((PsTier)t), sizeof(ps_t) / decode_mean[t]);
+        }
+    }
+
+    bench_series_free(&encode);
+    for (unsigned t = 0; t < tiers; t++) bench_series_free(&decode[t]);
+    free(decode);
+    free(offsets);
+    free(buf);
+    free(decoded);
+    free(pss);
+    if (file_keys) bench_free_lines(file_keys, loaded);
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "../packed16/packed-string.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Usage: ps-micro [bench options] [-u packed16/packed-string.h]
+//
+// Times every function of the packed-string.h complexity table in ns/call
+// over randomized inputs. -u rewrites the "100x call time" column of the
+// given header in place from the median times. Rows are labelled with the
+// dispatch tier in use; run with PS_TIER=scalar (bmi2, avx2) to compare.
+
+#define INPUTS 1024   // power of two, small enough to stay in L1
+#define MASK   (INPUTS - 1)
+
+static ps_t A[INPUTS];       // random strings of the configured distribution
+static ps_t B[INPUTS];       // A itself for even k, another random string for odd k
+static ps_t W[INPUTS];       // scratch copy of A for ps_set
+static ps_t PRE[INPUTS];     // prefix of A
+static ps_t SUF[INPUTS];     // suffix of A
+static ps_t MID[INPUTS];     // substring of A at START
+static ps_t KEY[INPUTS];     // non-empty lock key
+static ps_t LOCKED[INPUTS];  // ps_lock(A, KEY)
+static char STR[INPUTS][PACKED_STRING_MAX_LEN + 1];
+static char CH[INPUTS];
+static u8   SIX[INPUTS];
+static u8   IDX[INPUTS];     // 0-19
+static u8   LEN[INPUTS];     // 0-20
+static u8   START[INPUTS];   // MID offset
+static u8   END[INPUTS];     // chars after MID
+static char BUF[1024];
+
+#define KEEP_VAL(x) BENCH_KEEP(x)
+#define KEEP_PS(x) do { const ps_t r_ = (x); BENCH_KEEP(r_.lo); BENCH_KEEP(r_.hi); } while (0)
+
+// ID, table name, result kind, call with input index k
+#define MICRO_LIST(X)                                                         \
+    X(1,  char,              VAL, ps_char(CH[k]))                            \
+    X(2,  six,               VAL, ps_six(SIX[k]))                            \
+    X(3,  alphabet,          VAL, ps_alphabet(CH[k]))                        \
+    X(4,  length,            VAL, ps_length(A[k]))                           \
+    X(5,  flags,             VAL, ps_flags(A[k]))                            \
+    X(6,  valid,             VAL, ps_valid(A[k]))                            \
+    X(7,  is_empty,          VAL, ps_is_empty(A[k]))                         \
+    X(8,  empty,             PS,  ps_empty())                                \
+    X(9,  form,              PS,  ps_from(A[k].lo, B[k].hi))                 \
+    X(10, make,              PS,  ps_make(A[k].lo, A[k].hi, LEN[k], SIX[k] & 7)) \
+    X(11, pack,              PS,  ps_pack(STR[k]))                           \
+    X(12, unpack,            VAL, ps_unpack(A[k], BUF))                      \
+    X(13, pack_ex,           PS,  ps_pack_ex(STR[k], ps_length(A[k]), ps_flags(A[k]))) \
+    X(14, unpack_ex,         VAL, ps_unpack_ex(A[k], BUF, ps_length(A[k]), ps_flags(A[k]))) \
+    X(15, scan,              PS,  ps_scan(A[k]))                             \
+    X(16, is_case_sensitive, VAL, ps_is_case_sensitive(A[k]))                \
+    X(17, contains_digit,    VAL, ps_contains_digit(A[k]))                   \
+    X(18, contains_special,  VAL, ps_contains_special(A[k]))                 \
+    X(19, set,               VAL, ps_set(&W[k], IDX[k], SIX[k]))             \
+    X(20, at,                VAL, ps_at(A[k], IDX[k]))                       \
+    X(21, first,             VAL, ps_first(A[k]))                            \
+    X(22, last,              VAL, ps_last(A[k]))                             \
+    X(23, equal,             VAL, ps_equal(A[k], B[k]))                      \
+    X(24, equal_nometa,      VAL, ps_equal_nometa(A[k], B[k]))               \
+    X(25, equal_nocase,      VAL, ps_equal_nocase(A[k], B[k]))               \
+    X(26, packed_compare,    VAL, ps_packed_compare(A[k], B[k]))             \
+    X(27, compare,           VAL, ps_compare(A[k], B[k]))                    \
+    X(28, starts_with,       VAL, ps_starts_with(A[k], PRE[k]))              \
+    X(29, ends_with,         VAL, ps_ends_with(A[k], SUF[k]))                \
+    X(30, starts_with_at,    VAL, ps_starts_with_at(A[k], MID[k], START[k])) \
+    X(31, ends_with_at,      VAL, ps_ends_with_at(A[k], MID[k], END[k]))     \
+    X(32, skip,              PS,  ps_skip(A[k], IDX[k]))                     \
+    X(33, trunc,             PS,  ps_trunc(A[k], IDX[k]))                    \
+    X(34, substring,         PS,  ps_substring(A[k], START[k], ps_length(MID[k]))) \
+    X(35, concat,            PS,  ps_concat(PRE[k], SUF[k]))                 \
+    X(36, to_lower,          PS,  ps_to_lower(A[k]))                         \
+    X(37, to_upper,          PS,  ps_to_upper(A[k]))                         \
+    X(38, pad_left,          PS,  ps_pad_left(A[k], SIX[k], LEN[k]))         \
+    X(39, pad_right,         PS,  ps_pad_right(A[k], SIX[k], LEN[k]))        \
+    X(40, pad_center,        PS,  ps_pad_center(A[k], SIX[k], LEN[k]))       \
+    X(41, find_six,          VAL, ps_find_six(A[k], SIX[k]))                 \
+    X(42, find_from_six,     VAL, ps_find_from_six(A[k], SIX[k], IDX[k]))    \
+    X(43, find_last_six,     VAL, ps_find_last_six(A[k], SIX[k]))            \
+    X(44, contains_six,      VAL, ps_contains_six(A[k], SIX[k]))             \
+    X(45, contains,          VAL, ps_contains(A[k], MID[k]))                 \
+    X(46, hash32,            VAL, ps_hash32(A[k]))                           \
+    X(47, hash64,            VAL, ps_hash64(A[k]))                           \
+    X(48, table_hash,        VAL, ps_table_hash(A[k]))                       \
+    X(49, lock,              PS,  ps_lock(A[k], KEY[k]))                     \
+    X(50, unlock,            PS,  ps_unlock(LOCKED[k], KEY[k]))              \
+    X(51, hex,               VAL, psd_hex(A[k], BUF))                        \
+    X(52, binary,            VAL, psd_binary(A[k], BUF))                     \
+    X(53, encoding_binary,   VAL, psd_encoding_binary(A[k], BUF))            \
+    X(54, info,              VAL, psd_info(A[k], BUF))                       \
+    X(55, visualize_bits,    VAL, psd_visualize_bits(A[k], BUF))             \
+    X(56, psd_inspect,       VAL, psd_inspect(A[k], BUF))                    \
+    X(57, psd_cstr,          VAL, psd_cstr(A[k], BUF))                       \
+    X(58, psd_warper,        VAL, psd_warper(psd_cstr, A[k]))                \
+    X(59, pack_n,            PS,  ps_pack_n(STR[k], ps_length(A[k])))
+
+#define MICRO_DEFINE(id, name, kind, call)                                    \
+    static void micro_##id(bench_series* s, const size_t n) {                 \
+        BENCH_LOOP(s, n, i, {                                                  \
+            const size_t k = i & MASK;                                         \
+            (void)k;                                                           \
+            KEEP_##kind(call);                                                 \
+        });                                                                    \
+    }
+
+MICRO_LIST(MICRO_DEFINE)
+
+typedef struct {
+    int         id;
+    const char* name;
+    void      (*run)(bench_series* s, size_t n);
+} micro;
+
+#define MICRO_ENTRY(id, name, kind, call) { id, #name, micro_##id },
+
+static const micro MICROS[] = { MICRO_LIST(MICRO_ENTRY) };
+
+#define MICRO_COUNT (sizeof(MICROS) / sizeof(*MICROS))
+
+static void make_inputs(const bench_config* cfg) {
+    uint64_t rng = cfg->seed;
+
+    for (size_t k = 0; k < INPUTS; ++k) {
+        bench_random_key(cfg, &rng, STR[k]);
+        A[k] = ps_pack(STR[k]);
+        W[k] = A[k];
+
+        char other[PACKED_STRING_MAX_LEN + 1];
+        bench_random_key(cfg, &rng, other);
+        B[k] = k & 1 ? ps_pack(other) : A[k];
+
+        const u8 len = ps_length(A[k]);
+        const u8 start = (u8)(bench_rng(&rng) % (len + 1));
+        const u8 mid = (u8)(bench_rng(&rng) % (len - start + 1));
+
+        PRE[k] = ps_trunc(A[k], (u8)(bench_rng(&rng) % (len + 1)));
+        SUF[k] = ps_skip(A[k], start);
+        MID[k] = ps_substring(A[k], start, mid);
+        START[k] = start;
+        END[k] = (u8)(len - start - mid);
+
+        KEY[k] = ps_pack(other);
+        LOCKED[k] = ps_lock(A[k], KEY[k]);
+
+        CH[k] = BENCH_ALPHABET[bench_rng(&rng) & 63];
+        SIX[k] = (u8)(bench_rng(&rng) & 63);
+        IDX[k] = (u8)(bench_rng(&rng) % PACKED_STRING_MAX_LEN);
+        LEN[k] = (u8)(bench_rng(&rng) % (PACKED_STRING_MAX_LEN + 1));
+    }
+}
+
+// =========================
+// TABLE
+// =========================
+
+static void format_row(char* out, const size_t size, const char* complexity,
+    const micro* m, const double ns_per_call) {
+    char time[32];
+    snprintf(time, sizeof(time), "%.0f ns", ns_per_call * 100.0);
+    snprintf(out, size, " * | %-4d | %-25s | %-10s | %-14s |\n", m->id, m->name, complexity, time);
+}
+
+// Complexity column of a table row, "O(?)" if the row does not parse
+static void row_complexity(const char* line, char* out, const size_t size) {
+    const char* p = line;
+    for (int bar = 0; bar < 3 && p; ++bar) p = strchr(p + 1, '|');
+
+    snprintf(out, size, "O(?)");
+    if (!p) return;
+
+    p++;
+    while (*p == ' ') p++;
+    size_t len = 0;
+    while (p[len] && p[len] != ' ' && p[len] != '|') len++;
+    if (len > 0 && len < size) {
+        memcpy(out, p, len);
+        out[len] = '\0';
+    }
+}
+
+// ID of a " * | <id> | ..." row, 0 for any other line
+static int row_id(const char* line) {
+    int id = 0;
+    return sscanf(line, " * | %d |", &id) == 1 ? id : 0;
+}
+
+static bool update_table(const char* path, const double* ns) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    fseek(in, 0, SEEK_END);
+    const long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    // Rows only ever grow by a few bytes
+    const size_t capacity = (size_t)size * 2 + 4096;
+    char* text = malloc((size_t)size + 1);
+    char* result = malloc(capacity);
+    if (!text || !result || fread(text, 1, (size_t)size, in) != (size_t)size) {
+        fclose(in);
+        free(text);
+        free(result);
+        return false;
+    }
+    fclose(in);
+    text[size] = '\0';
+
+    size_t used = 0;
+    bool in_header = true;
+    for (char* line = text; *line; ) {
+        char* eol = strchr(line, '\n');
+        const size_t len = eol ? (size_t)(eol - line) + 1 : strlen(line);
+        const int id = in_header ? row_id(line) : 0;
+
+        if (id >= 1 && id <= (int)MICRO_COUNT && MICROS[id - 1].id == id) {
+            char complexity[16], row[128];
+            row_complexity(line, complexity, sizeof(complexity));
+            format_row(row, sizeof(row), complexity, &MICROS[id - 1], ns[id - 1]);
+
+            memcpy(result + used, row, strlen(row));
+            used += strlen(row);
+        } else {
+            memcpy(result + used, line, len);
+            used += len;
+        }
+
+        // The table lives in the leading doc comment only
+        if (strncmp(line, " */", 3) == 0) in_header = false;
+        line += len;
+    }
+
+    FILE* out = fopen(path, "wb");
+    const bool ok = out && fwrite(result, 1, used, out) == used;
+    if (out) fclose(out);
+    if (!ok) fprintf(stderr, "cannot write %s\n", path);
+
+    free(text);
+    free(result);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const char* update = NULL;
+
+    // Strip -u before handing the rest to the shared parser
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) update = argv[++i];
+        else argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    bench_config cfg;
+    if (!bench_parse_args(&cfg, argc, argv)) return 1;
+
+    make_inputs(&cfg);
+
+    bench_series series[MICRO_COUNT] = {0};
+    double median[MICRO_COUNT];
+
+    for (unsigned trial = 0; trial < cfg.warmup + cfg.trials; ++trial) {
+        const bool measure = trial >= cfg.warmup;
+        for (size_t m = 0; m < MICRO_COUNT; ++m)
+            MICROS[m].run(measure ? &series[m] : NULL, cfg.n);
+    }
+
+    bench_report report;
+    bench_report_begin(&report, &cfg);
+    for (size_t m = 0; m < MICRO_COUNT; ++m) {
+        median[m] = bench_summarize(&series[m]).median;
+        bench_report_row(&report, ps_tier_name(ps_tier()), MICROS[m].name, &series[m]);
+        bench_series_free(&series[m]);
+    }
+    bench_report_end(&report);
+
+    return update && !update_table(update, median) ? 1 : 0;
+}
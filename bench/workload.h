@@ -0,0 +1,261 @@
+#ifndef PACKED_STRING_BENCH_WORKLOAD_H
+#define PACKED_STRING_BENCH_WORKLOAD_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Benchmark workloads that look like real symbol tables.
+//
+// bench_identifier builds names the way code does: camelCase and
+// snake_case word compounds, get/set/is/m_ style prefix families,
+// SCREAMING_CASE constants and short loop names, with lengths following
+// a histogram shaped like identifiers of large C, C++ and Java code
+// bases (cut at 20, the PackedString limit). bench_zipf draws key ranks
+// with the YCSB Zipfian generator, and bench_load_lines reads real
+// identifiers from a newline-delimited file.
+
+static const char BENCH_ALPHABET[] =
+  "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$";
+
+static inline uint64_t bench_rng(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+// Uniform in [0, 1)
+static inline double bench_uniform(uint64_t* rng) {
+  return (double)(bench_rng(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// =========================
+// IDENTIFIERS
+// =========================
+
+// Relative frequency of identifier lengths 1-20
+static const uint8_t BENCH_IDENT_LENGTHS[20] = {
+  4, 3, 5, 7, 8, 9, 9, 9, 8, 7, 6, 5, 4, 4, 3, 3, 2, 2, 1, 1
+};
+
+static const char* const BENCH_WORDS[] = {
+  "get", "set", "is", "has", "add", "remove", "find", "make", "create", "init",
+  "update", "read", "write", "load", "save", "parse", "build", "check", "handle", "process",
+  "value", "name", "type", "index", "count", "size", "length", "data", "buffer", "node",
+  "list", "map", "key", "item", "entry", "table", "file", "path", "line", "token",
+  "state", "error", "result", "config", "context", "event", "handler", "manager", "user", "id",
+  "first", "last", "next", "prev", "max", "min", "start", "end", "offset", "flag",
+  "child", "parent", "object", "string"
+};
+
+static const char* const BENCH_PREFIXES[] = {
+  "get", "set", "is", "has", "on", "to", "m_", "s_", "k", "p_", "_", "g_"
+};
+
+static const char* const BENCH_SHORT_NAMES[] = {
+  "i", "j", "k", "n", "x", "y", "p", "s", "id", "it", "fn", "ok", "tmp", "len", "buf", "ptr", "idx", "ret"
+};
+
+#define BENCH_COUNT(a) (sizeof(a) / sizeof(*(a)))
+
+static inline unsigned bench_ident_length(uint64_t* rng) {
+  unsigned total = 0;
+  for (int i = 0; i < 20; i++) total += BENCH_IDENT_LENGTHS[i];
+
+  unsigned r = (unsigned)(bench_rng(rng) % total);
+  for (unsigned i = 0; i < 20; i++) {
+    if (r < BENCH_IDENT_LENGTHS[i]) return i + 1;
+    r -= BENCH_IDENT_LENGTHS[i];
+  }
+  return 20;
+}
+
+// Appends word in the given case style, returns the new length (at most max)
+static inline unsigned bench_append(char* out, unsigned len, const unsigned max,
+  const char* word, const int style, const bool first) {
+  // style: 0 camelCase, 1 snake_case, 2 SCREAMING_CASE, 3 PascalCase
+  if (!first && (style == 1 || style == 2) && len < max) out[len++] = '_';
+
+  for (unsigned i = 0; word[i] && len < max; i++) {
+    char c = word[i];
+    const bool cap = (style == 0 && !first && i == 0) || (style == 3 && i == 0) || style == 2;
+    if (cap && c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+    out[len++] = c;
+  }
+  return len;
+}
+
+// Writes a NUL-terminated identifier-like name of 1-20 chars
+static inline void bench_identifier(uint64_t* rng, char out[21]) {
+  const unsigned target = bench_ident_length(rng);
+  unsigned len = 0;
+
+  if (target <= 3 && bench_rng(rng) % 2 == 0) {
+    const char* name = BENCH_SHORT_NAMES[bench_rng(rng) % BENCH_COUNT(BENCH_SHORT_NAMES)];
+    len = bench_append(out, 0, 20, name, 1, true);
+  } else {
+    const unsigned pick = (unsigned)(bench_rng(rng) % 100);
+    const int style = pick < 45 ? 0 : pick < 75 ? 1 : pick < 88 ? 3 : 2;
+    bool first = true;
+    unsigned words = 0;
+
+    // A third of the names belong to a prefix family
+    if (style != 2 && bench_rng(rng) % 3 == 0) {
+      const char* prefix = BENCH_PREFIXES[bench_rng(rng) % BENCH_COUNT(BENCH_PREFIXES)];
+      len = bench_append(out, 0, 20, prefix, 1, true);
+      first = prefix[strlen(prefix) - 1] == '_';
+    }
+
+    // Whole words only: stop once another word would land further from target
+    while (len < target) {
+      const char* word = BENCH_WORDS[bench_rng(rng) % BENCH_COUNT(BENCH_WORDS)];
+      const unsigned next = len + (unsigned)strlen(word) + (!first && (style == 1 || style == 2));
+      if (words > 0 && (next > 20 || next - target > target - len)) break;
+
+      len = bench_append(out, len, 20, word, style, first);
+      first = false;
+      words++;
+    }
+  }
+
+  // Numbered variants such as buf2 or node1
+  if (len >= 2 && len < 20 && bench_rng(rng) % 10 == 0)
+    out[len++] = (char)('0' + bench_rng(rng) % 10);
+  out[len] = '\0';
+}
+
+// =========================
+// ZIPF
+// =========================
+
+// Ranks 0..n-1, rank 0 most frequent, P(r) ~ 1 / (r + 1)^theta, 0 < theta < 1
+typedef struct {
+  uint64_t n;
+  double   theta;
+  double   alpha;
+  double   zetan;
+  double   eta;
+  double   half_pow_theta;
+} bench_zipf;
+
+static inline double bench_zeta(const uint64_t n, const double theta) {
+  double sum = 0.0;
+  for (uint64_t i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+  return sum;
+}
+
+// O(n) setup, O(1) per draw (Gray et al., "Quickly generating billion-record
+// synthetic databases", as used by YCSB)
+static inline bool bench_zipf_init(bench_zipf* z, const uint64_t n, const double theta) {
+  if (n == 0 || !(theta > 0.0 && theta < 1.0)) return false;
+
+  const double zeta2 = bench_zeta(2, theta);
+  z->n = n;
+  z->theta = theta;
+  z->alpha = 1.0 / (1.0 - theta);
+  z->zetan = bench_zeta(n, theta);
+  z->eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+  z->half_pow_theta = 1.0 + pow(0.5, theta);
+  return true;
+}
+
+static inline uint64_t bench_zipf_next(const bench_zipf* z, uint64_t* rng) {
+  const double u = bench_uniform(rng);
+  const double uz = u * z->zetan;
+
+  if (uz < 1.0) return 0;
+  if (uz < z->half_pow_theta) return 1 < z->n ? 1 : 0;
+
+  const uint64_t r = (uint64_t)((double)z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+  return r < z->n ? r : z->n - 1;
+}
+
+// =========================
+// FILE
+// =========================
+
+// Keeps lines that are 1-20 chars of the PackedString alphabet
+static inline bool bench_packable(const char* s, const size_t len) {
+  if (len == 0 || len > 20) return false;
+  for (size_t i = 0; i < len; i++) {
+    const char c = s[i];
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$'))
+      return false;
+  }
+  return true;
+}
+
+// Loads a newline-delimited identifier file into NUL-terminated strings.
+// Lines that cannot be packed are counted in *skipped. Returns NULL on
+// an I/O or allocation error, free with bench_free_lines.
+static inline char** bench_load_lines(const char* path, size_t* count, size_t* skipped) {
+  *count = 0;
+  *skipped = 0;
+
+  FILE* f = fopen(path, "rb");
+  if (!f) return NULL;
+
+  size_t capacity = 1024;
+  char** lines = (char**)malloc(capacity * sizeof(char*));
+  bool failed = !lines;
+  char line[4096];
+
+  while (!failed && fgets(line, sizeof(line), f)) {
+    const size_t len = strcspn(line, "\r\n");
+
+    // Overlong physical line, drop the rest of it
+    if (line[len] == '\0' && !feof(f)) {
+      int c;
+      while ((c = fgetc(f)) != EOF && c != '\n') {}
+      (*skipped)++;
+      continue;
+    }
+
+    if (!bench_packable(line, len)) {
+      if (len > 0) (*skipped)++;
+      continue;
+    }
+
+    if (*count == capacity) {
+      char** grown = (char**)realloc(lines, capacity * 2 * sizeof(char*));
+      if (!grown) {
+        failed = true;
+        break;
+      }
+      lines = grown;
+      capacity *= 2;
+    }
+
+    char* s = (char*)malloc(len + 1);
+    if (!s) {
+      failed = true;
+      break;
+    }
+    memcpy(s, line, len);
+    s[len] = '\0';
+    lines[(*count)++] = s;
+  }
+
+  failed = failed || ferror(f);
+  fclose(f);
+
+  if (failed) {
+    for (size_t i = 0; lines && i < *count; i++) free(lines[i]);
+    free(lines);
+    *count = 0;
+    return NULL;
+  }
+  return lines;
+}
+
+static inline void bench_free_lines(char** lines, const size_t count) {
+  for (size_t i = 0; i < count; i++) free(lines[i]);
+  free(lines);
+}
+
+#endif // PACKED_STRING_BENCH_WORKLOAD_H
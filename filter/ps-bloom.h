@@ -0,0 +1,139 @@
+#ifndef PACKED_STRING_PS_BLOOM_H
+#define PACKED_STRING_PS_BLOOM_H
+
+#include "../packed16/packed-string.h"
+#include "../packed16/aligned.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Split-block Bloom filter over packed strings.
+//
+// One 64-bit hash per key: the high half picks a 256-bit block (half a
+// cache line, so a query touches one line), the low half is multiplied by
+// 8 odd salts and each product's top 5 bits set one bit in each of the
+// block's 8 words. With AVX2 the 8 words are computed and tested at once.
+
+#define PSBF_BLOCK_WORDS 8
+
+typedef struct {
+  uint32_t* words;    // blocks * 8 words, 32-byte aligned
+  size_t    blocks;
+} psbf_filter;
+
+static const uint32_t PSBF_SALT[PSBF_BLOCK_WORDS] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+// Both 64-bit halves of the key feed the hash
+static inline uint64_t psbf_hash64(const ps_t k) {
+  return ps_mix64(k.lo, k.hi);
+}
+
+static inline size_t psbf_block(const psbf_filter* f, const uint64_t h) {
+  return (size_t)(((h >> 32) * (uint64_t)f->blocks) >> 32);
+}
+
+// expected keys at bits_per_key (8 ~ 2% false positives, 12 ~ 0.4%)
+static inline bool psbf_init(psbf_filter* f, const size_t expected, const unsigned bits_per_key) {
+  size_t blocks = (expected * bits_per_key + 255) / 256;
+  if (blocks == 0) blocks = 1;
+  if (blocks > UINT32_MAX) return false;
+
+  f->words = ps_aligned_alloc(blocks * PSBF_BLOCK_WORDS * sizeof(uint32_t), 64);
+  if (!f->words) return false;
+
+  memset(f->words, 0, blocks * PSBF_BLOCK_WORDS * sizeof(uint32_t));
+  f->blocks = blocks;
+  return true;
+}
+
+static inline void psbf_free(psbf_filter* f) {
+  ps_aligned_free(f->words);
+  f->words = NULL;
+  f->blocks = 0;
+}
+
+static inline void psbf_clear(psbf_filter* f) {
+  memset(f->words, 0, f->blocks * PSBF_BLOCK_WORDS * sizeof(uint32_t));
+}
+
+static inline void psbf_add(psbf_filter* f, const ps_t key) {
+  const uint64_t h = psbf_hash64(key);
+  uint32_t* block = &f->words[psbf_block(f, h) * PSBF_BLOCK_WORDS];
+
+  for (int i = 0; i < PSBF_BLOCK_WORDS; i++)
+    block[i] |= 1U << ((uint32_t)h * PSBF_SALT[i] >> 27);
+}
+
+static inline bool psbf_test_hash(const psbf_filter* f, const uint64_t h) {
+  const uint32_t* block = &f->words[psbf_block(f, h) * PSBF_BLOCK_WORDS];
+
+#if defined(__AVX2__)
+  const __m256i salt = _mm256_loadu_si256((const __m256i*)PSBF_SALT);
+  const __m256i bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)(uint32_t)h), salt), 27);
+  const __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+
+  return _mm256_testc_si256(_mm256_load_si256((const __m256i*)block), mask);
+#else
+  uint32_t missing = 0;
+  for (int i = 0; i < PSBF_BLOCK_WORDS; i++)
+    missing |= ~block[i] & 1U << ((uint32_t)h * PSBF_SALT[i] >> 27);
+  return missing == 0;
+#endif
+}
+
+// false means key was never added
+static inline bool psbf_maybe_contains(const psbf_filter* f, const ps_t key) {
+  return psbf_test_hash(f, psbf_hash64(key));
+}
+
+// Batch query: out[i] = psbf_maybe_contains(f, keys[i]).
+// Hashes a window ahead and prefetches those blocks to overlap the misses.
+static inline void psbf_maybe_contains_many(const psbf_filter* f, const ps_t* keys,
+  const size_t n, bool* out) {
+  enum { AHEAD = 8 };
+  uint64_t hashes[AHEAD];
+
+  for (size_t i = 0; i < n && i < AHEAD; i++) {
+    hashes[i] = psbf_hash64(keys[i]);
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&f->words[psbf_block(f, hashes[i]) * PSBF_BLOCK_WORDS]);
+#endif
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t h = hashes[i % AHEAD];
+
+    if (i + AHEAD < n) {
+      hashes[i % AHEAD] = psbf_hash64(keys[i + AHEAD]);
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(&f->words[psbf_block(f, hashes[i % AHEAD]) * PSBF_BLOCK_WORDS]);
+#endif
+    }
+
+    out[i] = psbf_test_hash(f, h);
+  }
+}
+
+// Fraction of bits set, the false positive rate is about fill^8
+static inline double psbf_fill_ratio(const psbf_filter* f) {
+  size_t set = 0;
+  for (size_t i = 0; i < f->blocks * PSBF_BLOCK_WORDS; i++) {
+    uint32_t w = f->words[i];
+    while (w) {
+      w &= w - 1;
+      set++;
+    }
+  }
+  return (double)set / (double)(f->blocks * PSBF_BLOCK_WORDS * 32);
+}
+
+#endif // PACKED_STRING_PS_BLOOM_H
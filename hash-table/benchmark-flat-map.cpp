@@ -0,0 +1,212 @@
+#include "../packed16/packed-string.hpp"
+#include "../bench/bench.h"
+#include "ps-flat-map.hpp"
+
+#ifdef PS_HAVE_ABSL
+#include <absl/container/flat_hash_map.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Usage: bench-flat-map [bench options]
+//
+// ps::flat_map<V> against string-keyed maps holding the same keys and
+// the same 32-byte values: std::unordered_map<std::string, V> and, when
+// built with Abseil, absl::flat_hash_map<std::string, V>. The string maps
+// own std::string copies of the keys; lookups go through a second local
+// copy, so no map sees the exact pointers it stored.
+//
+// Every trial starts from an empty map and runs insert, lookup, missing
+// and erase without reserve, so growth is part of insert. Exits with 1 if
+// a map loses a key or returns a wrong value, or if ps::flat_map grows on
+// try_emplace of a key it holds.
+
+enum { INSERT, LOOKUP, MISSING, ERASE, PHASES };
+
+static const char* const PHASE_NAMES[PHASES] = { "insert", "lookup", "missing", "erase" };
+
+// Bigger than psrh_map's uint64_t, the case flat_map is for
+struct payload {
+    uint64_t id;
+    uint64_t data[3];
+};
+
+struct impl_series {
+    bench_series phase[PHASES];
+};
+
+static payload make_payload(const size_t i) {
+    return payload{ i, { i * 3, i * 5, i * 7 } };
+}
+
+// One trial: insert keys, find lookups (equal to keys) and absent, erase keys
+template <class Map, class Key>
+static bool run_map(impl_series* s, const std::vector<Key>& keys, const std::vector<Key>& lookups,
+    const std::vector<Key>& absent, const size_t* order, const size_t n) {
+    Map m;
+    bool ok = true;
+    uint64_t found = 0;
+
+    BENCH_LOOP(s ? &s->phase[INSERT] : NULL, n, i, m.try_emplace(keys[i], make_payload(i)));
+    ok &= m.size() == n;
+
+    BENCH_LOOP(s ? &s->phase[LOOKUP] : NULL, n, i, {
+        const auto it = m.find(lookups[order[i]]);
+        if (it != m.end()) found += it->second.id == order[i];
+    });
+    ok &= found == n;
+
+    found = 0;
+    BENCH_LOOP(s ? &s->phase[MISSING] : NULL, n, i, found += m.find(absent[i]) != m.end());
+    ok &= found == 0;
+
+    BENCH_LOOP(s ? &s->phase[ERASE] : NULL, n, i, found += m.erase(keys[i]));
+    ok &= found == n && m.empty();
+
+    return ok;
+}
+
+// Fills a ps::flat_map up to its load limit, then try_emplace of every
+// present key must find it without growing or moving anything; the next
+// new key grows the table
+static bool check_no_grow_on_hit(const std::vector<ps::packed>& keys) {
+    ps::flat_map<payload> m;
+    size_t i = 0;
+    while (i < keys.size() && (m.empty() || (m.size() + 1) * 8 <= m.capacity() * 7)) {
+        m.try_emplace(keys[i], make_payload(i));
+        i++;
+    }
+    if (i == keys.size()) return true;   // too few keys to tell
+
+    const size_t capacity = m.capacity();
+    const payload* first = &m.find(keys[0])->second;
+    bool ok = true;
+
+    for (size_t j = 0; j < i; ++j) {
+        const auto r = m.try_emplace(keys[j], make_payload(keys.size()));
+        ok &= !r.second && r.first->second.id == j;
+    }
+    ok &= m.capacity() == capacity && &m.find(keys[0])->second == first;
+
+    ok &= m.try_emplace(keys[i], make_payload(i)).second && m.capacity() > capacity;
+    return ok;
+}
+
+static void report_impl(bench_report* r, const char* impl, impl_series* s) {
+    for (int p = 0; p < PHASES; ++p) {
+        bench_report_row(r, impl, PHASE_NAMES[p], &s->phase[p]);
+        bench_series_free(&s->phase[p]);
+    }
+}
+
+int main(const int argc, char** argv) {
+    bench_config cfg;
+    if (!bench_parse_args(&cfg, argc, argv)) return 1;
+
+    char** file_keys = NULL;
+    size_t loaded = 0;
+    if (cfg.keys_file) {
+        size_t skipped = 0;
+        file_keys = bench_load_lines(cfg.keys_file, &loaded, &skipped);
+        if (!file_keys || loaded == 0) {
+            fprintf(stderr, "no usable identifiers in %s\n", cfg.keys_file);
+            return 1;
+        }
+        if (skipped)
+            fprintf(stderr, "note: skipped %zu lines that do not fit a PackedString\n", skipped);
+
+        // Missing keys come from the identifier generator
+        if (loaded < cfg.n) cfg.n = loaded;
+        cfg.dist = BENCH_DIST_IDENT;
+    }
+
+    // =========================
+    // KEYS
+    // =========================
+
+    // Distinct keys, then keys none of them equal
+    const size_t n = cfg.n;
+    uint64_t rng = cfg.seed;
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> strings, missing;
+    char key[PACKED_STRING_MAX_LEN + 1];
+
+    for (size_t i = 0; i < n && strings.size() < n; ++i) {
+        if (file_keys) strcpy(key, file_keys[i]);
+        else bench_random_key(&cfg, &rng, key);
+        if (seen.insert(key).second) strings.push_back(key);
+    }
+
+    // Short distributions run out of fresh keys, so give up after a few tries
+    for (size_t i = 0; i < strings.size(); ++i) {
+        int tries = 0;
+        do bench_random_key(&cfg, &rng, key);
+        while (seen.count(key) && ++tries < 64);
+        if (tries < 64) missing.push_back(key);
+    }
+    if (file_keys) bench_free_lines(file_keys, loaded);
+
+    const size_t count = strings.size() < missing.size() ? strings.size() : missing.size();
+    if (count < n) fprintf(stderr, "note: %zu distinct keys of %zu\n", count, n);
+
+    std::vector<ps::packed> pss, pss_missing;
+    for (size_t i = 0; i < count; ++i) {
+        pss.emplace_back(std::string_view(strings[i]));
+        pss_missing.emplace_back(std::string_view(missing[i]));
+    }
+
+    // Lookups use a second copy of the strings
+    const std::vector<std::string> lookups(strings.begin(), strings.end());
+
+    // Lookup order: every key once, or Zipfian ranks (rank 0 = first key)
+    std::vector<size_t> order(count);
+    bench_zipf zipf;
+    const bool skewed = cfg.zipf > 0.0 && bench_zipf_init(&zipf, count, cfg.zipf);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = skewed ? (size_t)bench_zipf_next(&zipf, &rng) : i;
+
+    // =========================
+    // RUN
+    // =========================
+
+    impl_series flat = {}, stdmap = {};
+#ifdef PS_HAVE_ABSL
+    impl_series absl = {};
+#endif
+
+    bool ok = check_no_grow_on_hit(pss);
+    for (unsigned trial = 0; trial < cfg.warmup + cfg.trials; ++trial) {
+        const bool measure = trial >= cfg.warmup;
+
+        ok &= run_map<ps::flat_map<payload>>(measure ? &flat : NULL, pss, pss, pss_missing,
+            order.data(), count);
+        ok &= run_map<std::unordered_map<std::string, payload>>(measure ? &stdmap : NULL, strings,
+            lookups, missing, order.data(), count);
+#ifdef PS_HAVE_ABSL
+        ok &= run_map<absl::flat_hash_map<std::string, payload>>(measure ? &absl : NULL, strings,
+            lookups, missing, order.data(), count);
+#endif
+    }
+
+    if (!ok) {
+        fprintf(stderr, "a map lost a key, returned a wrong value or grew on a hit\n");
+        return 1;
+    }
+
+    bench_report report;
+    bench_report_begin(&report, &cfg);
+    report_impl(&report, "ps-flat-map", &flat);
+    report_impl(&report, "std-unordered", &stdmap);
+#ifdef PS_HAVE_ABSL
+    report_impl(&report, "absl-flat-hash", &absl);
+#endif
+    bench_report_end(&report);
+
+    return 0;
+}
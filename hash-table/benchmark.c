@@ -1,136 +1,632 @@
 #include "../packed16/packed-string.h"
+#include "../bench/bench.h"
 #include "ps-robinhood.h"
 #include "cs-robinhood.h"
+#include "cs-robinhood-arena.h"
+#include "ps-robinhood-build.h"
+#include "ps-intern.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include "ps-robinhood-file.h"
+#include <pthread.h>
+#include <unistd.h>
+#define SNAPSHOT 1
+#else
+#define SNAPSHOT 0
+#endif
+#include "../filter/ps-bloom.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
-#define N 1000000
-#define STR_MAX 20
+// Usage: benchmark [-n N] [-t trials] [-w warmup] [-l load] [-d dist] [-z theta] [-i file]
+//                  [-f text|csv|json] [-p]
+//
+// Every trial starts from an empty table and runs insert, lookup, missing
+// and delete over the same keys. Missing keys are guaranteed absent.
+// -d ident generates realistic identifiers, -i reads them from a file
+// and -z makes lookups Zipfian instead of one pass over every key.
+// -p adds cycles, IPC and cache/branch/TLB misses per op for each phase.
+// Build with -DPSRH_STATS (the bench-hash-table-stats target) to also
+// print psrh probe statistics and check that they count every lookup.
+//
+// psrh-mmap saves the full psrh table to a temporary file each trial,
+// maps it back with psrh_open_mmap and runs lookup and missing on the
+// mapping. save and open are per key, to set against psrh insert; the
+// file is still in the page cache, so open does not include disk reads.
+//
+// csrh-arena is the C-string baseline with owned keys: csra_map copies
+// each key into one arena and caches its full hash in the slot, so probes
+// do not chase malloc'd keys or rehash them.
+//
+// psrh-build fills a second table with psrh_build on every online CPU,
+// one sample per trial over all keys, to set against psrh insert. The
+// build is checked against the psrh table each trial.
+//
+// psrh iterate is one psrh_for_each over the full table, per key. The
+// built table is then cut to the keys with even values by psrh_retain,
+// and both are checked against the psrh table.
+//
+// psin is the interning pool in thread-safe mode, grown from 16 symbols
+// each trial: insert interns every key, lookup maps ids back to keys
+// (lock-free) and missing is psin_find of absent keys. Before the trials
+// INTERN_THREADS threads intern the keys concurrently from different
+// starting points and must agree on one dense id per key.
+
+enum { INSERT, LOOKUP, MISSING, DELETE, PHASES };
+enum { SAVE = PHASES, OPEN, ITERATE, ALL_PHASES };
+
+static const char* PHASE_NAMES[ALL_PHASES] = { "insert", "lookup", "missing", "delete", "save", "open", "iterate" };
+
+typedef struct {
+    bench_series   phase[ALL_PHASES];
+    bench_counters counters[ALL_PHASES];
+} impl_series;
+
+static bench_perf perf;
+
+// Times one phase, with counters around the whole loop when enabled
+#define PHASE(impl, p, measure, n, i, body)                              \
+    do {                                                                 \
+        bench_perf_start(&perf);                                         \
+        BENCH_LOOP((measure) ? &(impl).phase[p] : NULL, n, i, body);     \
+        bench_perf_stop(&perf, (measure) ? &(impl).counters[p] : NULL);  \
+    } while (0)
+
+static void report_impl(bench_report* r, const char* impl, impl_series* s, const int phases) {
+    for (int p = 0; p < phases; ++p) {
+        bench_report_row_counters(r, impl, PHASE_NAMES[p], &s->phase[p], &s->counters[p]);
+        bench_series_free(&s->phase[p]);
+    }
+}
 
-static const char ALPHABET[] =
-    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$";
+// sums[0] counts keys, sums[1] adds up their values
+static void add_value(const ps_t key, const uint64_t value, void* sums) {
+    (void)key;
+    ((uint64_t*)sums)[0]++;
+    ((uint64_t*)sums)[1] += value;
+}
 
-static double now_seconds(void) {
-    return (double)clock() / CLOCKS_PER_SEC;
+static bool even_value(const ps_t key, const uint64_t value, void* ctx) {
+    (void)key;
+    (void)ctx;
+    return value % 2 == 0;
 }
 
-static void random_string(char* out, const int len) {
-    for (int i = 0; i < len; ++i)
-        out[i] = ALPHABET[rand() & 63];
-    out[len] = '\0';
+// sums from psrh_for_each over pt, then bt (a copy of pt) cut to even values
+static bool check_iteration(const psrh_map* pt, psrh_map* bt, const uint64_t sums[2]) {
+    uint64_t count = 0, sum = 0, even = 0;
+    for (size_t i = 0; i < pt->capacity; ++i) {
+        if (pt->slots[i].fp == 0) continue;
+        count++;
+        sum += pt->slots[i].value;
+        even += pt->slots[i].value % 2 == 0;
+    }
+    if (sums[0] != count || sums[1] != sum) return false;
+
+    if (psrh_retain(bt, even_value, NULL) != count - even || bt->size != even) return false;
+    for (size_t i = 0; i < pt->capacity; ++i) {
+        const psrh_slot* s = &pt->slots[i];
+        if (s->fp != 0 && psrh_contains(bt, s->key) != (s->value % 2 == 0)) return false;
+    }
+    return true;
 }
 
-int main(void) {
-    srand(1234);
+// No false negatives: every added key passes, one at a time and batched
+static bool check_filter(const psbf_filter* filter, const ps_t* keys, bool* maybe, const size_t n) {
+    bool ok = true;
+    for (size_t i = 0; ok && i < n; ++i) ok = psbf_maybe_contains(filter, keys[i]);
 
-    char** strings = malloc(N * sizeof(char*));
-    char** missing = malloc(N * sizeof(char*));
+    psbf_maybe_contains_many(filter, keys, n, maybe);
+    for (size_t i = 0; ok && i < n; ++i) ok = maybe[i];
+    return ok;
+}
 
-    for (int i = 0; i < N; ++i) {
-        strings[i] = malloc(STR_MAX + 1);
-        missing[i] = malloc(STR_MAX + 1);
+// Keys seen by value (pt values are ids < n), repeated if one comes twice
+typedef struct {
+    uint8_t* seen;
+    size_t   n;
+    bool     repeated;
+} value_marks;
+
+static void mark_value(const ps_t key, const uint64_t value, void* ctx) {
+    (void)key;
+    value_marks* marks = ctx;
+    if (value >= marks->n || marks->seen[value]++) marks->repeated = true;
+}
 
-        random_string(strings[i], rand() % STR_MAX + 1);
-        random_string(missing[i], rand() % STR_MAX + 1);
+// bt refilled from pt: psrh_next with psrh_iter_delete on odd values
+// returns each key once and keeps the others findable, then psrh_drain
+// reports each kept key once and leaves bt empty
+static bool check_iter_delete(const psrh_map* pt, psrh_map* bt, const size_t n) {
+    value_marks marks = { calloc(n ? n : 1, 1), n, false };
+    if (!marks.seen) return false;
+
+    psrh_clear(bt);
+    for (size_t i = 0; i < pt->capacity; ++i)
+        if (pt->slots[i].fp != 0) psrh_set(bt, pt->slots[i].key, pt->slots[i].value);
+
+    psrh_iter it;
+    ps_t key;
+    uint64_t value, expected;
+    size_t returned = 0, kept = 0;
+    bool ok = bt->size == pt->size;
+
+    psrh_iter_init(bt, &it);
+    while (ok && psrh_next(&it, &key, &value)) {
+        ok = psrh_get(pt, key, &expected) && expected == value;
+        mark_value(key, value, &marks);
+        returned++;
+        if (value % 2) psrh_iter_delete(bt, &it);
+        else kept++;
     }
+    ok = ok && returned == pt->size && !marks.repeated && bt->size == kept;
 
-    printf("N = %d\n\n", N);
+    for (size_t i = 0; ok && i < pt->capacity; ++i) {
+        const psrh_slot* s = &pt->slots[i];
+        if (s->fp != 0) ok = marks.seen[s->value] == 1 && psrh_contains(bt, s->key) == (s->value % 2 == 0);
+    }
 
-    // =========================
-    // C STRING
-    // =========================
+    memset(marks.seen, 0, n);
+    ok = ok && psrh_drain(bt, mark_value, &marks) == kept && bt->size == 0 && !marks.repeated;
+    for (size_t i = 0; ok && i < pt->capacity; ++i) {
+        const psrh_slot* s = &pt->slots[i];
+        if (s->fp != 0) ok = marks.seen[s->value] == (s->value % 2 == 0) && !psrh_contains(bt, s->key);
+    }
 
-    csrh_map ct;
-    csrh_init(&ct, N * 2);
+    free(marks.seen);
+    return ok;
+}
 
-    double t0, t1, t2, t3, t4;
+// Every key maps back from its id, absent keys have none, intern_many agrees
+static bool check_intern(psin_pool* pool, const ps_t* keys, const ps_t* missing, const uint32_t* ids,
+                         const size_t n) {
+    bool ok = psin_size(pool) <= n;
+    for (size_t i = 0; ok && i < n; ++i) {
+        uint32_t id;
+        ok = ids[i] < psin_size(pool) && ps_equal(psin_lookup(pool, ids[i]), keys[i])
+            && !psin_find(pool, missing[i], &id)
+            && psin_intern_many(pool, &keys[i], 1, &id) == 1 && id == ids[i];
+    }
+    return ok && ps_equal(psin_lookup(pool, (uint32_t)psin_size(pool)), PACKED_STRING_INVALID);
+}
 
-    volatile uint64_t sink = 0;
+#if SNAPSHOT
+enum { INTERN_THREADS = 4 };
+
+typedef struct {
+    psin_pool*  pool;
+    const ps_t* keys;
+    size_t      n;
+    size_t      first;   // where this thread starts in keys
+    uint32_t*   ids;
+    bool        ok;
+} intern_job;
+
+static void* intern_thread(void* arg) {
+    intern_job* job = arg;
+    for (size_t k = 0; k < job->n; ++k) {
+        const size_t i = (job->first + k) % job->n;
+        job->ids[i] = psin_intern(job->pool, job->keys[i]);
+        job->ok &= job->ids[i] != PSIN_NONE && ps_equal(psin_lookup(job->pool, job->ids[i]), job->keys[i]);
+    }
+    return NULL;
+}
 
-    t0 = now_seconds();
-    for (int i = 0; i < N; ++i)
-        csrh_set(&ct, strings[i], i);
-    t1 = now_seconds();
+// Threads interning the same keys while the pool grows get the same ids,
+// one per distinct key and every id below the pool size handed out
+static bool check_intern_threads(const ps_t* keys, const size_t n) {
+    psin_pool pool;
+    if (!psin_init(&pool, 16, true)) return false;
+
+    intern_job jobs[INTERN_THREADS];
+    pthread_t ids[INTERN_THREADS];
+    uint32_t* all = malloc((INTERN_THREADS * n + 1) * sizeof(uint32_t));
+    bool* used = calloc(n + 1, sizeof(bool));
+    bool ok = all && used;
+
+    for (unsigned t = 0; ok && t < INTERN_THREADS; ++t) {
+        jobs[t] = (intern_job){ &pool, keys, n, n / INTERN_THREADS * t, &all[t * n], true };
+        ok = pthread_create(&ids[t], NULL, intern_thread, &jobs[t]) == 0;
+        if (!ok) while (t-- > 0) pthread_join(ids[t], NULL);
+    }
+    if (ok) {
+        for (unsigned t = 0; t < INTERN_THREADS; ++t) pthread_join(ids[t], NULL);
+        for (unsigned t = 0; t < INTERN_THREADS; ++t) ok &= jobs[t].ok;
+    }
 
-    for (int i = 0; i < N; ++i)
-        csrh_get(&ct, strings[i], (uint64_t*)&sink);
-    t2 = now_seconds();
+    for (size_t i = 0; ok && i < n; ++i) {
+        uint32_t id;
+        ok = psin_find(&pool, keys[i], &id) && id < n;
+        for (unsigned t = 0; ok && t < INTERN_THREADS; ++t) ok = all[t * n + i] == id;
+        if (ok) used[id] = true;
+    }
+    for (size_t id = 0; ok && id < psin_size(&pool); ++id) ok = used[id];
 
-    for (int i = 0; i < N; ++i)
-        csrh_contains(&ct, missing[i]);
-    t3 = now_seconds();
+    free(used);
+    free(all);
+    psin_free(&pool);
+    return ok;
+}
+#endif
 
-    for (int i = 0; i < N; ++i)
-        csrh_delete(&ct, strings[i]);
-    t4 = now_seconds();
+#ifdef PSRH_STATS
+// Every lookup lands in exactly one of hits or misses and one probe bucket
+static bool check_stats(psrh_map* pt, const ps_t* keys, const ps_t* missing, const size_t n) {
+    uint64_t value = 0, probed = 0;
 
-    printf("C String:\n");
-    printf("  Insert:  %.3f s\n", t1 - t0);
-    printf("  Lookup:  %.3f s\n", t2 - t1);
-    printf("  Missing: %.3f s\n", t3 - t2);
-    printf("  Delete:  %.3f s\n\n", t4 - t3);
+    psrh_stats_reset(pt);
+    for (size_t i = 0; i < n; ++i) {
+        BENCH_KEEP(psrh_get(pt, keys[i], &value));
+        BENCH_KEEP(psrh_contains(pt, missing[i]));
+    }
+    for (int d = 0; d < PSRH_STATS_BUCKETS; ++d) probed += pt->stats.probes[d];
+
+    return pt->stats.hits == n && pt->stats.misses == n
+        && pt->stats.hits + pt->stats.misses == 2 * n && probed == 2 * n;
+}
+#endif
+
+// Same slots taken, same home bucket in each and same values as pt
+static bool same_table(const psrh_map* pt, const psrh_map* bt) {
+    if (pt->size != bt->size || pt->capacity != bt->capacity) return false;
+    for (size_t i = 0; i < pt->capacity; ++i) {
+        const psrh_slot* s = &pt->slots[i];
+        uint64_t value;
+        if ((s->fp == 0) != (bt->slots[i].fp == 0)) return false;
+        if (s->fp == 0) continue;
+        if ((psrh_hash64(s->key) & pt->mask) != (psrh_hash64(bt->slots[i].key) & bt->mask)) return false;
+        if (!psrh_get(bt, s->key, &value) || value != s->value) return false;
+    }
+    return true;
+}
+
+#if SNAPSHOT
+// Saves pt, maps it back and checks every key against pt; false on any error
+static bool run_snapshot(impl_series* mm, const bool measure, const int fd, const char* path,
+                         const psrh_map* pt, const ps_t* keys, const ps_t* missing,
+                         const size_t* order, const size_t n) {
+    psrh_file mapped;
+    uint64_t value = 0;
+
+    if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0) return false;
+
+    uint64_t t = bench_now_ns();
+    if (!psrh_save(pt, fd)) return false;
+    bench_record(measure ? &mm->phase[SAVE] : NULL, bench_now_ns() - t, n);
+
+    t = bench_now_ns();
+    if (!psrh_open_mmap(path, &mapped)) return false;
+    bench_record(measure ? &mm->phase[OPEN] : NULL, bench_now_ns() - t, n);
+
+    PHASE(*mm, LOOKUP, measure, n, i, {
+        psrh_get(&mapped.map, keys[order[i]], &value);
+        BENCH_KEEP(value);
+    });
+    PHASE(*mm, MISSING, measure, n, i, BENCH_KEEP(psrh_contains(&mapped.map, missing[i])));
+
+    bool same = mapped.map.size == pt->size;
+    for (size_t i = 0; same && i < n; ++i) {
+        uint64_t want = 0, got = 0;
+        same = psrh_get(pt, keys[i], &want) && psrh_get(&mapped.map, keys[i], &got) && got == want
+            && psrh_contains(&mapped.map, missing[i]) == psrh_contains(pt, missing[i]);
+    }
+
+    // Padding and empty slots are zero on disk
+    for (size_t i = 0; same && i < mapped.map.capacity; ++i) {
+        const psrh_slot* s = &mapped.map.slots[i];
+        psrh_slot clean;
+        memset(&clean, 0, sizeof(clean));
+        if (s->fp != 0) {
+            clean.fp = s->fp;
+            clean.key = s->key;
+            clean.value = s->value;
+        }
+        same = memcmp(s, &clean, sizeof(clean)) == 0;
+    }
+
+    psrh_close_mmap(&mapped);
+    return same;
+}
+#endif
+
+int main(const int argc, char** argv) {
+    bench_config cfg;
+    if (!bench_parse_args(&cfg, argc, argv)) return 1;
+
+    char** file_keys = NULL;
+    size_t loaded = 0;
+    if (cfg.keys_file) {
+        size_t skipped = 0;
+        file_keys = bench_load_lines(cfg.keys_file, &loaded, &skipped);
+        if (!file_keys || loaded == 0) {
+            fprintf(stderr, "no usable identifiers in %s\n", cfg.keys_file);
+            return 1;
+        }
+        if (skipped)
+            fprintf(stderr, "note: skipped %zu lines that do not fit a PackedString\n", skipped);
+
+        // Missing keys come from the identifier generator
+        if (loaded < cfg.n) cfg.n = loaded;
+        cfg.dist = BENCH_DIST_IDENT;
+    }
+
+    const size_t n = cfg.n;
+    const size_t capacity = bench_capacity(&cfg);
+    uint64_t rng = cfg.seed;
+
+    char** strings = malloc(n * sizeof(char*));
+    char** missing = malloc(n * sizeof(char*));
+    ps_t* pss = malloc(n * sizeof(ps_t));
+    ps_t* pss_missing = malloc(n * sizeof(ps_t));
+    bool* maybe = malloc(n * sizeof(bool));
+    size_t* order = malloc(n * sizeof(size_t));
+    if (!strings || !missing || !pss || !pss_missing || !maybe || !order) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
 
     // =========================
-    // PACKED STRING
+    // KEYS
     // =========================
 
-    ps_t* pss = malloc(N * sizeof(ps_t));
-    ps_t* pss_missing = malloc(N * sizeof(ps_t));
+    psrh_map present;
+    if (!psrh_init(&present, capacity)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
 
-    for (int i = 0; i < N; ++i) {
+    for (size_t i = 0; i < n; ++i) {
+        strings[i] = malloc(PACKED_STRING_MAX_LEN + 1);
+        if (file_keys) strcpy(strings[i], file_keys[i]);
+        else bench_random_key(&cfg, &rng, strings[i]);
         pss[i] = ps_pack(strings[i]);
-        pss_missing[i] = ps_pack(missing[i]);
+        psrh_set(&present, pss[i], i);
     }
 
-    psrh_map ps_table;
-    psrh_init(&ps_table, N * 2);
+    // Short distributions run out of fresh keys, so give up after a few tries
+    size_t collisions = 0;
+    for (size_t i = 0; i < n; ++i) {
+        missing[i] = malloc(PACKED_STRING_MAX_LEN + 1);
+        int tries = 0;
+        do {
+            bench_random_key(&cfg, &rng, missing[i]);
+            pss_missing[i] = ps_pack(missing[i]);
+        } while (psrh_contains(&present, pss_missing[i]) && ++tries < 64);
+        collisions += tries == 64;
+    }
+    psrh_free(&present);
+    if (file_keys) bench_free_lines(file_keys, loaded);
+
+    if (collisions)
+        fprintf(stderr, "warning: %zu missing keys are present in the table\n", collisions);
 
-    t0 = now_seconds();
-    for (int i = 0; i < N; ++i)
-        psrh_set(&ps_table, pss[i], i);
-    t1 = now_seconds();
+    // Lookup order: every key once, or Zipfian ranks (rank 0 = first key)
+    bench_zipf zipf;
+    const bool skewed = cfg.zipf > 0.0 && bench_zipf_init(&zipf, n, cfg.zipf);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = skewed ? (size_t)bench_zipf_next(&zipf, &rng) : i;
 
-    for (int i = 0; i < N; ++i)
-        psrh_get(&ps_table, pss[i], (uint64_t*)&sink);
-    t2 = now_seconds();
+    // =========================
+    // RUN
+    // =========================
 
-    for (int i = 0; i < N; ++i)
-        psrh_contains(&ps_table, pss_missing[i]);
-    t3 = now_seconds();
+    csrh_map ct;
+    csra_map at;
+    psrh_map pt, bt;
+    psbf_filter filter;
+    uint64_t* ids = malloc(n * sizeof(uint64_t));
+    uint32_t* symbols = malloc(n * sizeof(uint32_t));
+    if (!csrh_init(&ct, capacity) || !psrh_init(&pt, capacity) || !psbf_init(&filter, n, 10)
+        || !psrh_init(&bt, capacity) || !ids || !symbols || !csra_init(&at, capacity, n * 16)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; ++i) ids[i] = i;
+
+#if SNAPSHOT
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const unsigned threads = cpus > 0 ? (unsigned)cpus : 1;
+#else
+    const unsigned threads = 1;
+#endif
+
+    impl_series cs = {0}, arena = {0}, ps = {0}, build = {0}, bloom = {0}, mm = {0}, intern = {0};
+    bench_series batched = {0};
+    bench_counters batched_counters = {0};
+
+#if SNAPSHOT
+    const char* tmp = getenv("TMPDIR");
+    char snapshot_path[4096];
+    snprintf(snapshot_path, sizeof(snapshot_path), "%s/psrh-bench-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    const int snapshot_fd = mkstemp(snapshot_path);
+    if (snapshot_fd < 0) perror("warning: no psrh-mmap snapshot file");
+#endif
+
+#if SNAPSHOT
+    if (!check_intern_threads(pss, n)) {
+        fprintf(stderr, "psin threads disagree on ids\n");
+        return 1;
+    }
+#endif
 
-    for (int i = 0; i < N; ++i)
-        psrh_delete(&ps_table, pss[i]);
-    t4 = now_seconds();
+    if (cfg.perf) {
+        bench_perf_open(&perf);
+        if (!bench_perf_available(&perf))
+            fprintf(stderr, "warning: hardware counters unavailable, check perf_event_paranoid\n");
+    }
 
-    printf("PackedString:\n");
-    printf("  Insert:  %.3f s\n", t1 - t0);
-    printf("  Lookup:  %.3f s\n", t2 - t1);
-    printf("  Missing: %.3f s\n", t3 - t2);
-    printf("  Delete:  %.3f s\n", t4 - t3);
+    for (unsigned trial = 0; trial < cfg.warmup + cfg.trials; ++trial) {
+        const bool measure = trial >= cfg.warmup;
+        uint64_t value = 0;
+
+        // C STRING
+        csrh_clear(&ct);
+        PHASE(cs, INSERT, measure, n, i, csrh_set(&ct, strings[i], i));
+        PHASE(cs, LOOKUP, measure, n, i, {
+            csrh_get(&ct, strings[order[i]], &value);
+            BENCH_KEEP(value);
+        });
+        PHASE(cs, MISSING, measure, n, i, BENCH_KEEP(csrh_contains(&ct, missing[i])));
+        PHASE(cs, DELETE, measure, n, i, csrh_delete(&ct, strings[i]));
+
+        // C STRING, KEYS IN AN ARENA
+        csra_clear(&at);
+        PHASE(arena, INSERT, measure, n, i, csra_set(&at, strings[i], i));
+        PHASE(arena, LOOKUP, measure, n, i, {
+            csra_get(&at, strings[order[i]], &value);
+            BENCH_KEEP(value);
+        });
+        PHASE(arena, MISSING, measure, n, i, BENCH_KEEP(csra_contains(&at, missing[i])));
+        PHASE(arena, DELETE, measure, n, i, csra_delete(&at, strings[i]));
+
+        // PACKED STRING
+        psrh_clear(&pt);
+        PHASE(ps, INSERT, measure, n, i, psrh_set(&pt, pss[i], i));
+        PHASE(ps, LOOKUP, measure, n, i, {
+            psrh_get(&pt, pss[order[i]], &value);
+            BENCH_KEEP(value);
+        });
+        PHASE(ps, MISSING, measure, n, i, BENCH_KEEP(psrh_contains(&pt, pss_missing[i])));
+
+        // PACKED STRING, BULK BUILD of the same keys
+        const uint64_t start = bench_now_ns();
+        const bool built = psrh_build(&bt, pss, ids, n, threads);
+        bench_record(measure ? &build.phase[INSERT] : NULL, bench_now_ns() - start, n);
+        if (!built || !same_table(&pt, &bt)) {
+            fprintf(stderr, "psrh_build failed or differs from psrh\n");
+            return 1;
+        }
+
+        uint64_t sums[2] = {0, 0};
+        const uint64_t iterate_start = bench_now_ns();
+        psrh_for_each(&pt, add_value, sums);
+        bench_record(measure ? &ps.phase[ITERATE] : NULL, bench_now_ns() - iterate_start, n);
+        if (!check_iteration(&pt, &bt, sums)) {
+            fprintf(stderr, "psrh_for_each or psrh_retain lost a key\n");
+            return 1;
+        }
+        if (!check_iter_delete(&pt, &bt, n)) {
+            fprintf(stderr, "psrh_iter_delete or psrh_drain lost or repeated a key\n");
+            return 1;
+        }
+
+#if SNAPSHOT
+        // PACKED STRING SNAPSHOT, same table served from a mapping
+        if (snapshot_fd >= 0
+            && !run_snapshot(&mm, measure, snapshot_fd, snapshot_path, &pt, pss, pss_missing, order, n)) {
+            fprintf(stderr, "psrh-mmap snapshot failed or differs from psrh\n");
+            unlink(snapshot_path);
+            return 1;
+        }
+#endif
+
+        // PACKED STRING + BLOOM FRONT FILTER, the table is still full here
+        psbf_clear(&filter);
+        PHASE(bloom, INSERT, measure, n, i, psbf_add(&filter, pss[i]));
+        PHASE(bloom, LOOKUP, measure, n, i, {
+            const ps_t key = pss[order[i]];
+            if (psbf_maybe_contains(&filter, key)) psrh_get(&pt, key, &value);
+            BENCH_KEEP(value);
+        });
+        PHASE(bloom, MISSING, measure, n, i,
+            BENCH_KEEP(psbf_maybe_contains(&filter, pss_missing[i]) && psrh_contains(&pt, pss_missing[i])));
+
+        // Batched filter probes, one sample per BENCH_BATCH keys
+        bench_perf_start(&perf);
+        for (size_t first = 0; first < n; first += BENCH_BATCH) {
+            const size_t count = n - first < BENCH_BATCH ? n - first : BENCH_BATCH;
+            const uint64_t t = bench_now_ns();
+
+            psbf_maybe_contains_many(&filter, &pss_missing[first], count, &maybe[first]);
+            for (size_t j = first; j < first + count; ++j)
+                BENCH_KEEP(maybe[j] && psrh_contains(&pt, pss_missing[j]));
+
+            bench_record(measure ? &batched : NULL, bench_now_ns() - t, count);
+        }
+        bench_perf_stop(&perf, measure ? &batched_counters : NULL);
+
+        if (!check_filter(&filter, pss, maybe, n)) {
+            fprintf(stderr, "psbf_filter rejected a key it holds\n");
+            return 1;
+        }
+
+#ifdef PSRH_STATS
+        if (trial + 1 == cfg.warmup + cfg.trials) psrh_stats_print(&pt, stderr);
+        if (!check_stats(&pt, pss, pss_missing, n)) {
+            fprintf(stderr, "psrh stats do not add up to the lookups made\n");
+            return 1;
+        }
+#endif
+
+        PHASE(ps, DELETE, measure, n, i, psrh_delete(&pt, pss[i]));
+
+        // INTERNING POOL, growth included
+        psin_pool pool;
+        if (!psin_init(&pool, 16, true)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        PHASE(intern, INSERT, measure, n, i, symbols[i] = psin_intern(&pool, pss[i]));
+        PHASE(intern, LOOKUP, measure, n, i, BENCH_KEEP(psin_lookup(&pool, symbols[order[i]]).lo));
+        PHASE(intern, MISSING, measure, n, i, {
+            uint32_t id;
+            BENCH_KEEP(psin_find(&pool, pss_missing[i], &id));
+        });
+        const bool interned = check_intern(&pool, pss, pss_missing, symbols, n);
+        psin_free(&pool);
+        if (!interned) {
+            fprintf(stderr, "psin lost a key or returned a wrong id\n");
+            return 1;
+        }
+    }
 
+    bench_report report;
+    bench_report_begin(&report, &cfg);
+    report_impl(&report, "csrh", &cs, PHASES);
+    report_impl(&report, "csrh-arena", &arena, PHASES);
+    report_impl(&report, "psrh", &ps, PHASES);
+    bench_report_row(&report, "psrh", PHASE_NAMES[ITERATE], &ps.phase[ITERATE]);
+    bench_series_free(&ps.phase[ITERATE]);
+    report_impl(&report, "psrh-build", &build, LOOKUP);
+#if SNAPSHOT
+    if (snapshot_fd >= 0) {
+        static const int order_mm[] = { SAVE, OPEN, LOOKUP, MISSING };
+        for (size_t k = 0; k < sizeof(order_mm) / sizeof(*order_mm); ++k) {
+            const int p = order_mm[k];
+            bench_report_row_counters(&report, "psrh-mmap", PHASE_NAMES[p], &mm.phase[p], &mm.counters[p]);
+            bench_series_free(&mm.phase[p]);
+        }
+        close(snapshot_fd);
+        unlink(snapshot_path);
+    }
+#endif
+    report_impl(&report, "psrh+bloom", &bloom, DELETE);
+    report_impl(&report, "psin", &intern, DELETE);
+    bench_report_row_counters(&report, "psrh+bloom[]", "missing", &batched, &batched_counters);
+    bench_series_free(&batched);
+    bench_report_end(&report);
+
+    bench_perf_close(&perf);
+    psbf_free(&filter);
+    psrh_free(&bt);
+    psrh_free(&pt);
+    free(symbols);
+    free(ids);
+    csra_free(&at);
+    csrh_free(&ct);
+
+    for (size_t i = 0; i < n; ++i) {
+        free(strings[i]);
+        free(missing[i]);
+    }
     free(strings);
     free(missing);
     free(pss);
     free(pss_missing);
+    free(maybe);
+    free(order);
 
     return 0;
 }
-
-/*
-N = 1000000
-
-C String:
-  Insert:  0.139 s
-  Lookup:  0.167 s
-  Missing: 0.190 s
-  Delete:  0.141 s
-
-PackedString:
-  Insert:  0.041 s
-  Lookup:  0.031 s
-  Missing: 0.052 s
-  Delete:  0.042 s
-*/
\ No newline at end of file
@@ -0,0 +1,224 @@
+#ifndef PACKED_STRING_CS_ROBINHOOD_ARENA_H
+#define PACKED_STRING_CS_ROBINHOOD_ARENA_H
+
+#include "../packed16/aligned.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// C-string Robin Hood map that owns its keys: csrh_map with the key
+// bytes copied into one bump arena and the full 64-bit hash cached in
+// the slot.
+//
+// csrh_map keeps the caller's char* and rehashes the resident key of
+// every slot it probes past, so it pays for malloc scatter and a strlen
+// plus hash per probe. Here a probe reads the cached hash for the
+// distance and touches the arena only when the hashes match, which is
+// what std::string-keyed tables with stored hashes do. Deleted keys stay
+// in the arena until csra_clear.
+
+typedef struct {
+  uint64_t hash;     // 0 = empty
+  uint32_t offset;   // key bytes in the arena
+  uint32_t length;
+  uint64_t value;
+} csra_slot;
+
+typedef struct {
+  csra_slot* slots;
+  size_t   capacity;
+  size_t   mask;
+  size_t   size;
+  char*    arena;
+  size_t   arena_used;
+  size_t   arena_capacity;
+} csra_map;
+
+// csrh_hash64 (FNV-1a) and the length in one pass; never 0
+static inline uint64_t csra_hash64(const char* s, uint32_t* length) {
+  const char* p = s;
+  uint64_t h = 1469598103934665603ULL;
+  while (*p) {
+    h ^= (unsigned char)*p++;
+    h *= 1099511628211ULL;
+  }
+  *length = (uint32_t)(p - s);
+  return h ? h : 1;
+}
+
+static inline size_t csra_probe_distance(const size_t slot_index, const size_t ideal_index, const size_t mask) {
+  return (slot_index + (mask + 1) - ideal_index) & mask;
+}
+
+static inline bool csra_equal(const csra_map* m, const csra_slot* s, const uint64_t h,
+                              const char* key, const uint32_t length) {
+  return s->hash == h && s->length == length && memcmp(m->arena + s->offset, key, length) == 0;
+}
+
+// arena_bytes is a first guess, the arena grows as needed
+static inline bool csra_init(csra_map* m, const size_t capacity, size_t arena_bytes) {
+  size_t cap = 1;
+  while (cap < capacity) cap <<= 1;
+  if (arena_bytes == 0) arena_bytes = 4096;
+
+  m->slots = ps_aligned_alloc(cap * sizeof(csra_slot), 64);
+  m->arena = malloc(arena_bytes);
+  if (!m->slots || !m->arena) {
+    ps_aligned_free(m->slots);
+    free(m->arena);
+    return false;
+  }
+
+  memset(m->slots, 0, cap * sizeof(csra_slot));
+
+  m->capacity = cap;
+  m->mask = cap - 1;
+  m->size = 0;
+  m->arena_used = 0;
+  m->arena_capacity = arena_bytes;
+  return true;
+}
+
+static inline void csra_free(csra_map* m) {
+  ps_aligned_free(m->slots);
+  free(m->arena);
+  memset(m, 0, sizeof(*m));
+}
+
+static inline void csra_clear(csra_map* m) {
+  memset(m->slots, 0, m->capacity * sizeof(csra_slot));
+  m->size = 0;
+  m->arena_used = 0;
+}
+
+// Copies key into the arena, false when it is full and cannot grow
+static inline bool csra_store(csra_map* m, const char* key, const uint32_t length, uint32_t* offset) {
+  if (m->arena_used + length > m->arena_capacity) {
+    size_t cap = m->arena_capacity * 2;
+    while (cap < m->arena_used + length) cap *= 2;
+    if (cap > UINT32_MAX) return false;
+
+    char* arena = realloc(m->arena, cap);
+    if (!arena) return false;
+    m->arena = arena;
+    m->arena_capacity = cap;
+  }
+
+  memcpy(m->arena + m->arena_used, key, length);
+  *offset = (uint32_t)m->arena_used;
+  m->arena_used += length;
+  return true;
+}
+
+static inline bool csra_set(csra_map* m, const char* key, uint64_t value) {
+  if (m->size * 2 >= m->capacity) {
+    return false; // no resize implemented
+  }
+
+  uint32_t length;
+  const uint64_t h0 = csra_hash64(key, &length);
+  size_t idx = h0 & m->mask;
+  size_t dist = 0;
+
+  // Update in place if present, the key is only copied for a new entry
+  while (1) {
+    const csra_slot* s = &m->slots[idx];
+    if (s->hash == 0 || csra_probe_distance(idx, s->hash & m->mask, m->mask) < dist) break;
+
+    if (csra_equal(m, s, h0, key, length)) {
+      m->slots[idx].value = value;
+      return true;
+    }
+
+    idx = (idx + 1) & m->mask;
+    dist++;
+  }
+
+  csra_slot entry = { .hash = h0, .length = length, .value = value };
+  if (!csra_store(m, key, length, &entry.offset)) return false;
+
+  // Robin Hood placement from the first slot the key could take
+  while (1) {
+    csra_slot* s = &m->slots[idx];
+
+    if (s->hash == 0) {
+      *s = entry;
+      m->size++;
+      return true;
+    }
+
+    const size_t s_dist = csra_probe_distance(idx, s->hash & m->mask, m->mask);
+    if (s_dist < dist) {
+      const csra_slot tmp = *s;
+      *s = entry;
+      entry = tmp;
+      dist = s_dist;
+    }
+
+    idx = (idx + 1) & m->mask;
+    dist++;
+  }
+}
+
+// Slot index of key, or capacity if absent
+static inline size_t csra_find(const csra_map* m, const char* key) {
+  uint32_t length;
+  const uint64_t h = csra_hash64(key, &length);
+  size_t idx = h & m->mask;
+  size_t dist = 0;
+
+  while (1) {
+    const csra_slot* s = &m->slots[idx];
+
+    if (s->hash == 0)
+      return m->capacity;
+
+    if (csra_equal(m, s, h, key, length))
+      return idx;
+
+    if (csra_probe_distance(idx, s->hash & m->mask, m->mask) < dist)
+      return m->capacity;
+
+    idx = (idx + 1) & m->mask;
+    dist++;
+  }
+}
+
+static inline bool csra_contains(const csra_map* m, const char* key) {
+  return csra_find(m, key) != m->capacity;
+}
+
+static inline bool csra_get(const csra_map* m, const char* const key, uint64_t* out) {
+  const size_t idx = csra_find(m, key);
+  if (idx == m->capacity) return false;
+
+  *out = m->slots[idx].value;
+  return true;
+}
+
+static inline bool csra_delete(csra_map* m, const char* key) {
+  size_t idx = csra_find(m, key);
+  if (idx == m->capacity) return false;
+
+  // backward shift
+  size_t next = (idx + 1) & m->mask;
+
+  while (1) {
+    const csra_slot* s = &m->slots[next];
+
+    if (s->hash == 0 || csra_probe_distance(next, s->hash & m->mask, m->mask) == 0)
+      break;
+
+    m->slots[idx] = *s;
+    idx = next;
+    next = (next + 1) & m->mask;
+  }
+
+  m->slots[idx].hash = 0;
+  m->size--;
+  return true;
+}
+
+#endif // PACKED_STRING_CS_ROBINHOOD_ARENA_H
@@ -1,6 +1,8 @@
 #ifndef PACKED_STRING_CS_ROBINHOOD_H
 #define PACKED_STRING_CS_ROBINHOOD_H
 
+#include "../packed16/aligned.h"
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,7 +31,7 @@ static inline uint64_t csrh_hash64(const char* s) {
 }
 
 static inline uint16_t csrh_fp(const uint64_t h) {
-  const uint16_t f = (uint16_t)h;
+  const uint16_t f = (uint16_t)(h >> 48);   // the slot index uses the low bits
   return f ? f : 1;   // avoid 0
 }
 
@@ -45,7 +47,7 @@ static inline bool csrh_init(csrh_map* m, const size_t capacity) {
   size_t cap = 1;
   while (cap < capacity) cap <<= 1;
 
-  m->slots = _aligned_malloc(cap * sizeof(csrh_slot), 64);
+  m->slots = ps_aligned_alloc(cap * sizeof(csrh_slot), 64);
   if (!m->slots) return false;
 
   memset(m->slots, 0, cap * sizeof(csrh_slot));
@@ -57,7 +59,7 @@ static inline bool csrh_init(csrh_map* m, const size_t capacity) {
 }
 
 static inline void csrh_free(csrh_map* m) {
-  free(m->slots);
+  ps_aligned_free(m->slots);
   m->slots = NULL;
   m->capacity = 0;
   m->size = 0;
@@ -0,0 +1,104 @@
+/**
+ * @file perfect-gen.c
+ * Generate a perfect hash header from a newline-delimited keyword list.
+ *
+ * Usage: perfect-gen <name> [keywords.txt [name.h]]
+ *
+ * Reads stdin and writes stdout when the files are left out. Keyword ids
+ * are their line numbers (0-based), blank lines are skipped without
+ * consuming an id.
+ */
+#include "../packed16/packed-string.h"
+#include "ps-perfect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(const int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "usage: %s <name> [keywords.txt [name.h]]\n", argv[0]);
+        return 2;
+    }
+
+    int status = 1;
+    FILE* in = argc >= 3 ? fopen(argv[2], "r") : stdin;
+    FILE* out = NULL;
+    size_t n = 0, cap = 256;
+    ps_t* keys = malloc(cap * sizeof(ps_t));
+    psph_map map = {0};
+    char line[256];
+    char temp[4096];
+
+    if (!in) {
+        perror(argv[2]);
+        goto done;
+    }
+    if (!keys) {
+        fprintf(stderr, "out of memory\n");
+        goto done;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        const ps_t ps = ps_pack(line);
+        if (!ps_valid(ps)) {
+            fprintf(stderr, "invalid keyword: '%s'\n", line);
+            goto done;
+        }
+
+        if (n == cap) {
+            ps_t* grown = realloc(keys, cap * 2 * sizeof(ps_t));
+            if (!grown) {
+                fprintf(stderr, "out of memory\n");
+                goto done;
+            }
+            keys = grown;
+            cap *= 2;
+        }
+        keys[n++] = ps;
+    }
+    if (ferror(in)) {
+        perror(argc >= 3 ? argv[2] : "stdin");
+        goto done;
+    }
+
+    if (!psph_build(&map, keys, n)) {
+        fprintf(stderr, "cannot build perfect hash (duplicate keyword?)\n");
+        goto done;
+    }
+
+    // name.h is written next to itself and renamed into place, so a build
+    // never picks up a half-written header
+    if (argc == 4) {
+        const int len = snprintf(temp, sizeof(temp), "%s.tmp", argv[3]);
+        if (len < 0 || (size_t)len >= sizeof(temp)) {
+            fprintf(stderr, "path too long: %s\n", argv[3]);
+            goto done;
+        }
+    }
+    out = argc == 4 ? fopen(temp, "w") : stdout;
+    if (!out) {
+        perror(temp);
+        goto done;
+    }
+
+    if (psph_emit_header(&map, out, argv[1]) && fflush(out) == 0) status = 0;
+    else fprintf(stderr, "cannot write %s\n", argc == 4 ? argv[3] : "stdout");
+
+done:
+    psph_free(&map);
+    free(keys);
+    if (in && in != stdin) fclose(in);
+    if (out && out != stdout) {
+        if (fclose(out) != 0) status = 1;
+        if (status == 0 && rename(temp, argv[3]) != 0) {
+            perror(argv[3]);
+            status = 1;
+        }
+        if (status != 0) remove(temp);
+    }
+    return status;
+}
@@ -0,0 +1,365 @@
+#ifndef PACKED_STRING_PS_FLAT_MAP_HPP
+#define PACKED_STRING_PS_FLAT_MAP_HPP
+
+#include "../packed16/aligned.h"
+#include "../packed16/packed-string.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// psrh_map over any value type (and key type), C++20.
+//
+// Same Robin Hood table as ps-robinhood.h: linear probing, a 16-bit
+// fingerprint of the hash per slot (0 = empty) checked before the key,
+// probe distances from rehashing the resident key, backward-shift
+// delete. Unlike psrh_map it owns its values and grows by itself.
+//
+// Values are constructed in their slot and only ever moved: inserting in
+// front of richer keys shifts the rest of the cluster one slot up with
+// move construction, which places every key where psrh_set's swap chain
+// would, and erase shifts the cluster back down. The moves must not
+// throw, so K needs a nothrow copy (the key is const in value_type) and
+// V a nothrow move. References and iterators are invalidated by every
+// insert of a new key and every erase, as in any open addressing table;
+// try_emplace of a key already present leaves them alone.
+
+namespace ps {
+
+template <class V, class K = packed, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+class flat_map {
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<const K, V>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+  static_assert(std::is_nothrow_move_constructible_v<value_type>,
+                "ps::flat_map moves entries between slots: K must be nothrow copy "
+                "constructible and V nothrow move constructible");
+
+private:
+  struct slot {
+    uint16_t fp;   // 0 = empty
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    value_type* kv() noexcept { return std::launder(reinterpret_cast<value_type*>(storage)); }
+    const value_type* kv() const noexcept {
+      return std::launder(reinterpret_cast<const value_type*>(storage));
+    }
+  };
+
+  template <bool Const>
+  class basic_iterator {
+    using slot_ptr = std::conditional_t<Const, const slot*, slot*>;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = flat_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+    using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+    basic_iterator() noexcept = default;
+    basic_iterator(const slot_ptr s, const slot_ptr end) noexcept : s_(s), end_(end) { skip(); }
+
+    // iterator converts to const_iterator
+    template <bool C = Const, class = std::enable_if_t<C>>
+    basic_iterator(const basic_iterator<false>& it) noexcept : s_(it.s_), end_(it.end_) {}
+
+    reference operator*() const noexcept { return *s_->kv(); }
+    pointer operator->() const noexcept { return s_->kv(); }
+
+    basic_iterator& operator++() noexcept {
+      ++s_;
+      skip();
+      return *this;
+    }
+
+    basic_iterator operator++(int) noexcept {
+      basic_iterator it = *this;
+      ++*this;
+      return it;
+    }
+
+    friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept {
+      return a.s_ == b.s_;
+    }
+
+  private:
+    friend class flat_map;
+
+    void skip() noexcept {
+      while (s_ != end_ && s_->fp == 0) ++s_;
+    }
+
+    slot_ptr s_ = nullptr;
+    slot_ptr end_ = nullptr;
+  };
+
+public:
+  using iterator = basic_iterator<false>;
+  using const_iterator = basic_iterator<true>;
+
+  flat_map() noexcept = default;
+
+  explicit flat_map(const size_type n) { reserve(n); }
+
+  flat_map(const flat_map&) = delete;
+  flat_map& operator=(const flat_map&) = delete;
+
+  flat_map(flat_map&& other) noexcept
+      : slots_(std::exchange(other.slots_, nullptr)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  flat_map& operator=(flat_map&& other) noexcept {
+    if (this != &other) {
+      release();
+      slots_ = std::exchange(other.slots_, nullptr);
+      capacity_ = std::exchange(other.capacity_, 0);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~flat_map() { release(); }
+
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  size_type capacity() const noexcept { return capacity_; }
+
+  iterator begin() noexcept { return iterator(slots_, slots_ + capacity_); }
+  iterator end() noexcept { return iterator(slots_ + capacity_, slots_ + capacity_); }
+  const_iterator begin() const noexcept { return const_iterator(slots_, slots_ + capacity_); }
+  const_iterator end() const noexcept { return const_iterator(slots_ + capacity_, slots_ + capacity_); }
+
+  // Destroys every value, keeps the slots
+  void clear() noexcept {
+    for (size_type i = 0; i < capacity_; i++) {
+      if (slots_[i].fp) {
+        slots_[i].kv()->~value_type();
+        slots_[i].fp = 0;
+      }
+    }
+    size_ = 0;
+  }
+
+  // Room for n keys without growing
+  void reserve(const size_type n) {
+    size_type cap = 16;
+    while (cap * MAX_LOAD_NUM < n * MAX_LOAD_DEN) cap <<= 1;
+    if (cap > capacity_) rehash(cap);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+    const uint64_t h = hash_of(key);
+    const uint16_t fp = fp_of(h);
+    bool found = false;
+
+    size_type idx = capacity_ ? probe(key, h, fp, found) : 0;
+    if (found) return { make_iterator(idx), false };
+
+    // Grow only for a new key, then probe the new table again
+    if ((size_ + 1) * MAX_LOAD_DEN > capacity_ * MAX_LOAD_NUM) {
+      rehash(capacity_ ? capacity_ * 2 : 16);
+      idx = probe(key, h, fp, found);
+    }
+
+    make_room(idx);
+    try {
+      ::new (static_cast<void*>(slots_[idx].storage))
+        value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    } catch (...) {
+      close_gap(idx);
+      throw;
+    }
+    slots_[idx].fp = fp;
+    size_++;
+    return { make_iterator(idx), true };
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+    auto r = try_emplace(key, std::forward<M>(value));
+    if (!r.second) r.first->second = std::forward<M>(value);
+    return r;
+  }
+
+  V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+  iterator find(const K& key) noexcept { return make_iterator(find_index(key)); }
+  const_iterator find(const K& key) const noexcept { return make_const_iterator(find_index(key)); }
+  bool contains(const K& key) const noexcept { return find_index(key) != capacity_; }
+
+  V& at(const K& key) {
+    const size_type idx = find_index(key);
+    if (idx == capacity_) throw std::out_of_range("ps::flat_map::at");
+    return slots_[idx].kv()->second;
+  }
+
+  const V& at(const K& key) const {
+    const size_type idx = find_index(key);
+    if (idx == capacity_) throw std::out_of_range("ps::flat_map::at");
+    return slots_[idx].kv()->second;
+  }
+
+  size_type erase(const K& key) {
+    size_type idx = find_index(key);
+    if (idx == capacity_) return 0;
+
+    slots_[idx].kv()->~value_type();
+    slots_[idx].fp = 0;
+    close_gap(idx);
+    size_--;
+    return 1;
+  }
+
+private:
+  // Grow at 7/8 full, probe lengths stay short thanks to Robin Hood
+  static constexpr size_type MAX_LOAD_NUM = 7;
+  static constexpr size_type MAX_LOAD_DEN = 8;
+
+  static uint64_t hash_of(const K& key) noexcept { return (uint64_t)Hash{}(key); }
+
+  // psrh_fp: the slot index uses the low bits
+  static uint16_t fp_of(const uint64_t h) noexcept {
+    const uint16_t f = (uint16_t)(h >> 48);
+    return f ? f : 1;
+  }
+
+  size_type mask() const noexcept { return capacity_ - 1; }
+
+  size_type distance(const size_type idx, const slot& s) const noexcept {
+    return (idx + capacity_ - (hash_of(s.kv()->first) & mask())) & mask();
+  }
+
+  iterator make_iterator(const size_type idx) noexcept {
+    iterator it = end();
+    it.s_ = slots_ + idx;
+    return it;
+  }
+
+  const_iterator make_const_iterator(const size_type idx) const noexcept {
+    const_iterator it = end();
+    it.s_ = slots_ + idx;
+    return it;
+  }
+
+  // Moves src into the empty dst and leaves src empty, cannot throw (see the
+  // static_assert above)
+  static void relocate(slot& dst, slot& src) noexcept {
+    ::new (static_cast<void*>(dst.storage)) value_type(std::move(*src.kv()));
+    src.kv()->~value_type();
+    dst.fp = src.fp;
+    src.fp = 0;
+  }
+
+  // Empties slot idx by shifting the cluster from idx up by one
+  void make_room(const size_type idx) noexcept {
+    size_type free = idx;
+    while (slots_[free].fp != 0) free = (free + 1) & mask();
+
+    while (free != idx) {
+      const size_type prev = (free + capacity_ - 1) & mask();
+      relocate(slots_[free], slots_[prev]);
+      free = prev;
+    }
+  }
+
+  // Backward shift into the empty slot idx, undoes make_room
+  void close_gap(size_type idx) noexcept {
+    size_type next = (idx + 1) & mask();
+    while (slots_[next].fp != 0 && distance(next, slots_[next]) != 0) {
+      relocate(slots_[idx], slots_[next]);
+      idx = next;
+      next = (next + 1) & mask();
+    }
+  }
+
+  // Slot of key (found = true), else the first slot that is empty or holds
+  // a richer key, where key would go. Needs capacity_ > 0.
+  size_type probe(const K& key, const uint64_t h, const uint16_t fp, bool& found) const noexcept {
+    size_type idx = h & mask();
+    size_type dist = 0;
+
+    while (slots_[idx].fp != 0) {
+      const slot& s = slots_[idx];
+      if (s.fp == fp && KeyEqual{}(s.kv()->first, key)) {
+        found = true;
+        return idx;
+      }
+      if (distance(idx, s) < dist) break;
+
+      idx = (idx + 1) & mask();
+      dist++;
+    }
+
+    found = false;
+    return idx;
+  }
+
+  size_type find_index(const K& key) const noexcept {
+    if (size_ == 0) return capacity_;
+
+    const uint64_t h = hash_of(key);
+    bool found = false;
+    const size_type idx = probe(key, h, fp_of(h), found);
+    return found ? idx : capacity_;
+  }
+
+  void rehash(const size_type cap) {
+    slot* slots = static_cast<slot*>(ps_aligned_alloc(cap * sizeof(slot), 64));
+    if (!slots) throw std::bad_alloc();
+    for (size_type i = 0; i < cap; i++) slots[i].fp = 0;
+
+    slot* old = slots_;
+    const size_type old_capacity = capacity_;
+    slots_ = slots;
+    capacity_ = cap;
+
+    // Keys are known distinct, only the Robin Hood placement is needed
+    for (size_type i = 0; i < old_capacity; i++) {
+      if (old[i].fp == 0) continue;
+
+      size_type idx = hash_of(old[i].kv()->first) & mask();
+      size_type dist = 0;
+      while (slots_[idx].fp != 0 && distance(idx, slots_[idx]) >= dist) {
+        idx = (idx + 1) & mask();
+        dist++;
+      }
+
+      make_room(idx);
+      relocate(slots_[idx], old[i]);
+    }
+
+    ps_aligned_free(old);
+  }
+
+  void release() noexcept {
+    if (!slots_) return;
+    clear();
+    ps_aligned_free(slots_);
+    slots_ = nullptr;
+    capacity_ = 0;
+  }
+
+  slot* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+};
+
+} // namespace ps
+
+#endif // PACKED_STRING_PS_FLAT_MAP_HPP
@@ -0,0 +1,231 @@
+#ifndef PACKED_STRING_PS_INTERN_H
+#define PACKED_STRING_PS_INTERN_H
+
+#include "../packed16/packed-string.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Interning pool: maps packed strings to dense 32-bit symbol ids and back.
+//
+// Symbols live in segments indexed by id, the hash index only stores
+// (hash, id + 1) pairs so probing never touches the symbols until the
+// 32-bit hashes match. Segment k holds base << k symbols and is never
+// moved, growing adds the next segment and rebuilds the index.
+//
+// Thread-safe mode (chosen at init) puts intern, intern_many and find
+// under one spinlock. psin_lookup and psin_size never take it: a symbol
+// is written before count is published with release order, so a reader
+// that sees an id below count also sees its symbol and segment.
+
+#define PSIN_NONE UINT32_MAX
+#define PSIN_SEGMENTS 32   // base << 31 symbols, past the 32-bit ids
+
+typedef struct {
+  uint32_t hash;
+  uint32_t id;     // id + 1, 0 = empty
+} psin_slot;
+
+typedef struct {
+  ps_t*      segments[PSIN_SEGMENTS];   // id -> packed string
+  psin_slot* index;
+  atomic_size_t count;
+  size_t     base;      // symbols in segment 0, a power of two
+  size_t     used;      // segments allocated
+  size_t     capacity;  // symbols allocated, base * (2^used - 1)
+  size_t     mask;      // index size - 1
+  bool       thread_safe;
+  atomic_flag lock;
+} psin_pool;
+
+static inline uint64_t psin_hash64(const ps_t k) {
+  return ps_mix64(k.lo, k.hi);
+}
+
+static inline void psin_acquire(psin_pool* p) {
+  if (!p->thread_safe) return;
+  while (atomic_flag_test_and_set_explicit(&p->lock, memory_order_acquire)) { }
+}
+
+static inline void psin_release(psin_pool* p) {
+  if (!p->thread_safe) return;
+  atomic_flag_clear_explicit(&p->lock, memory_order_release);
+}
+
+// Slot of symbol id, its segment must exist
+static inline ps_t* psin_symbol(const psin_pool* p, const size_t id) {
+  // Segment k holds ids whose (id / base + 1) has its top bit at k
+  const uint64_t q = (uint64_t)(id / p->base) + 1;
+#if defined(__GNUC__) || defined(__clang__)
+  const unsigned k = 63 - (unsigned)__builtin_clzll(q);
+#else
+  unsigned k = 0;
+  while (q >> (k + 1)) k++;
+#endif
+  return &p->segments[k][id - p->base * (((size_t)1 << k) - 1)];
+}
+
+static inline bool psin_init(psin_pool* p, const size_t capacity, const bool thread_safe) {
+  size_t cap = 16;
+  while (cap < capacity) cap <<= 1;
+
+  memset(p->segments, 0, sizeof(p->segments));
+  p->segments[0] = malloc(cap * sizeof(ps_t));
+  p->index = calloc(cap * 2, sizeof(psin_slot));
+  if (!p->segments[0] || !p->index) {
+    free(p->segments[0]);
+    free(p->index);
+    return false;
+  }
+
+  atomic_init(&p->count, 0);
+  p->base = cap;
+  p->used = 1;
+  p->capacity = cap;
+  p->mask = cap * 2 - 1;
+  p->thread_safe = thread_safe;
+  atomic_flag_clear(&p->lock);
+  return true;
+}
+
+static inline void psin_free(psin_pool* p) {
+  for (size_t k = 0; k < p->used; k++) {
+    free(p->segments[k]);
+    p->segments[k] = NULL;
+  }
+  free(p->index);
+  p->index = NULL;
+  atomic_store_explicit(&p->count, 0, memory_order_relaxed);
+  p->used = 0;
+  p->capacity = 0;
+  p->mask = 0;
+}
+
+static inline size_t psin_size(const psin_pool* p) {
+  return atomic_load_explicit(&p->count, memory_order_acquire);
+}
+
+// Index slot holding key, or the empty slot where it belongs
+static inline psin_slot* psin_probe(const psin_pool* p, const ps_t key, const uint32_t hash) {
+  size_t idx = hash & p->mask;
+
+  while (1) {
+    psin_slot* s = &p->index[idx];
+
+    if (s->id == 0)
+      return s;
+
+    if (s->hash == hash && ps_equal(*psin_symbol(p, s->id - 1), key))
+      return s;
+
+    idx = (idx + 1) & p->mask;
+  }
+}
+
+// Adds the next segment, the index is rebuilt from stored hashes at
+// twice the capacity or more
+static inline bool psin_grow(psin_pool* p) {
+  if (p->used == PSIN_SEGMENTS) return false;
+
+  const size_t added = p->base << p->used;
+  const size_t cap = p->capacity + added;
+  size_t slots = (p->mask + 1) * 2;
+  while (slots < cap * 2) slots <<= 1;
+
+  ps_t* segment = malloc(added * sizeof(ps_t));
+  psin_slot* index = calloc(slots, sizeof(psin_slot));
+  if (!segment || !index) {
+    free(segment);
+    free(index);
+    return false;
+  }
+
+  const size_t mask = slots - 1;
+  for (size_t i = 0; i <= p->mask; i++) {
+    const psin_slot s = p->index[i];
+    if (s.id == 0) continue;
+
+    size_t idx = s.hash & mask;
+    while (index[idx].id != 0) idx = (idx + 1) & mask;
+    index[idx] = s;
+  }
+
+  free(p->index);
+  p->segments[p->used++] = segment;
+  p->index = index;
+  p->capacity = cap;
+  p->mask = mask;
+  return true;
+}
+
+static inline uint32_t psin_intern_unlocked(psin_pool* p, const ps_t key) {
+  const uint32_t hash = (uint32_t)psin_hash64(key);
+  psin_slot* s = psin_probe(p, key, hash);
+
+  if (s->id != 0)
+    return s->id - 1;
+
+  // Only writer, under the lock in thread-safe mode
+  const size_t count = atomic_load_explicit(&p->count, memory_order_relaxed);
+  if (count >= PSIN_NONE - 1)
+    return PSIN_NONE;
+
+  if (count == p->capacity) {
+    if (!psin_grow(p)) return PSIN_NONE;
+    s = psin_probe(p, key, hash);
+  }
+
+  const uint32_t id = (uint32_t)count;
+  *psin_symbol(p, id) = key;
+  s->hash = hash;
+  s->id = id + 1;
+  atomic_store_explicit(&p->count, count + 1, memory_order_release);
+  return id;
+}
+
+// Id of key, interning it first if needed. PSIN_NONE on allocation failure.
+static inline uint32_t psin_intern(psin_pool* p, const ps_t key) {
+  psin_acquire(p);
+  const uint32_t id = psin_intern_unlocked(p, key);
+  psin_release(p);
+  return id;
+}
+
+// Intern n keys under a single lock. Returns how many were interned,
+// ids of keys past a failure are set to PSIN_NONE.
+static inline size_t psin_intern_many(psin_pool* p, const ps_t* keys, const size_t n, uint32_t* ids) {
+  psin_acquire(p);
+
+  size_t done = 0;
+  for (; done < n; done++) {
+    ids[done] = psin_intern_unlocked(p, keys[done]);
+    if (ids[done] == PSIN_NONE) break;
+  }
+
+  for (size_t i = done; i < n; i++)
+    ids[i] = PSIN_NONE;
+
+  psin_release(p);
+  return done;
+}
+
+// Id of key without interning it
+static inline bool psin_find(psin_pool* p, const ps_t key, uint32_t* out) {
+  psin_acquire(p);
+  const psin_slot* s = psin_probe(p, key, (uint32_t)psin_hash64(key));
+  const bool found = s->id != 0;
+  if (found) *out = s->id - 1;
+  psin_release(p);
+  return found;
+}
+
+// Packed string of id, PACKED_STRING_INVALID if id was never handed out.
+// Lock-free, see the top of the file.
+static inline ps_t psin_lookup(const psin_pool* p, const uint32_t id) {
+  return id < psin_size(p) ? *psin_symbol(p, id) : PACKED_STRING_INVALID;
+}
+
+#endif // PACKED_STRING_PS_INTERN_H
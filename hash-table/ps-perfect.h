@@ -0,0 +1,286 @@
+#ifndef PACKED_STRING_PS_PERFECT_H
+#define PACKED_STRING_PS_PERFECT_H
+
+#include "../packed16/packed-string.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Minimal perfect hash over a static set of packed strings (PTHash style).
+//
+// Keys are split into buckets by the high half of one 64-bit hash, and each
+// bucket gets a pilot so that every key lands on its own slot:
+//
+//   h    = psph_hash64(key, seed)
+//   slot = range(mix(lo32(h) ^ mix(pilots[range(hi32(h), buckets)])), capacity)
+//
+// capacity == n, so a lookup is one hash, one pilot load and one ps_equal.
+
+#define PSPH_BUCKET_SIZE   4      // average keys per bucket
+#define PSPH_MAX_SEEDS     64     // seeds tried before giving up
+
+typedef struct {
+  ps_t*     keys;       // slot -> key
+  uint32_t* ids;        // slot -> index in the build array
+  uint32_t* pilots;     // bucket -> pilot
+  uint64_t  seed;
+  uint32_t  capacity;   // == number of keys
+  uint32_t  buckets;
+} psph_map;
+
+static inline uint64_t psph_hash64(const ps_t k, const uint64_t seed) {
+  return ps_mix64(k.lo ^ seed, k.hi);
+}
+
+static inline uint32_t psph_pilot_hash(const uint32_t pilot) {
+  uint64_t x = (uint64_t)pilot * 0x9E3779B97F4A7C15ULL;
+  x ^= x >> 32;
+  x *= 0xd6e8feb86659fd93ULL;
+  x ^= x >> 32;
+  return (uint32_t)x;
+}
+
+// Map x uniformly onto [0, n) without a division
+static inline uint32_t psph_range(const uint32_t x, const uint32_t n) {
+  return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static inline uint32_t psph_bucket(const psph_map* m, const uint64_t h) {
+  return psph_range((uint32_t)(h >> 32), m->buckets);
+}
+
+// Mixed after the xor: psph_range keeps the high bits only, so two keys of
+// a bucket whose low halves agree there would share a slot for every pilot
+static inline uint32_t psph_position(const psph_map* m, const uint64_t h, const uint32_t pilot) {
+  uint64_t x = ((uint32_t)h ^ psph_pilot_hash(pilot)) * 0x9E3779B97F4A7C15ULL;
+  x ^= x >> 29;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  return psph_range((uint32_t)(x >> 32), m->capacity);
+}
+
+// Slot of key, UINT32_MAX if key is not in the set
+static inline uint32_t psph_slot(const psph_map* m, const ps_t key) {
+  if (m->capacity == 0) return UINT32_MAX;
+
+  const uint64_t h = psph_hash64(key, m->seed);
+  const uint32_t slot = psph_position(m, h, m->pilots[psph_bucket(m, h)]);
+
+  return ps_equal(m->keys[slot], key) ? slot : UINT32_MAX;
+}
+
+static inline bool psph_contains(const psph_map* m, const ps_t key) {
+  return psph_slot(m, key) != UINT32_MAX;
+}
+
+// Index of key in the array psph_build was given
+static inline bool psph_get(const psph_map* m, const ps_t key, uint32_t* out) {
+  const uint32_t slot = psph_slot(m, key);
+  if (slot == UINT32_MAX) return false;
+
+  *out = m->ids[slot];
+  return true;
+}
+
+static inline void psph_free(psph_map* m) {
+  free(m->keys);
+  free(m->ids);
+  free(m->pilots);
+  memset(m, 0, sizeof(*m));
+}
+
+// Try to place every bucket with the current seed.
+// order: key indices grouped by bucket, start: bucket -> first entry in order,
+// buckets are visited from largest to smallest through by_size.
+static inline bool psph_place(psph_map* m, const ps_t* keys, const uint64_t* hashes,
+  const uint32_t* order, const uint32_t* start, const uint32_t* by_size,
+  uint8_t* taken, uint32_t* positions) {
+  const uint32_t n = m->capacity;
+  const uint32_t max_pilot = n * 8 + 65536;
+
+  memset(taken, 0, n);
+
+  for (uint32_t b = 0; b < m->buckets; b++) {
+    const uint32_t bucket = by_size[b];
+    const uint32_t first = start[bucket];
+    const uint32_t size = start[bucket + 1] - first;
+    if (size == 0) break;   // the remaining buckets are empty
+
+    uint32_t pilot = 0;
+    for (; pilot < max_pilot; pilot++) {
+      uint32_t i = 0;
+
+      for (; i < size; i++) {
+        const uint32_t pos = psph_position(m, hashes[order[first + i]], pilot);
+        if (taken[pos]) break;
+
+        // Two keys of the same bucket on one slot
+        uint32_t j = 0;
+        while (j < i && positions[j] != pos) j++;
+        if (j < i) break;
+
+        positions[i] = pos;
+      }
+
+      if (i == size) break;
+    }
+
+    if (pilot == max_pilot) return false;
+
+    m->pilots[bucket] = pilot;
+    for (uint32_t i = 0; i < size; i++) {
+      const uint32_t k = order[first + i];
+      taken[positions[i]] = 1;
+      m->keys[positions[i]] = keys[k];
+      m->ids[positions[i]] = k;
+    }
+  }
+
+  return true;
+}
+
+// Build from n distinct keys. Returns false on duplicates or allocation failure.
+static inline bool psph_build(psph_map* m, const ps_t* keys, const size_t n) {
+  memset(m, 0, sizeof(*m));
+  if (n == 0) return true;
+  if (n >= UINT32_MAX) return false;
+
+  m->capacity = (uint32_t)n;
+  m->buckets = (uint32_t)(n / PSPH_BUCKET_SIZE) + 1;
+
+  m->keys = malloc(n * sizeof(ps_t));
+  m->ids = malloc(n * sizeof(uint32_t));
+  m->pilots = malloc(m->buckets * sizeof(uint32_t));
+
+  uint64_t* hashes = malloc(n * sizeof(uint64_t));
+  uint32_t* bucket_of = malloc(n * sizeof(uint32_t));
+  uint32_t* order = malloc(n * sizeof(uint32_t));
+  uint32_t* start = malloc((m->buckets + 1) * sizeof(uint32_t));
+  uint32_t* by_size = malloc(m->buckets * sizeof(uint32_t));
+  uint32_t* size_start = malloc((n + 2) * sizeof(uint32_t));
+  uint8_t* taken = malloc(n);
+  uint32_t* positions = malloc(n * sizeof(uint32_t));
+
+  bool ok = m->keys && m->ids && m->pilots && hashes && bucket_of && order
+    && start && by_size && size_start && taken && positions;
+
+  for (uint32_t s = 0; ok; s++) {
+    if (s == PSPH_MAX_SEEDS) { ok = false; break; }
+    m->seed = psph_hash64(ps_from(s, 0x5053504800000000ULL), 0);
+
+    // Counting sort of keys by bucket
+    memset(start, 0, (m->buckets + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+      hashes[i] = psph_hash64(keys[i], m->seed);
+      bucket_of[i] = psph_bucket(m, hashes[i]);
+      start[bucket_of[i] + 1]++;
+    }
+
+    uint32_t max_size = 0;
+    for (uint32_t b = 0; b < m->buckets; b++) {
+      const uint32_t size = start[b + 1];
+      if (size > max_size) max_size = size;
+      start[b + 1] += start[b];
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+      order[start[bucket_of[i]]++] = i;
+
+    // start[b] now points past bucket b, shift it back
+    memmove(start + 1, start, m->buckets * sizeof(uint32_t));
+    start[0] = 0;
+
+    // Equal hashes inside a bucket are either duplicates or need a new seed
+    bool collision = false;
+    for (uint32_t b = 0; b < m->buckets && !collision; b++) {
+      for (uint32_t i = start[b]; i < start[b + 1] && !collision; i++) {
+        for (uint32_t j = start[b]; j < i; j++) {
+          if ((uint32_t)hashes[order[i]] != (uint32_t)hashes[order[j]]) continue;
+
+          if (ps_equal(keys[order[i]], keys[order[j]])) ok = false;
+          collision = true;
+          break;
+        }
+      }
+    }
+    if (!ok) break;
+    if (collision) continue;
+
+    // Counting sort of buckets by size, largest first
+    memset(size_start, 0, (max_size + 2) * sizeof(uint32_t));
+    for (uint32_t b = 0; b < m->buckets; b++)
+      size_start[max_size - (start[b + 1] - start[b]) + 1]++;
+    for (uint32_t k = 0; k <= max_size; k++)
+      size_start[k + 1] += size_start[k];
+    for (uint32_t b = 0; b < m->buckets; b++)
+      by_size[size_start[max_size - (start[b + 1] - start[b])]++] = b;
+
+    if (psph_place(m, keys, hashes, order, start, by_size, taken, positions))
+      break;
+  }
+
+  free(hashes);
+  free(bucket_of);
+  free(order);
+  free(start);
+  free(by_size);
+  free(size_start);
+  free(taken);
+  free(positions);
+
+  if (!ok) psph_free(m);
+  return ok;
+}
+
+// Write the map as a C header: {lo, hi} key constants, ids and pilot table,
+// wrapped in a static psph_map named `name` usable with psph_get.
+static inline bool psph_emit_header(const psph_map* m, FILE* out, const char* name) {
+  if (!out || !name) return false;
+
+  fprintf(out,
+    "// Generated by psph_emit_header, do not edit.\n"
+    "#ifndef PSPH_GENERATED_%s\n"
+    "#define PSPH_GENERATED_%s\n\n"
+    "#include \"ps-perfect.h\"\n\n", name, name);
+
+  fprintf(out, "static const ps_t %s_keys[%u] = {\n", name, m->capacity ? m->capacity : 1);
+  for (uint32_t i = 0; i < m->capacity; i++) {
+    char buffer[PACKED_STRING_MAX_LEN + 1];
+    ps_unpack(m->keys[i], buffer);
+    fprintf(out, "  {0x%016llXULL, 0x%016llXULL}, // %s\n",
+      (unsigned long long)m->keys[i].lo, (unsigned long long)m->keys[i].hi, buffer);
+  }
+  if (m->capacity == 0) fprintf(out, "  {0, 0},\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static const uint32_t %s_ids[%u] = {", name, m->capacity ? m->capacity : 1);
+  for (uint32_t i = 0; i < m->capacity; i++)
+    fprintf(out, "%s%u,", i % 16 ? " " : "\n  ", m->ids[i]);
+  if (m->capacity == 0) fprintf(out, "\n  0,");
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out, "static const uint32_t %s_pilots[%u] = {", name, m->buckets ? m->buckets : 1);
+  for (uint32_t i = 0; i < m->buckets; i++)
+    fprintf(out, "%s%u,", i % 16 ? " " : "\n  ", m->pilots[i]);
+  if (m->buckets == 0) fprintf(out, "\n  0,");
+  fprintf(out, "\n};\n\n");
+
+  fprintf(out,
+    "static const psph_map %s = {\n"
+    "  .keys     = (ps_t*)%s_keys,\n"
+    "  .ids      = (uint32_t*)%s_ids,\n"
+    "  .pilots   = (uint32_t*)%s_pilots,\n"
+    "  .seed     = 0x%016llXULL,\n"
+    "  .capacity = %u,\n"
+    "  .buckets  = %u,\n"
+    "};\n\n"
+    "#endif // PSPH_GENERATED_%s\n",
+    name, name, name, name, (unsigned long long)m->seed,
+    m->capacity, m->buckets, name);
+
+  return !ferror(out);
+}
+
+#endif // PACKED_STRING_PS_PERFECT_H
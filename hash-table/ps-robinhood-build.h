@@ -0,0 +1,276 @@
+#ifndef PACKED_STRING_PS_ROBINHOOD_BUILD_H
+#define PACKED_STRING_PS_ROBINHOOD_BUILD_H
+
+#include "ps-robinhood.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define PSRH_BUILD_THREADS 1
+#else
+#define PSRH_BUILD_THREADS 0
+#endif
+
+// Bulk build of a psrh_map from key/value arrays on several threads.
+//
+// The slots are split into one region of home buckets per thread. In a
+// Robin Hood table every cluster holds its keys sorted by home bucket,
+// each as close to home as the ones before it allow, so the layout only
+// depends on the keys, up to the order of keys sharing a home bucket:
+//
+//   1. hash every key and count keys per (chunk of input, region)
+//   2. scatter entries to their region, stable, so in input order
+//   3. per region: clear its slots and insert its keys as psrh_set does,
+//      without wrapping; keys pushed past the region end go to a spill
+//      array that extends the region
+//   4. the spilled keys are placed with the usual Robin Hood displacement
+//      from the start of the next region, one region after the other
+//
+// Step 4 is sequential but only touches the clusters that cross a
+// region boundary. The result holds what n psrh_set calls in input order
+// would, with the same slots taken and the same home bucket in every
+// slot; keys sharing a home bucket may come in another order. POSIX
+// threads; elsewhere the build runs on one thread.
+
+typedef struct {
+  uint64_t hash;
+  size_t   index;    // in keys and values
+} psrh_build_entry;
+
+typedef struct {
+  psrh_map*         m;
+  const ps_t*       keys;
+  const uint64_t*   values;
+  size_t            n;
+  unsigned          threads;
+  size_t            region;     // slots per region
+  psrh_build_entry* hashed;     // n, in input order
+  psrh_build_entry* grouped;    // n, grouped by region, hashed itself for one region
+  size_t*           counts;     // [chunk * threads + region], then scatter cursors
+  size_t*           offsets;    // threads + 1, region starts in grouped
+  psrh_slot**       spill;      // per region, keys past the region end
+  size_t*           spilled;
+  size_t*           spill_capacity;
+  size_t*           distinct;
+  bool              failed;
+} psrh_build_job;
+
+typedef struct {
+  psrh_build_job* job;
+  unsigned        t;
+  void          (*fn)(psrh_build_job*, unsigned);
+} psrh_build_task;
+
+static inline size_t psrh_build_chunk(const psrh_build_job* job, const unsigned t) {
+  return job->n / job->threads * t + (t < job->n % job->threads ? t : job->n % job->threads);
+}
+
+// Step 1: hashes and per-region counts of input chunk t
+static inline void psrh_build_count(psrh_build_job* job, const unsigned t) {
+  size_t* counts = &job->counts[(size_t)t * job->threads];
+  const size_t end = psrh_build_chunk(job, t + 1);
+
+  for (size_t i = psrh_build_chunk(job, t); i < end; i++) {
+    const uint64_t h = psrh_hash64(job->keys[i]);
+    job->hashed[i] = (psrh_build_entry){ h, i };
+    counts[(h & job->m->mask) / job->region]++;
+  }
+}
+
+// Step 2: scatter input chunk t, counts now hold its cursor per region
+static inline void psrh_build_scatter(psrh_build_job* job, const unsigned t) {
+  size_t* cursor = &job->counts[(size_t)t * job->threads];
+  const size_t end = psrh_build_chunk(job, t + 1);
+
+  for (size_t i = psrh_build_chunk(job, t); i < end; i++) {
+    const psrh_build_entry e = job->hashed[i];
+    job->grouped[cursor[(e.hash & job->m->mask) / job->region]++] = e;
+  }
+}
+
+// Robin Hood placement of s from slot idx at probe distance dist
+static inline void psrh_build_place(psrh_map* m, psrh_slot s, size_t idx, size_t dist) {
+  while (m->slots[idx].fp != 0) {
+    const size_t s_dist = psrh_probe_distance(idx, psrh_hash64(m->slots[idx].key) & m->mask, m->mask);
+    if (s_dist < dist) {
+      const psrh_slot tmp = m->slots[idx];
+      m->slots[idx] = s;
+      s = tmp;
+      dist = s_dist;
+    }
+    idx = (idx + 1) & m->mask;
+    dist++;
+  }
+  m->slots[idx] = s;
+}
+
+// Step 3: region t, psrh_set over the region slots followed by its spill
+static inline void psrh_build_region(psrh_build_job* job, const unsigned t) {
+  psrh_map* m = job->m;
+  const size_t first = t * job->region;
+  const size_t last = first + job->region;
+  const psrh_build_entry* in = &job->grouped[job->offsets[t]];
+  const size_t count = job->offsets[t + 1] - job->offsets[t];
+  size_t distinct = 0;
+
+  memset(&m->slots[first], 0, job->region * sizeof(psrh_slot));
+
+  for (size_t i = 0; i < count; i++) {
+    psrh_slot s = { psrh_fp(in[i].hash), job->keys[in[i].index], job->values[in[i].index] };
+    size_t idx = in[i].hash & m->mask;
+    size_t dist = 0;
+
+    while (1) {
+      if (idx == last + job->spilled[t]) {
+        if (job->spilled[t] == job->spill_capacity[t]) {
+          const size_t cap = job->spill_capacity[t] ? job->spill_capacity[t] * 2 : 16;
+          psrh_slot* grown = realloc(job->spill[t], cap * sizeof(psrh_slot));
+          if (!grown) {
+            job->failed = true;
+            return;
+          }
+          job->spill[t] = grown;
+          job->spill_capacity[t] = cap;
+        }
+        job->spill[t][job->spilled[t]++] = s;
+        distinct++;
+        break;
+      }
+
+      psrh_slot* r = idx < last ? &m->slots[idx] : &job->spill[t][idx - last];
+      if (r->fp == 0) {
+        *r = s;
+        distinct++;
+        break;
+      }
+      if (r->fp == s.fp && psrh_equal(r->key, s.key)) {
+        r->value = s.value;
+        break;
+      }
+
+      const size_t r_dist = idx - (psrh_hash64(r->key) & m->mask);
+      if (r_dist < dist) {
+        const psrh_slot tmp = *r;
+        *r = s;
+        s = tmp;
+        dist = r_dist;
+      }
+      idx++;
+      dist++;
+    }
+  }
+
+  job->distinct[t] = distinct;
+}
+
+#if PSRH_BUILD_THREADS
+static inline void* psrh_build_thread(void* arg) {
+  const psrh_build_task* task = arg;
+  task->fn(task->job, task->t);
+  return NULL;
+}
+#endif
+
+// fn for every t, t = 0 on the calling thread
+static inline void psrh_build_run(psrh_build_job* job, void (*fn)(psrh_build_job*, unsigned)) {
+#if PSRH_BUILD_THREADS
+  psrh_build_task tasks[64];
+  pthread_t ids[64];
+  bool started[64] = { false };
+
+  for (unsigned t = 1; t < job->threads; t++) {
+    tasks[t] = (psrh_build_task){ job, t, fn };
+    started[t] = pthread_create(&ids[t], NULL, psrh_build_thread, &tasks[t]) == 0;
+    if (!started[t]) fn(job, t);
+  }
+  fn(job, 0);
+  for (unsigned t = 1; t < job->threads; t++)
+    if (started[t]) pthread_join(ids[t], NULL);
+#else
+  for (unsigned t = 0; t < job->threads; t++) fn(job, t);
+#endif
+}
+
+// Replaces the contents of m with keys[i] -> values[i], as n psrh_set
+// calls in order would (see above); threads = 0 is taken as 1. False if
+// the distinct keys do not fit at psrh_set's load limit or memory runs
+// out, m is left empty then.
+static inline bool psrh_build(psrh_map* m, const ps_t* keys, const uint64_t* values, const size_t n,
+                              unsigned threads) {
+  // Regions of at least 1024 slots, at most 64 of them
+  if (threads == 0 || !PSRH_BUILD_THREADS) threads = 1;
+  if (threads > 64) threads = 64;
+  while (threads > 1 && m->capacity / threads < 1024) threads--;
+  while (m->capacity % threads) threads--;
+
+  psrh_build_job job = {
+    .m = m, .keys = keys, .values = values, .n = n, .threads = threads,
+    .region = m->capacity / threads,
+    .hashed = malloc((n ? n : 1) * sizeof(psrh_build_entry)),
+    .grouped = threads > 1 ? malloc((n ? n : 1) * sizeof(psrh_build_entry)) : NULL,
+    .counts = calloc((size_t)threads * threads, sizeof(size_t)),
+    .offsets = calloc(threads + 1, sizeof(size_t)),
+    .spill = calloc(threads, sizeof(psrh_slot*)),
+    .spilled = calloc(threads, sizeof(size_t)),
+    .spill_capacity = calloc(threads, sizeof(size_t)),
+    .distinct = calloc(threads, sizeof(size_t)),
+  };
+
+  if (threads == 1) job.grouped = job.hashed;
+
+  bool ok = job.hashed && job.grouped && job.counts && job.offsets && job.spill
+    && job.spilled && job.spill_capacity && job.distinct;
+
+  if (ok) {
+    psrh_build_run(&job, psrh_build_count);
+
+    // Region-major prefix sums: chunk c of region r scatters after chunks < c
+    size_t total = 0;
+    for (unsigned r = 0; r < threads; r++) {
+      job.offsets[r] = total;
+      for (unsigned c = 0; c < threads; c++) {
+        const size_t k = job.counts[(size_t)c * threads + r];
+        job.counts[(size_t)c * threads + r] = total;
+        total += k;
+      }
+    }
+    job.offsets[threads] = total;
+
+    if (threads > 1) psrh_build_run(&job, psrh_build_scatter);
+    psrh_build_run(&job, psrh_build_region);
+
+    size_t size = 0;
+    for (unsigned t = 0; t < threads; t++) size += job.distinct[t];
+    ok = !job.failed && size * 2 <= m->capacity;
+
+    // Step 4: clusters crossing into the next region, wrapping at the end
+    for (unsigned t = 0; ok && t < threads; t++) {
+      const size_t end = (t + 1) * job.region;
+      for (size_t i = 0; i < job.spilled[t]; i++) {
+        const psrh_slot s = job.spill[t][i];
+        const size_t home = psrh_hash64(s.key) & m->mask;
+        psrh_build_place(m, s, end & m->mask, end - home);
+      }
+    }
+    m->size = size;
+  }
+
+  for (unsigned t = 0; job.spill && t < threads; t++) free(job.spill[t]);
+  if (job.grouped != job.hashed) free(job.grouped);
+  free(job.hashed);
+  free(job.counts);
+  free(job.offsets);
+  free(job.spill);
+  free(job.spilled);
+  free(job.spill_capacity);
+  free(job.distinct);
+
+  if (!ok) psrh_clear(m);
+  return ok;
+}
+
+#endif // PACKED_STRING_PS_ROBINHOOD_BUILD_H
@@ -0,0 +1,170 @@
+#ifndef PACKED_STRING_PS_ROBINHOOD_FILE_H
+#define PACKED_STRING_PS_ROBINHOOD_FILE_H
+
+#include "ps-robinhood.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// psrh_map snapshots that are served straight from a read-only mapping.
+//
+// File layout, all integers in the byte order of the writer:
+//
+//   0   magic "PSRH"
+//   4   u16 version (1)
+//   6   u16 endian tag 0x0102, reads 0x0201 on a host of the other order
+//   8   u32 slot size (sizeof(psrh_slot))
+//   12  u32 header size (64, slots start there)
+//   16  u64 capacity (power of two)
+//   24  u64 mask
+//   32  u64 size
+//   40  u64 hash check: psrh_hash64 and psrh_fp of fixed inputs, catches
+//       a change to either
+//   48  16 bytes reserved, zero
+//   64  capacity slots, fields as in memory, padding zeroed
+//
+// psrh_open_mmap checks the header and points a psrh_map at the slots, so
+// opening costs one mmap however big the table is and lookups fault pages
+// in as they touch them. Only psrh_get and psrh_contains may be used on
+// it; anything that writes slots faults on the read-only mapping.
+// POSIX only (open, mmap).
+
+#define PSRH_FILE_MAGIC       "PSRH"
+#define PSRH_FILE_VERSION     1
+#define PSRH_FILE_ENDIAN      0x0102
+#define PSRH_FILE_HEADER_SIZE 64
+
+typedef struct {
+  char     magic[4];
+  uint16_t version;
+  uint16_t endian;
+  uint32_t slot_size;
+  uint32_t header_size;
+  uint64_t capacity;
+  uint64_t mask;
+  uint64_t size;
+  uint64_t hash_check;
+  uint8_t  reserved[16];
+} psrh_file_header;
+
+typedef struct {
+  psrh_map map;       // read-only view for psrh_get / psrh_contains
+  void*    base;
+  size_t   length;
+} psrh_file;
+
+static inline uint64_t psrh_file_hash_check(void) {
+  const uint64_t h = psrh_hash64((ps_t){ .lo = 0x0123456789ABCDEFULL, .hi = 0x0FEDCBA987654321ULL });
+  // psrh_fp of h and of a hash whose top bits are zero (the 0 -> 1 rule)
+  return h ^ (uint64_t)psrh_fp(h) << 16 ^ (uint64_t)psrh_fp(0x0000FFFFFFFFFFFFULL);
+}
+
+static inline bool psrh_write_all(const int fd, const void* data, size_t len) {
+  const char* p = data;
+  while (len > 0) {
+    const ssize_t w = write(fd, p, len);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    len -= (size_t)w;
+  }
+  return true;
+}
+
+// Slots are copied field by field into a zeroed buffer before writing, and
+// empty slots are written as zeros, so padding never carries stack bytes to
+// disk and snapshots of the same table are byte-identical.
+#define PSRH_FILE_CHUNK 256
+
+// Writes the snapshot at the current offset of fd, false on a write error
+static inline bool psrh_save(const psrh_map* m, const int fd) {
+  psrh_file_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PSRH_FILE_MAGIC, 4);
+  h.version = PSRH_FILE_VERSION;
+  h.endian = PSRH_FILE_ENDIAN;
+  h.slot_size = sizeof(psrh_slot);
+  h.header_size = PSRH_FILE_HEADER_SIZE;
+  h.capacity = m->capacity;
+  h.mask = m->mask;
+  h.size = m->size;
+  h.hash_check = psrh_file_hash_check();
+
+  if (!psrh_write_all(fd, &h, sizeof(h))) return false;
+
+  psrh_slot chunk[PSRH_FILE_CHUNK];
+  memset(chunk, 0, sizeof(chunk));
+  for (size_t first = 0; first < m->capacity; first += PSRH_FILE_CHUNK) {
+    const size_t count = m->capacity - first < PSRH_FILE_CHUNK ? m->capacity - first : PSRH_FILE_CHUNK;
+    for (size_t i = 0; i < count; i++) {
+      const psrh_slot* s = &m->slots[first + i];
+      const bool taken = s->fp != 0;   // empty slots may keep a deleted key
+      chunk[i].fp = s->fp;
+      chunk[i].key = taken ? s->key : (ps_t){ 0, 0 };
+      chunk[i].value = taken ? s->value : 0;
+    }
+    if (!psrh_write_all(fd, chunk, count * sizeof(psrh_slot))) return false;
+  }
+  return true;
+}
+
+static inline bool psrh_file_header_valid(const psrh_file_header* h, const size_t file_size) {
+  if (memcmp(h->magic, PSRH_FILE_MAGIC, 4) != 0) return false;
+  if (h->version != PSRH_FILE_VERSION || h->endian != PSRH_FILE_ENDIAN) return false;
+  if (h->slot_size != sizeof(psrh_slot) || h->header_size != PSRH_FILE_HEADER_SIZE) return false;
+  if (h->hash_check != psrh_file_hash_check()) return false;
+
+  const uint64_t cap = h->capacity;
+  if (cap == 0 || (cap & (cap - 1)) != 0 || h->mask != cap - 1 || h->size > cap / 2) return false;
+  if (cap > (SIZE_MAX - PSRH_FILE_HEADER_SIZE) / sizeof(psrh_slot)) return false;
+
+  return file_size == PSRH_FILE_HEADER_SIZE + cap * sizeof(psrh_slot);
+}
+
+// Maps a snapshot read-only, false if it cannot be opened or is not one
+static inline bool psrh_open_mmap(const char* path, psrh_file* f) {
+  memset(f, 0, sizeof(*f));
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < PSRH_FILE_HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+
+  const size_t length = (size_t)st.st_size;
+  void* base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);   // the mapping keeps the file
+  if (base == MAP_FAILED) return false;
+
+  psrh_file_header h;
+  memcpy(&h, base, sizeof(h));
+  if (!psrh_file_header_valid(&h, length)) {
+    munmap(base, length);
+    return false;
+  }
+
+  // Slots are only read through this map
+  f->map.slots = (psrh_slot*)((char*)base + PSRH_FILE_HEADER_SIZE);
+  f->map.capacity = (size_t)h.capacity;
+  f->map.mask = (size_t)h.mask;
+  f->map.size = (size_t)h.size;
+  f->base = base;
+  f->length = length;
+  return true;
+}
+
+static inline void psrh_close_mmap(psrh_file* f) {
+  if (f->base) munmap(f->base, f->length);
+  memset(f, 0, sizeof(*f));
+}
+
+#endif // PACKED_STRING_PS_ROBINHOOD_FILE_H
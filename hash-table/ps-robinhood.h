@@ -2,37 +2,63 @@
 #define PACKED_STRING_PS_ROBINHOOD_H
 
 #include "../packed16/packed-string.h"
+#include "../packed16/aligned.h"
 
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
+#ifdef PSRH_STATS
+#include <stdio.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 typedef struct {
   uint16_t fp;     // 0 = empty
   ps_t     key;
   uint64_t value;
 } psrh_slot;
 
+// Define PSRH_STATS before including to collect probe statistics.
+// Lookups then write counters through a const map, so a map shared
+// between threads gives approximate numbers; meant for diagnosis only.
+#ifdef PSRH_STATS
+#define PSRH_STATS_BUCKETS 32   // last bucket holds every distance >= 31
+
+typedef struct {
+  uint64_t probes[PSRH_STATS_BUCKETS];  // lookups by probe distance
+  uint64_t hits, hit_distance;          // count and summed distance
+  uint64_t misses, miss_distance;
+  uint64_t fp_false_positives;          // fingerprint matched, key did not
+  uint64_t swaps;                       // robin hood displacements in psrh_set
+  size_t   max_displacement;            // largest distance psrh_set placed at
+} psrh_stats;
+
+#define PSRH_STAT(x) x
+#else
+#define PSRH_STAT(x)
+#endif
+
 typedef struct {
   psrh_slot* slots;
   size_t   capacity;
   size_t   mask;
   size_t   size;
+#ifdef PSRH_STATS
+  psrh_stats stats;
+#endif
 } psrh_map;
 
 static inline uint64_t psrh_hash64(const ps_t k) {
-  uint64_t x = k.lo ^ (k.hi * 0x9E3779B97F4A7C15ULL);
-  x ^= x >> 33;
-  x *= 0xff51afd7ed558ccdULL;
-  x ^= x >> 33;
-  x *= 0xc4ceb9fe1a85ec53ULL;
-  x ^= x >> 33;
-  return x;
+  return ps_mix64(k.lo, k.hi);
 }
 
 static inline uint16_t psrh_fp(const uint64_t h) {
-  const uint16_t f = (uint16_t)h;
+  const uint16_t f = (uint16_t)(h >> 48);   // the slot index uses the low bits
   return f ? f : 1;   // avoid 0
 }
 
@@ -44,11 +70,30 @@ static inline bool psrh_equal(const ps_t a, const ps_t b) {
   return a.lo == b.lo && a.hi == b.hi;
 }
 
+#ifdef PSRH_STATS
+// Maps are never const objects, only const views
+static inline psrh_stats* psrh_stats_of(const psrh_map* m) {
+  return (psrh_stats*)&m->stats;
+}
+
+static inline void psrh_stats_lookup(const psrh_map* m, const size_t dist, const bool hit) {
+  psrh_stats* st = psrh_stats_of(m);
+  st->probes[dist < PSRH_STATS_BUCKETS ? dist : PSRH_STATS_BUCKETS - 1]++;
+  if (hit) {
+    st->hits++;
+    st->hit_distance += dist;
+  } else {
+    st->misses++;
+    st->miss_distance += dist;
+  }
+}
+#endif
+
 static inline bool psrh_init(psrh_map* m, const size_t capacity) {
   size_t cap = 1;
   while (cap < capacity) cap <<= 1;
 
-  m->slots = _aligned_malloc(cap * sizeof(psrh_slot), 64);
+  m->slots = ps_aligned_alloc(cap * sizeof(psrh_slot), 64);
   if (!m->slots) return false;
 
   memset(m->slots, 0, cap * sizeof(psrh_slot));
@@ -56,11 +101,12 @@ static inline bool psrh_init(psrh_map* m, const size_t capacity) {
   m->capacity = cap;
   m->mask = cap - 1;
   m->size = 0;
+  PSRH_STAT(memset(&m->stats, 0, sizeof(m->stats)));
   return true;
 }
 
 static inline void psrh_free(psrh_map* m) {
-  free(m->slots);
+  ps_aligned_free(m->slots);
   m->slots = NULL;
   m->capacity = 0;
   m->size = 0;
@@ -89,6 +135,7 @@ static inline bool psrh_set(psrh_map* m, ps_t key, uint64_t value) {
       s->key = key;
       s->value = value;
       m->size++;
+      PSRH_STAT(if (dist > m->stats.max_displacement) m->stats.max_displacement = dist);
       return true;
     }
 
@@ -103,6 +150,8 @@ static inline bool psrh_set(psrh_map* m, ps_t key, uint64_t value) {
 
     if (s_dist < dist) {
       // swap
+      PSRH_STAT(m->stats.swaps++);
+      PSRH_STAT(if (dist > m->stats.max_displacement) m->stats.max_displacement = dist);
       const psrh_slot tmp = *s;
       s->fp = fp;
       s->key = key;
@@ -129,18 +178,27 @@ static inline bool psrh_contains(const psrh_map* m, const ps_t key) {
   while (1) {
     const psrh_slot* s = &m->slots[idx];
 
-    if (s->fp == 0)
+    if (s->fp == 0) {
+      PSRH_STAT(psrh_stats_lookup(m, dist, false));
       return false;
+    }
 
-    if (s->fp == fp && psrh_equal(s->key, key))
-      return true;
+    if (s->fp == fp) {
+      if (psrh_equal(s->key, key)) {
+        PSRH_STAT(psrh_stats_lookup(m, dist, true));
+        return true;
+      }
+      PSRH_STAT(psrh_stats_of(m)->fp_false_positives++);
+    }
 
     const uint64_t sh = psrh_hash64(s->key);
     const size_t ideal = sh & m->mask;
     const size_t s_dist = psrh_probe_distance(idx, ideal, m->mask);
 
-    if (s_dist < dist)
+    if (s_dist < dist) {
+      PSRH_STAT(psrh_stats_lookup(m, dist, false));
       return false;
+    }
 
     idx = (idx + 1) & m->mask;
     dist++;
@@ -156,26 +214,59 @@ static inline bool psrh_get(const psrh_map* m, ps_t const key, uint64_t* out) {
   while (1) {
     const psrh_slot* s = &m->slots[idx];
 
-    if (s->fp == 0)
+    if (s->fp == 0) {
+      PSRH_STAT(psrh_stats_lookup(m, dist, false));
       return false;
+    }
 
-    if (s->fp == fp && psrh_equal(s->key, key)) {
-      *out = s->value;
-      return true;
+    if (s->fp == fp) {
+      if (psrh_equal(s->key, key)) {
+        PSRH_STAT(psrh_stats_lookup(m, dist, true));
+        *out = s->value;
+        return true;
+      }
+      PSRH_STAT(psrh_stats_of(m)->fp_false_positives++);
     }
 
     const uint64_t sh = psrh_hash64(s->key);
     const size_t ideal = sh & m->mask;
     const size_t s_dist = psrh_probe_distance(idx, ideal, m->mask);
 
-    if (s_dist < dist)
+    if (s_dist < dist) {
+      PSRH_STAT(psrh_stats_lookup(m, dist, false));
       return false;
+    }
 
     idx = (idx + 1) & m->mask;
     dist++;
   }
 }
 
+// Empties slot idx and backward-shifts the rest of its cluster into it
+static inline void psrh_remove_at(psrh_map* m, size_t idx) {
+  size_t next = (idx + 1) & m->mask;
+
+  while (1) {
+    const psrh_slot* s = &m->slots[next];
+
+    if (s->fp == 0)
+      break;
+
+    const uint64_t sh = psrh_hash64(s->key);
+    const size_t ideal = sh & m->mask;
+
+    if (psrh_probe_distance(next, ideal, m->mask) == 0)
+      break;
+
+    m->slots[idx] = *s;
+    idx = next;
+    next = (next + 1) & m->mask;
+  }
+
+  m->slots[idx].fp = 0;
+  m->size--;
+}
+
 static inline bool psrh_delete(psrh_map* m, const ps_t key) {
   const uint64_t h = psrh_hash64(key);
   const uint16_t fp = psrh_fp(h);
@@ -202,30 +293,187 @@ static inline bool psrh_delete(psrh_map* m, const ps_t key) {
     dist++;
   }
 
-  // backward shift
-  size_t next = (idx + 1) & m->mask;
+  psrh_remove_at(m, idx);
+  return true;
+}
 
-  while (1) {
-    const psrh_slot* s = &m->slots[next];
+// =========================
+// ITERATION
+// =========================
 
-    if (s->fp == 0)
-      break;
+// First occupied slot in [i, end), or end
+static inline size_t psrh_scan(const psrh_map* m, size_t i, const size_t end) {
+#if defined(__AVX2__)
+  // Dense tables: the next slot is mostly taken
+  if (i < end && m->slots[i].fp != 0) return i;
 
-    const uint64_t sh = psrh_hash64(s->key);
-    const size_t ideal = sh & m->mask;
+  // Fingerprints of 8 slots in one gather, the 16 bits above them are padding
+  const int words = (int)(sizeof(psrh_slot) / sizeof(int));
+  const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(words));
+  const __m256i fp_mask = _mm256_set1_epi32(0xFFFF);
 
-    if (psrh_probe_distance(next, ideal, m->mask) == 0)
-      break;
+  for (; i + 8 <= end; i += 8) {
+    const __m256i fps = _mm256_and_si256(_mm256_i32gather_epi32((const int*)&m->slots[i].fp, index, 4), fp_mask);
+    if (!_mm256_testz_si256(fps, fps)) break;
+  }
+#endif
+  while (i < end && m->slots[i].fp == 0) i++;
+  return i;
+}
 
-    m->slots[idx] = *s;
-    idx = next;
-    next = (next + 1) & m->mask;
+// Calls fn for every key in slot order. fn must not insert or delete.
+static inline void psrh_for_each(const psrh_map* m, void (*fn)(ps_t key, uint64_t value, void* ctx), void* ctx) {
+  for (size_t i = psrh_scan(m, 0, m->capacity); i < m->capacity; i = psrh_scan(m, i + 1, m->capacity))
+    fn(m->slots[i].key, m->slots[i].value, ctx);
+}
+
+// Cursor over the slots. It starts at a slot no cluster runs through (empty
+// or holding a key at its home bucket) and goes once around the table, so
+// the backward shift of psrh_iter_delete only moves keys not visited yet.
+// psrh_set of a key already present is fine during iteration; other
+// inserts and deletes invalidate the iterator.
+typedef struct {
+  const psrh_map* m;
+  size_t origin;
+  size_t step;      // slots behind the cursor, counted from origin
+} psrh_iter;
+
+static inline void psrh_iter_init(const psrh_map* m, psrh_iter* it) {
+  it->m = m;
+  it->origin = 0;
+  it->step = 0;
+
+  while (it->origin < m->capacity) {
+    const psrh_slot* s = &m->slots[it->origin];
+    if (s->fp == 0 || (psrh_hash64(s->key) & m->mask) == it->origin) break;
+    it->origin++;
   }
+  if (it->origin == m->capacity) it->origin = 0;
+}
 
-  m->slots[idx].fp = 0;
-  m->size--;
-  return true;
+// Next key and value, false when every slot was visited
+static inline bool psrh_next(psrh_iter* it, ps_t* key, uint64_t* value) {
+  const psrh_map* m = it->m;
+
+  while (it->step < m->capacity) {
+    // Up to the table end, or up to origin once wrapped
+    const size_t i = (it->origin + it->step) & m->mask;
+    const size_t end = i < it->origin ? it->origin : m->capacity;
+    const size_t found = psrh_scan(m, i, end);
+
+    it->step += found - i;
+    if (found < end) {
+      it->step++;
+      *key = m->slots[found].key;
+      *value = m->slots[found].value;
+      return true;
+    }
+  }
+  return false;
 }
 
+// Deletes the key psrh_next just returned; the iteration goes on with the
+// keys the backward shift moved into its slot
+static inline void psrh_iter_delete(psrh_map* m, psrh_iter* it) {
+  it->step--;
+  psrh_remove_at(m, (it->origin + it->step) & m->mask);
+}
+
+// Keeps the keys keep() returns true for, in one pass over the slots
+// instead of a psrh_delete per key. Kept keys move back into the gaps
+// towards their home bucket, as the backward shift would put them.
+// Returns the number of keys removed.
+static inline size_t psrh_retain(psrh_map* m, bool (*keep)(ps_t key, uint64_t value, void* ctx), void* ctx) {
+  psrh_iter it;
+  psrh_iter_init(m, &it);
+
+  const size_t size = m->size;
+  size_t next = 0;    // first free position, counted from origin
+
+  for (size_t step = 0; step < m->capacity; step++) {
+    psrh_slot* s = &m->slots[(it.origin + step) & m->mask];
+    if (s->fp == 0) continue;
+
+    const psrh_slot moved = *s;
+    s->fp = 0;
+    if (!keep(moved.key, moved.value, ctx)) {
+      m->size--;
+      continue;
+    }
+
+    // No cluster runs through origin, so home <= step in these positions
+    const size_t home = (psrh_hash64(moved.key) - it.origin) & m->mask;
+    const size_t pos = home > next ? home : next;
+    m->slots[(it.origin + pos) & m->mask] = moved;
+    next = pos + 1;
+  }
+  return size - m->size;
+}
+
+// Calls fn (if not NULL) for every key in slot order and empties the map
+// in the same pass. Returns the number of keys removed.
+static inline size_t psrh_drain(psrh_map* m, void (*fn)(ps_t key, uint64_t value, void* ctx), void* ctx) {
+  const size_t size = m->size;
+
+  for (size_t i = psrh_scan(m, 0, m->capacity); i < m->capacity; i = psrh_scan(m, i + 1, m->capacity)) {
+    if (fn) fn(m->slots[i].key, m->slots[i].value, ctx);
+    m->slots[i].fp = 0;
+  }
+  m->size = 0;
+  return size;
+}
+
+#ifdef PSRH_STATS
+static inline void psrh_stats_reset(psrh_map* m) {
+  memset(&m->stats, 0, sizeof(m->stats));
+}
+
+static inline double psrh_stats_avg_hit(const psrh_map* m) {
+  return m->stats.hits ? (double)m->stats.hit_distance / (double)m->stats.hits : 0.0;
+}
+
+static inline double psrh_stats_avg_miss(const psrh_map* m) {
+  return m->stats.misses ? (double)m->stats.miss_distance / (double)m->stats.misses : 0.0;
+}
+
+// Displacement histogram of the entries stored right now (deletes included),
+// returns the largest displacement
+static inline size_t psrh_stats_occupancy(const psrh_map* m, uint64_t hist[PSRH_STATS_BUCKETS]) {
+  size_t max = 0;
+  memset(hist, 0, PSRH_STATS_BUCKETS * sizeof(uint64_t));
+
+  for (size_t i = 0; i < m->capacity; i++) {
+    const psrh_slot* s = &m->slots[i];
+    if (s->fp == 0) continue;
+
+    const size_t d = psrh_probe_distance(i, psrh_hash64(s->key) & m->mask, m->mask);
+    hist[d < PSRH_STATS_BUCKETS ? d : PSRH_STATS_BUCKETS - 1]++;
+    if (d > max) max = d;
+  }
+  return max;
+}
+
+static inline void psrh_stats_print(const psrh_map* m, FILE* out) {
+  const psrh_stats* st = &m->stats;
+  uint64_t hist[PSRH_STATS_BUCKETS];
+  const size_t max = psrh_stats_occupancy(m, hist);
+
+  fprintf(out, "psrh: %zu / %zu slots (load %.3f)\n", m->size, m->capacity,
+    m->capacity ? (double)m->size / (double)m->capacity : 0.0);
+  fprintf(out, "  hits %llu (avg probe %.2f), misses %llu (avg probe %.2f)\n",
+    (unsigned long long)st->hits, psrh_stats_avg_hit(m),
+    (unsigned long long)st->misses, psrh_stats_avg_miss(m));
+  fprintf(out, "  fingerprint false positives %llu, swaps %llu\n",
+    (unsigned long long)st->fp_false_positives, (unsigned long long)st->swaps);
+  fprintf(out, "  max displacement %zu now, %zu ever\n", max, st->max_displacement);
+
+  fprintf(out, "  distance   stored   looked up\n");
+  for (int d = 0; d < PSRH_STATS_BUCKETS; d++) {
+    if (!hist[d] && !st->probes[d]) continue;
+    fprintf(out, "  %2d%s %10llu %11llu\n", d, d == PSRH_STATS_BUCKETS - 1 ? "+" : " ",
+      (unsigned long long)hist[d], (unsigned long long)st->probes[d]);
+  }
+}
+#endif
 
 #endif // PACKED_STRING_PS_ROBINHOOD_H
@@ -0,0 +1,38 @@
+#ifndef PACKED_ALIGNED_H
+#define PACKED_ALIGNED_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+/**
+ * Allocate size bytes aligned to align (power of two).
+ * Memory must be released with ps_aligned_free.
+ *
+ * @param size Bytes to allocate
+ * @param align Alignment in bytes
+ * @return Pointer or NULL on failure
+ */
+static inline void* ps_aligned_alloc(const size_t size, const size_t align) {
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    // aligned_alloc wants size to be a multiple of align
+    const size_t rounded = (size + align - 1) & ~(align - 1);
+    return aligned_alloc(align, rounded ? rounded : align);
+#endif
+}
+
+/** Release memory from ps_aligned_alloc. */
+static inline void ps_aligned_free(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+#endif // PACKED_ALIGNED_H
@@ -0,0 +1,189 @@
+#include "dispatch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if PS_DISPATCH_X86
+#include <cpuid.h>
+#endif
+
+// ============================================================================
+// KERNEL TABLE
+// ============================================================================
+
+#define PS_SCALAR_KERNELS {                  \
+    .pack         = ps_pack_scalar,           \
+    .pack_n       = ps_pack_n_scalar,         \
+    .unpack       = ps_unpack_scalar,         \
+    .unpack_many  = ps_unpack_many_scalar,    \
+    .to_lower     = ps_to_lower_scalar,       \
+    .to_upper     = ps_to_upper_scalar,       \
+    .find         = ps_find_scalar,           \
+    .reverse_find = ps_reverse_find_scalar,   \
+    .hash64_many  = ps_hash64_many_scalar,    \
+    .ident_mask   = ps_ident_mask_scalar,     \
+    .decode_many  = ps_decode_many_scalar,    \
+}
+
+// Scalar until ps_dispatch_init runs, so early callers still work
+PsKernels ps_kernels = PS_SCALAR_KERNELS;
+
+static const char* const PS_TIER_NAMES[PS_TIER_COUNT] = {
+    "scalar", "bmi2", "avx2", "avx512"
+};
+
+typedef struct {
+    bool bmi2;
+    bool fast_pdep;     // PDEP/PEXT in hardware, not microcode
+    bool avx2;          // and the OS saves ymm state
+    bool avx512;        // F, BW, DQ, VL and the OS saves zmm state
+} PsCpu;
+
+static PsCpu ps_cpu;
+static PsTier ps_cpu_best = PS_TIER_SCALAR;
+static PsTier ps_current = PS_TIER_SCALAR;
+
+// ============================================================================
+// CPU DETECTION
+// ============================================================================
+
+#if PS_DISPATCH_X86
+
+static u64 ps_xgetbv(void) {
+    u32 eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (u64)edx << 32 | eax;
+}
+
+static void ps_detect(PsCpu* cpu) {
+    u32 eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return;
+
+    const u32 max_leaf = eax;
+    // "AuthenticAMD" and "HygonGenuine" (Zen 1 based)
+    const bool amd = ebx == 0x68747541 || ebx == 0x6F677948;
+
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    const u32 base_family = eax >> 8 & 0xF;
+    const u32 family = base_family == 0xF ? base_family + (eax >> 20 & 0xFF) : base_family;
+
+    const bool osxsave = ecx >> 27 & 1;
+    const bool avx = ecx >> 28 & 1;
+    const u64 xcr0 = osxsave ? ps_xgetbv() : 0;
+    const bool ymm_state = (xcr0 & 0x06) == 0x06;   // SSE, AVX
+    const bool zmm_state = (xcr0 & 0xE6) == 0xE6;   // + opmask, ZMM_Hi256, Hi16_ZMM
+
+    if (max_leaf < 7) return;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+    cpu->bmi2 = ebx >> 8 & 1;
+    cpu->fast_pdep = cpu->bmi2 && !(amd && family < 0x19);
+    cpu->avx2 = avx && ymm_state && (ebx >> 5 & 1);
+    cpu->avx512 = cpu->avx2 && zmm_state
+        && (ebx >> 16 & 1)      // F
+        && (ebx >> 17 & 1)      // DQ
+        && (ebx >> 30 & 1)      // BW
+        && (ebx >> 31 & 1);     // VL
+}
+
+#else
+
+static void ps_detect(PsCpu* cpu) { (void)cpu; }
+
+#endif
+
+// ============================================================================
+// SELECTION
+// ============================================================================
+
+static void ps_select(const PsTier tier) {
+    ps_kernels = (PsKernels)PS_SCALAR_KERNELS;
+    ps_current = tier;
+
+#if PS_DISPATCH_X86
+    // Microcoded PDEP costs ~250 cycles, only use it there when asked to
+    const bool pdep = tier >= PS_TIER_BMI2 && ps_cpu.bmi2
+        && (ps_cpu.fast_pdep || tier == PS_TIER_BMI2);
+    const bool avx2 = tier >= PS_TIER_AVX2 && ps_cpu.avx2;
+    const bool avx512 = tier >= PS_TIER_AVX512 && ps_cpu.avx512;
+
+    if (pdep) {
+        ps_kernels.unpack       = ps_unpack_bmi2;
+        ps_kernels.to_lower     = ps_to_lower_bmi2;
+        ps_kernels.to_upper     = ps_to_upper_bmi2;
+        ps_kernels.find         = ps_find_bmi2;
+        ps_kernels.reverse_find = ps_reverse_find_bmi2;
+    }
+
+    if (avx2) {
+        ps_kernels.pack        = ps_pack_avx2;
+        ps_kernels.pack_n      = ps_pack_n_avx2;
+        ps_kernels.hash64_many = ps_hash64_many_avx2;
+        ps_kernels.ident_mask  = ps_ident_mask_avx2;
+        ps_kernels.decode_many = ps_decode_many_avx2;
+        ps_kernels.unpack_many = ps_unpack_many_avx2;
+        if (!pdep) ps_kernels.unpack = ps_unpack_avx2;
+    }
+
+    if (avx512) {
+        ps_kernels.hash64_many = ps_hash64_many_avx512;
+        ps_kernels.ident_mask  = ps_ident_mask_avx512;
+    }
+#endif
+}
+
+static void ps_dispatch_init(void) {
+    ps_detect(&ps_cpu);
+
+    if (ps_cpu.avx512) ps_cpu_best = PS_TIER_AVX512;
+    else if (ps_cpu.avx2) ps_cpu_best = PS_TIER_AVX2;
+    else if (ps_cpu.bmi2) ps_cpu_best = PS_TIER_BMI2;
+    else ps_cpu_best = PS_TIER_SCALAR;
+
+    PsTier tier = ps_cpu_best;
+
+    // Unknown names and tiers the CPU lacks are ignored
+    const char* forced = getenv("PS_TIER");
+    if (forced) {
+        const PsTier t = ps_tier_parse(forced);
+        if (t <= ps_cpu_best) tier = t;
+    }
+
+    ps_select(tier);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor)) static void ps_dispatch_constructor(void) {
+    ps_dispatch_init();
+}
+#endif
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+PsTier ps_cpu_tier(void) {
+    return ps_cpu_best;
+}
+
+PsTier ps_tier(void) {
+    return ps_current;
+}
+
+bool ps_set_tier(const PsTier tier) {
+    if (tier >= PS_TIER_COUNT || tier > ps_cpu_best) return false;
+
+    ps_select(tier);
+    return true;
+}
+
+const char* ps_tier_name(const PsTier tier) {
+    return tier < PS_TIER_COUNT ? PS_TIER_NAMES[tier] : "?";
+}
+
+PsTier ps_tier_parse(const char* name) {
+    for (u8 t = 0; name && t < PS_TIER_COUNT; t++) {
+        if (strcmp(name, PS_TIER_NAMES[t]) == 0) return (PsTier)t;
+    }
+    return PS_TIER_COUNT;
+}
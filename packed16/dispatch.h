@@ -0,0 +1,96 @@
+#ifndef PACKED_DISPATCH_H
+#define PACKED_DISPATCH_H
+
+#include <stddef.h>
+#include "packed-string.h"
+
+// Runtime-dispatched kernels (internal)
+//
+// The hot ps_* entry points call through ps_kernels. It starts out with
+// the portable scalar kernels and is filled once at load time from CPUID
+// (dispatch.c); ps_set_tier and the PS_TIER environment variable
+// override the choice. Every kernel of a slot must return bit-identical
+// results, hashes included, since tables built on one host are read on
+// others.
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__)) \
+    && !defined(PS_NO_DISPATCH)
+#define PS_DISPATCH_X86 1
+#else
+#define PS_DISPATCH_X86 0
+#endif
+
+typedef struct {
+    PackedString (*pack)(const char* str);
+
+    /**
+     * str valid, length <= 20, nothing is read for length 0. May read
+     * bytes outside [str, str + length) but only in the 4 KiB pages the
+     * string touches (no_sanitize_address on such kernels), the result
+     * must not depend on them.
+     */
+    PackedString (*pack_n)(const char* str, u8 length);
+
+    /** Writes all chars and the null, ps must be valid */
+    void (*unpack)(PackedString ps, char* buffer);
+
+    /** Same contract as ps_unpack_many */
+    size_t (*unpack_many)(const PackedString* ps, size_t n, char* arena, size_t* offsets);
+
+    PackedString (*to_lower)(PackedString ps);
+    PackedString (*to_upper)(PackedString ps);
+
+    /** Same contract as ps_find / ps_reverse_find in helper.h */
+    i8 (*find)(u64 lo, u64 hi, u8 idx, u8 sixbit);
+    i8 (*reverse_find)(u64 lo, u64 hi, u8 idx, u8 sixbit);
+
+    void (*hash64_many)(const PackedString* ps, u64* out, size_t n);
+
+    /** Bit i set if block[i] is in the alphabet, reads exactly 64 bytes */
+    u64 (*ident_mask)(const char* block);
+
+    /** Same contract as ps_decode_many */
+    size_t (*decode_many)(const u8* in, size_t len, PackedString* out, size_t n, size_t* consumed);
+} PsKernels;
+
+extern PsKernels ps_kernels;
+
+// Portable kernels (packed-string.c)
+PackedString ps_pack_scalar(const char* str);
+PackedString ps_pack_n_scalar(const char* str, u8 length);
+void ps_unpack_scalar(PackedString ps, char* buffer);
+size_t ps_unpack_many_scalar(const PackedString* ps, size_t n, char* arena, size_t* offsets);
+PackedString ps_to_lower_scalar(PackedString ps);
+PackedString ps_to_upper_scalar(PackedString ps);
+i8 ps_find_scalar(u64 lo, u64 hi, u8 idx, u8 sixbit);
+i8 ps_reverse_find_scalar(u64 lo, u64 hi, u8 idx, u8 sixbit);
+void ps_hash64_many_scalar(const PackedString* ps, u64* out, size_t n);
+
+// Portable kernels (tokenize.c)
+u64 ps_ident_mask_scalar(const char* block);
+
+// Portable kernels (serialize.c)
+size_t ps_decode_many_scalar(const u8* in, size_t len, PackedString* out, size_t n, size_t* consumed);
+
+#if PS_DISPATCH_X86
+// x86 kernels (kernels-x86.c)
+// BMI2: chars spread to one per byte with PDEP, gathered back with PEXT
+void ps_unpack_bmi2(PackedString ps, char* buffer);
+PackedString ps_to_lower_bmi2(PackedString ps);
+PackedString ps_to_upper_bmi2(PackedString ps);
+i8 ps_find_bmi2(u64 lo, u64 hi, u8 idx, u8 sixbit);
+i8 ps_reverse_find_bmi2(u64 lo, u64 hi, u8 idx, u8 sixbit);
+
+// AVX2 and AVX-512
+PackedString ps_pack_avx2(const char* str);
+PackedString ps_pack_n_avx2(const char* str, u8 length);
+void ps_unpack_avx2(PackedString ps, char* buffer);
+size_t ps_unpack_many_avx2(const PackedString* ps, size_t n, char* arena, size_t* offsets);
+void ps_hash64_many_avx2(const PackedString* ps, u64* out, size_t n);
+void ps_hash64_many_avx512(const PackedString* ps, u64* out, size_t n);
+u64 ps_ident_mask_avx2(const char* block);
+u64 ps_ident_mask_avx512(const char* block);
+size_t ps_decode_many_avx2(const u8* in, size_t len, PackedString* out, size_t n, size_t* consumed);
+#endif
+
+#endif // PACKED_DISPATCH_H
@@ -3,32 +3,24 @@
 
 #include "types.h"
 
-// 6-bit to char conversion table
-static const char PS_SIXBIT_TO_CHAR[64] =
+// 6-bit to char conversion table (with the NUL, which C++ requires)
+static const char PS_SIXBIT_TO_CHAR[64 + 1] =
     "0123456789"
     "abcdefghijklmnopqrstuvwxyz"
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "_$";
 
-// Char to 6-bit conversion (invalid chars map to 0)
+// Char to 6-bit conversion (invalid chars map to 0), positional so the
+// table also compiles as C++; 128-255 are zero
 static const u8 PS_CHAR_TO_SIXBIT[256] = {
-    // 0-127: ASCII
-    ['0'] =  0, ['1'] =  1, ['2'] =  2, ['3'] =  3, ['4'] =  4,
-    ['5'] =  5, ['6'] =  6, ['7'] =  7, ['8'] =  8, ['9'] =  9,
-    ['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14,
-    ['f'] = 15, ['g'] = 16, ['h'] = 17, ['i'] = 18, ['j'] = 19,
-    ['k'] = 20, ['l'] = 21, ['m'] = 22, ['n'] = 23, ['o'] = 24,
-    ['p'] = 25, ['q'] = 26, ['r'] = 27, ['s'] = 28, ['t'] = 29,
-    ['u'] = 30, ['v'] = 31, ['w'] = 32, ['x'] = 33, ['y'] = 34,
-    ['z'] = 35,
-    ['A'] = 36, ['B'] = 37, ['C'] = 38, ['D'] = 39, ['E'] = 40,
-    ['F'] = 41, ['G'] = 42, ['H'] = 43, ['I'] = 44, ['J'] = 45,
-    ['K'] = 46, ['L'] = 47, ['M'] = 48, ['N'] = 49, ['O'] = 50,
-    ['P'] = 51, ['Q'] = 52, ['R'] = 53, ['S'] = 54, ['T'] = 55,
-    ['U'] = 56, ['V'] = 57, ['W'] = 58, ['X'] = 59, ['Y'] = 60,
-    ['Z'] = 61,
-    ['_'] = 62,
-    ['$'] = 63
+    /* 0x00 */  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 0x10 */  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 0x20 */  0, 0, 0, 0,63, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 0x30 */  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0, 0, 0, 0, 0,
+    /* 0x40 */  0,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,
+    /* 0x50 */ 51,52,53,54,55,56,57,58,59,60,61, 0, 0, 0, 0,62,
+    /* 0x60 */  0,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,
+    /* 0x70 */ 25,26,27,28,29,30,31,32,33,34,35, 0, 0, 0, 0, 0,
 };
 
 // Lookup table for lowercase conversion (6-bit values)
@@ -2,6 +2,7 @@
 #define PACKED_HELPER_H
 
 #include "encoding.h"
+#include "packed-string.h"
 
 static inline void ps_shl(u64 *restrict lo, u64 *restrict hi, const u8 shift) {
     *hi = *hi << shift | *lo >> (64 - shift);
@@ -13,8 +14,11 @@ static inline void ps_shr(u64 *restrict lo, u64 *restrict hi, const u8 shift) {
     *hi >>= shift;
 }
 
+// shift < 128; 0 and 64 are fine (a plain 64-bit shift by 64 is not)
 static inline void ps_shl128(u64 *restrict lo, u64 *restrict hi, const u8 shift) {
-    if (shift <= 64) {
+    if (shift == 0) return;
+
+    if (shift < 64) {
         *hi = *hi << shift | *lo >> (64 - shift);
         *lo <<= shift;
     } else {
@@ -24,6 +28,8 @@ static inline void ps_shl128(u64 *restrict lo, u64 *restrict hi, const u8 shift)
 }
 
 static inline void ps_shr128(u64 *restrict lo, u64 *restrict hi, const u8 shift) {
+    if (shift == 0) return;
+
     if (shift < 64) {
         *lo = *lo >> shift | *hi << (64 - shift);
         *hi >>= shift;
@@ -53,6 +59,7 @@ static inline void ps_limit(u64 *restrict lo, u64 *restrict hi, const u8 length)
 
     if (bit_len < 64) {
         *lo &= (1ULL << bit_len) - 1ULL;
+        *hi = 0;
     } else /* if bit_len > 64 */ {
         *hi &= (1ULL << (bit_len - 64)) - 1ULL;
     }
@@ -90,16 +97,9 @@ static inline void ps_set_hi(u64* hi, const u8 n, const u8 sixbit) {
     *hi |= (u64)sixbit << shift;
 }
 
+// ps_sixbit_at on the raw halves
 static inline u8 ps_get_n_sixbit(const u64 lo, const u64 hi, const u8 n) {
-    if (n < 10)
-        return lo >> (n * 6) & 0x3F;
-
-    if (n == 10)
-        return (hi & 0x3) << 4 | lo >> 60 & 0xF;
-
-    // n > 10
-    const i32 shift = (n - 11) * 6 + 2;
-    return hi >> shift & 0x3F;
+    return ps_sixbit_at(ps_from(lo, hi), n);
 }
 
 static inline void ps_set_n_sixbit(u64 *restrict lo, u64 *restrict hi, const u8 n, const u8 sixbit) {
@@ -132,6 +132,14 @@ static inline void ps_write_sixbit(u64 *restrict lo, u64 *restrict hi,
     }
 }
 
+// Flags a single sixbit character sets
+static inline u8 ps_sixbit_flags(const u8 sixbit) {
+    if (36 <= sixbit && sixbit <= 61) return PACKED_FLAG_CASE_SENSITIVE;
+    if (sixbit <= 9) return PACKED_FLAG_CONTAINS_DIGIT;
+    if (sixbit == 62 || sixbit == 63) return PACKED_FLAG_CONTAINS_SPECIAL;
+    return 0;
+}
+
 static inline u8 ps_pack_metadata(const u8 length, const u8 flags) {
     return length << 3 | flags;
 }
@@ -188,7 +196,7 @@ static inline bool ps_is_at(
     const u32 lo_bits = 64 - start;
     const u32 hi_bits = bits - lo_bits;
 
-    const u64 lo_mask = (1ULL << lo_bits) - 1;
+    const u64 lo_mask = lo_bits < 64 ? (1ULL << lo_bits) - 1 : ~0ULL;
     const u64 hi_mask = (1ULL << hi_bits) - 1;
 
     const u64 p1_lo = (lo1 >> start) & lo_mask;
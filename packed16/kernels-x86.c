@@ -0,0 +1,453 @@
+#include "dispatch.h"
+
+#if PS_DISPATCH_X86
+
+#include <immintrin.h>
+#include <string.h>
+#include "helper.h"
+
+// Each kernel carries its own target attribute, so this file builds with
+// the baseline -march and is only entered after CPUID said so.
+
+#define PS_TARGET(isa) __attribute__((target(isa)))
+
+#define PS_BYTES_LOW    0x0101010101010101ULL   // bit 0 of every byte
+#define PS_BYTES_HIGH   0x8080808080808080ULL   // bit 7 of every byte
+#define PS_BYTES_SIX    0x3F3F3F3F3F3F3F3FULL   // 6 low bits of every byte
+#define PS_CHARS_MASK   0x00FFFFFFFFFFFFFFULL   // hi without metadata
+
+// ============================================================================
+// BMI2
+// ============================================================================
+
+// One char per byte: c[0] chars 0-7, c[1] chars 8-15, c[2] chars 16-19
+PS_TARGET("bmi2")
+static inline void ps_spread(const u64 lo, const u64 hi, u64 c[3]) {
+    c[0] = _pdep_u64(lo, PS_BYTES_SIX);
+    c[1] = _pdep_u64(lo >> 48 | hi << 16, PS_BYTES_SIX);
+    c[2] = _pdep_u64(hi >> 32, PS_BYTES_SIX & 0xFFFFFFFF);
+}
+
+// Inverse of ps_spread, hi metadata bits are left zero
+PS_TARGET("bmi2")
+static inline void ps_gather(const u64 c[3], u64* lo, u64* hi) {
+    const u64 mid = _pext_u64(c[1], PS_BYTES_SIX);
+    *lo = _pext_u64(c[0], PS_BYTES_SIX) | mid << 48;
+    *hi = mid >> 16 | _pext_u64(c[2], PS_BYTES_SIX & 0xFFFFFFFF) << 32;
+}
+
+// Bytes of word w (chars 8w to 8w+7) that are below length
+static inline u64 ps_live_bytes(const u8 length, const u8 w) {
+    const i32 n = (i32)length - w * 8;
+    if (n <= 0) return 0;
+    return n >= 8 ? ~0ULL : (1ULL << (n * 8)) - 1;
+}
+
+// Bit 7 set in bytes equal to zero (exact, no false positives)
+static inline u64 ps_zero_bytes(const u64 x) {
+    const u64 low7 = ~PS_BYTES_HIGH;
+    return ~((x & low7) + low7 | x | low7);
+}
+
+// Bytes holding 0-63 in, their chars out (see PS_SIXBIT_TO_CHAR)
+static inline u64 ps_swar_to_char(const u64 b) {
+    const u64 above9  = (b + 0x76 * PS_BYTES_LOW) >> 7 & PS_BYTES_LOW;
+    const u64 above35 = (b + 0x5C * PS_BYTES_LOW) >> 7 & PS_BYTES_LOW;
+    const u64 above61 = (b + 0x42 * PS_BYTES_LOW) >> 7 & PS_BYTES_LOW;
+    const u64 above62 = (b + 0x41 * PS_BYTES_LOW) >> 7 & PS_BYTES_LOW;
+
+    // '0' + b, 'a' + b - 10, 'A' + b - 36, '_', '$'
+    return b + '0' * PS_BYTES_LOW + above9 * 39 + above61 * 4 - above35 * 58 - above62 * 60;
+}
+
+PS_TARGET("bmi2")
+void ps_unpack_bmi2(const PackedString ps, char* buffer) {
+    const u8 length = ps_length(ps);
+    u64 c[3];
+    ps_spread(ps.lo, ps.hi, c);
+
+    // All 20 chars are written, the buffer holds PACKED_STRING_MAX_LEN + 1
+    const u64 w0 = ps_swar_to_char(c[0]);
+    const u64 w1 = ps_swar_to_char(c[1]);
+    const u32 w2 = (u32)ps_swar_to_char(c[2]);
+    memcpy(buffer, &w0, 8);
+    memcpy(buffer + 8, &w1, 8);
+    memcpy(buffer + 16, &w2, 4);
+    buffer[length] = '\0';
+}
+
+// Moves bytes in [first, last] by delta, within length
+PS_TARGET("bmi2")
+static inline PackedString ps_shift_range(const PackedString ps,
+    const u8 first, const u8 last, const i8 delta, const u8 flags) {
+    const u8 length = ps_length(ps);
+    u64 c[3];
+    ps_spread(ps.lo, ps.hi, c);
+
+    const u64 above = (0x80 - first) * PS_BYTES_LOW;   // b + above has bit 7 iff b >= first
+    const u64 below = (0x80 + last) * PS_BYTES_LOW;    // below - b has bit 7 iff b <= last
+
+    for (u8 w = 0; w < 3; w++) {
+        const u64 b = c[w];
+        const u64 hit = ((b + above) & (below - b) & PS_BYTES_HIGH & ps_live_bytes(length, w)) >> 7;
+        c[w] = delta > 0 ? b + hit * (u64)delta : b - hit * (u64)-delta;
+    }
+
+    u64 lo, hi;
+    ps_gather(c, &lo, &hi);
+    ps_insert_metadata(&hi, ps_pack_metadata(length, flags));
+    return (PackedString){ .lo = lo, .hi = hi };
+}
+
+PS_TARGET("bmi2")
+PackedString ps_to_lower_bmi2(const PackedString ps) {
+    if (!ps_valid(ps)) return ps;
+    return ps_shift_range(ps, 36, 61, -26, ps_flags(ps) & ~PACKED_FLAG_CASE_SENSITIVE);
+}
+
+PS_TARGET("bmi2")
+PackedString ps_to_upper_bmi2(const PackedString ps) {
+    if (!ps_valid(ps)) return ps;
+    return ps_shift_range(ps, 10, 35, 26, ps_flags(ps) | PACKED_FLAG_CASE_SENSITIVE);
+}
+
+// Bit i set where char i (0-19) equals sixbit
+PS_TARGET("bmi2")
+static inline u32 ps_match_bits(const u64 lo, const u64 hi, const u8 sixbit) {
+    const u64 pattern = sixbit * PS_BYTES_LOW;
+    u64 c[3];
+    ps_spread(lo, hi, c);
+
+    const u64 m0 = _pext_u64(ps_zero_bytes(c[0] ^ pattern), PS_BYTES_HIGH);
+    const u64 m1 = _pext_u64(ps_zero_bytes(c[1] ^ pattern), PS_BYTES_HIGH);
+    const u64 m2 = _pext_u64(ps_zero_bytes(c[2] ^ pattern), PS_BYTES_HIGH & 0xFFFFFFFF);
+    return (u32)(m0 | m1 << 8 | m2 << 16);
+}
+
+PS_TARGET("bmi2")
+i8 ps_find_bmi2(const u64 lo, const u64 hi, const u8 idx, const u8 sixbit) {
+    if (idx >= PACKED_STRING_MAX_LEN) return -1;
+
+    const u32 bits = ps_match_bits(lo, hi, sixbit) & ~((1u << idx) - 1);
+    return bits ? (i8)ps_ctz64(bits) : -1;
+}
+
+PS_TARGET("bmi2")
+i8 ps_reverse_find_bmi2(const u64 lo, const u64 hi, const u8 idx, const u8 sixbit) {
+    if (idx >= PACKED_STRING_MAX_LEN) return -1;
+
+    const u32 bits = ps_match_bits(lo, hi, sixbit) & ((2u << idx) - 1);
+    return bits ? (i8)(31 - __builtin_clz(bits)) : -1;
+}
+
+// ============================================================================
+// AVX2
+// ============================================================================
+
+PS_TARGET("avx2")
+static inline __m256i ps_in_range(const __m256i v, const char first, const char last) {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(first - 1))),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(last + 1)), v));
+}
+
+// Chars 0 to length - 1 in bytes of v (length <= 20), other bytes ignored
+PS_TARGET("avx2")
+static inline PackedString ps_pack_bytes_avx2(const __m256i v, const u8 length) {
+    const u32 live = (1u << length) - 1;
+
+    const __m256i digit = ps_in_range(v, '0', '9');
+    const __m256i lower = ps_in_range(v, 'a', 'z');
+    const __m256i upper = ps_in_range(v, 'A', 'Z');
+    const __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    const __m256i dollar = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$'));
+    const __m256i special = _mm256_or_si256(under, dollar);
+
+    const u32 valid = (u32)_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(digit, lower), _mm256_or_si256(upper, special)));
+    if ((valid & live) != live) return PACKED_STRING_INVALID;
+
+    u8 flags = 0;
+    if ((u32)_mm256_movemask_epi8(upper) & live) flags |= PACKED_FLAG_CASE_SENSITIVE;
+    if ((u32)_mm256_movemask_epi8(digit) & live) flags |= PACKED_FLAG_CONTAINS_DIGIT;
+    if ((u32)_mm256_movemask_epi8(special) & live) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+
+    // char - offset = sixbit
+    __m256i offset = _mm256_and_si256(digit, _mm256_set1_epi8('0'));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(lower, _mm256_set1_epi8('a' - 10)));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(upper, _mm256_set1_epi8('A' - 36)));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(under, _mm256_set1_epi8('_' - 62)));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(dollar, _mm256_set1_epi8((char)('$' - 63))));
+
+    const __m256i index = _mm256_setr_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+    const __m256i in_string = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)length), index);
+    const __m256i six = _mm256_and_si256(_mm256_sub_epi8(v, offset), in_string);
+
+    // Merge pairs to 12 bits, then pairs of those to 24 bits per dword
+    const __m256i pairs = _mm256_maddubs_epi16(six, _mm256_set1_epi16(1 | 64 << 8));
+    const __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(1 | 4096 << 16));
+
+    // Drop the empty top byte of each dword: 16 chars = 12 bytes per lane
+    const __m256i packed = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+
+    const __m128i chars0_15 = _mm256_castsi256_si128(packed);
+    const __m128i chars16_19 = _mm256_extracti128_si256(packed, 1);
+
+    const u64 lo = (u64)_mm_cvtsi128_si64(chars0_15);
+    u64 hi = (u32)_mm_extract_epi32(chars0_15, 2) | (u64)(u32)_mm_cvtsi128_si32(chars16_19) << 32;
+
+    ps_insert_metadata(&hi, ps_pack_metadata(length, flags));
+    return (PackedString){ .lo = lo, .hi = hi };
+}
+
+// Reads 32 bytes from str whatever its length; the page check keeps the
+// load inside mapped memory, which is invisible to ASan
+PS_TARGET("avx2") __attribute__((no_sanitize_address))
+PackedString ps_pack_avx2(const char* str) {
+    if (!str) return PACKED_STRING_INVALID;
+    if (((uintptr_t)str & 4095) > 4096 - 32) return ps_pack_scalar(str);
+
+    const __m256i v = _mm256_loadu_si256((const __m256i*)str);
+    const u32 nul = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+
+    // No terminator in the first 21 bytes, too long
+    if ((nul & 0x1FFFFF) == 0) return PACKED_STRING_INVALID;
+
+    return ps_pack_bytes_avx2(v, ps_ctz64(nul));
+}
+
+// Two overlapping 16-byte loads, [0, 16) and the 16 bytes ending at
+// str + length, cover any length from 16 to 20. A shorter string takes
+// one load from str unless that crosses a page, then the one ending at
+// str + length, which stays in the page. Only that short case reads
+// outside the string (invisible to ASan, as in ps_pack_avx2).
+PS_TARGET("avx2") __attribute__((no_sanitize_address))
+PackedString ps_pack_n_avx2(const char* str, const u8 length) {
+    const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i head, tail = _mm_setzero_si128();
+
+    // str may point one past the end of a mapping
+    if (length == 0) return ps_empty();
+
+    if (length >= 16) {
+        head = _mm_loadu_si128((const __m128i*)str);
+        // Char 16 + j is byte 32 - length + j of the last load
+        const __m128i last = _mm_loadu_si128((const __m128i*)(str + length - 16));
+        tail = _mm_shuffle_epi8(last, _mm_add_epi8(iota, _mm_set1_epi8((char)(32 - length))));
+    } else if (((uintptr_t)str & 4095) <= 4096 - 16) {
+        head = _mm_loadu_si128((const __m128i*)str);
+    } else {
+        // Char j is byte 16 - length + j of the last load
+        const __m128i last = _mm_loadu_si128((const __m128i*)(str + length - 16));
+        head = _mm_shuffle_epi8(last, _mm_add_epi8(iota, _mm_set1_epi8((char)(16 - length))));
+    }
+
+    return ps_pack_bytes_avx2(_mm256_set_m128i(tail, head), length);
+}
+
+// All 20 chars as ASCII: chars 0-15 in lane 0, 16-19 in the low dword of lane 1
+PS_TARGET("avx2")
+static inline __m256i ps_chars_avx2(const PackedString ps) {
+    const __m128i bits = _mm_set_epi64x((long long)(ps.hi & PS_CHARS_MASK), (long long)ps.lo);
+
+    // 3 bytes of every 4 chars into a dword: chars 0-15 in lane 0, 16-19 in lane 1
+    const __m256i groups = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(bits), _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        12, 13, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+
+    // 4 x 6 bits to 4 bytes
+    __m256i six = _mm256_and_si256(groups, _mm256_set1_epi32(0x3F));
+    six = _mm256_or_si256(six, _mm256_and_si256(_mm256_slli_epi32(groups, 2), _mm256_set1_epi32(0x3F00)));
+    six = _mm256_or_si256(six, _mm256_and_si256(_mm256_slli_epi32(groups, 4), _mm256_set1_epi32(0x3F0000)));
+    six = _mm256_or_si256(six, _mm256_and_si256(_mm256_slli_epi32(groups, 6), _mm256_set1_epi32(0x3F000000)));
+
+    // Offset of each range from a 16-entry table: 36-61 -> 0, 62 -> 1,
+    // 63 -> 2, 10-35 -> 3, 0-9 -> 4
+    const __m256i below36 = _mm256_cmpgt_epi8(_mm256_set1_epi8(36), six);
+    const __m256i below10 = _mm256_cmpgt_epi8(_mm256_set1_epi8(10), six);
+    __m256i range = _mm256_subs_epu8(six, _mm256_set1_epi8(61));
+    range = _mm256_or_si256(range, _mm256_and_si256(below36, _mm256_set1_epi8(3)));
+    range = _mm256_sub_epi8(range, below10);
+
+    const __m256i offsets = _mm256_setr_epi8(
+        'A' - 36, '_' - 62, (char)('$' - 63), 'a' - 10, '0', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        'A' - 36, '_' - 62, (char)('$' - 63), 'a' - 10, '0', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    return _mm256_add_epi8(six, _mm256_shuffle_epi8(offsets, range));
+}
+
+PS_TARGET("avx2")
+void ps_unpack_avx2(const PackedString ps, char* buffer) {
+    const u8 length = ps_length(ps);
+    const __m256i chars = ps_chars_avx2(ps);
+
+    // All 20 chars are written, the buffer holds PACKED_STRING_MAX_LEN + 1
+    const i32 tail = _mm_cvtsi128_si32(_mm256_extracti128_si256(chars, 1));
+    _mm_storeu_si128((__m128i*)buffer, _mm256_castsi256_si128(chars));
+    memcpy(buffer + 16, &tail, 4);
+    buffer[length] = '\0';
+}
+
+// Every string is stored as all 20 chars and the next one starts at its
+// length, so string i writes no further than 20 * (i + 1)
+PS_TARGET("avx2")
+size_t ps_unpack_many_avx2(const PackedString* ps, const size_t n, char* arena, size_t* offsets) {
+    size_t pos = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const __m256i chars = ps_chars_avx2(ps[i]);
+        const i32 tail = _mm_cvtsi128_si32(_mm256_extracti128_si256(chars, 1));
+
+        offsets[i] = pos;
+        _mm_storeu_si128((__m128i*)(arena + pos), _mm256_castsi256_si128(chars));
+        memcpy(arena + pos + 16, &tail, 4);
+        pos += ps_valid(ps[i]) ? ps_length(ps[i]) : 0;
+    }
+
+    offsets[n] = pos;
+    return pos;
+}
+
+PS_TARGET("avx2")
+static inline u32 ps_ident_mask32(const __m256i v) {
+    // 'a'-'z' and 'A'-'Z' in one range once bit 5 is cleared
+    const __m256i alpha = ps_in_range(_mm256_andnot_si256(_mm256_set1_epi8(0x20), v), 'A', 'Z');
+    const __m256i digit = ps_in_range(v, '0', '9');
+    const __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    const __m256i dollar = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$'));
+
+    return (u32)_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(alpha, digit), _mm256_or_si256(under, dollar)));
+}
+
+PS_TARGET("avx2")
+u64 ps_ident_mask_avx2(const char* block) {
+    const u64 m0 = ps_ident_mask32(_mm256_loadu_si256((const __m256i*)block));
+    const u64 m1 = ps_ident_mask32(_mm256_loadu_si256((const __m256i*)(block + 32)));
+    return m0 | m1 << 32;
+}
+
+// 64-bit multiply from three 32-bit ones
+PS_TARGET("avx2")
+static inline __m256i ps_mul64_avx2(const __m256i a, const u64 c) {
+    const __m256i c_lo = _mm256_set1_epi64x((long long)(c & 0xFFFFFFFF));
+    const __m256i c_hi = _mm256_set1_epi64x((long long)(c >> 32));
+
+    const __m256i lo_lo = _mm256_mul_epu32(a, c_lo);
+    const __m256i cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(a, 32), c_lo),
+        _mm256_mul_epu32(a, c_hi));
+
+    return _mm256_add_epi64(lo_lo, _mm256_slli_epi64(cross, 32));
+}
+
+PS_TARGET("avx2")
+void ps_hash64_many_avx2(const PackedString* ps, u64* out, const size_t n) {
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)(ps + i));       // lo0 hi0 lo1 hi1
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(ps + i + 2));   // lo2 hi2 lo3 hi3
+
+        // lo ^ hi as h0 h2 h1 h3, then back in order
+        __m256i h = _mm256_xor_si256(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+        h = _mm256_permute4x64_epi64(h, _MM_SHUFFLE(3, 1, 2, 0));
+
+        // MurmurHash3 64-bit finalizer, as ps_hash64
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+        h = ps_mul64_avx2(h, 0xff51afd7ed558ccdULL);
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+        h = ps_mul64_avx2(h, 0xc4ceb9fe1a85ec53ULL);
+        h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 33));
+
+        _mm256_storeu_si256((__m256i*)(out + i), h);
+    }
+
+    ps_hash64_many_scalar(ps + i, out + i, n - i);
+}
+
+PS_TARGET("avx2")
+size_t ps_decode_many_avx2(const u8* in, const size_t len, PackedString* out, const size_t n,
+    size_t* consumed) {
+    const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t pos = 0, i = 0;
+
+    // One unaligned load per record while a whole block is readable
+    for (; i < n && len - pos >= PS_ENCODED_MAX; i++) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + pos));
+        const u8 meta = in[pos];
+        const u8 length = meta >> 3;
+        const u32 bits = length <= PACKED_STRING_MAX_LEN ? length * 6u : 0;
+        const u32 payload = (bits + 7) >> 3;
+
+        // Char bits of the record, and all bytes of its payload
+        const __m128i full = _mm_cmpgt_epi8(_mm_set1_epi8((char)(bits >> 3)), iota);
+        const __m128i part = _mm_and_si128(_mm_cmpeq_epi8(iota, _mm_set1_epi8((char)(bits >> 3))),
+                                           _mm_set1_epi8((char)((1u << (bits & 7)) - 1)));
+        const __m128i keep = _mm_or_si128(full, part);
+        const __m128i bytes = _mm_cmpgt_epi8(_mm_set1_epi8((char)payload), iota);
+
+        // Payload in lanes 0-14, lane 15 is free for the metadata
+        const __m128i chars = _mm_srli_si128(v, 1);
+        if (!_mm_testz_si128(chars, _mm_andnot_si128(keep, bytes))) break;
+
+        _mm_storeu_si128((__m128i*)(out + i), _mm_insert_epi8(_mm_and_si128(chars, keep), meta, 15));
+        pos += 1 + payload;
+    }
+
+    size_t tail = 0;
+    i += ps_decode_many_scalar(in + pos, len - pos, out + i, n - i, &tail);
+    *consumed = pos + tail;
+    return i;
+}
+
+// ============================================================================
+// AVX-512
+// ============================================================================
+
+PS_TARGET("avx512f,avx512dq")
+void ps_hash64_many_avx512(const PackedString* ps, u64* out, const size_t n) {
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m512i c1 = _mm512_set1_epi64((long long)0xff51afd7ed558ccdULL);
+    const __m512i c2 = _mm512_set1_epi64((long long)0xc4ceb9fe1a85ec53ULL);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m512i a = _mm512_loadu_si512(ps + i);       // strings 0-3
+        const __m512i b = _mm512_loadu_si512(ps + i + 4);   // strings 4-7
+
+        // lo ^ hi as h0 h4 h1 h5 h2 h6 h3 h7, then back in order
+        __m512i h = _mm512_xor_si512(_mm512_unpacklo_epi64(a, b), _mm512_unpackhi_epi64(a, b));
+        h = _mm512_permutexvar_epi64(order, h);
+
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+        h = _mm512_mullo_epi64(h, c1);
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+        h = _mm512_mullo_epi64(h, c2);
+        h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 33));
+
+        _mm512_storeu_si512(out + i, h);
+    }
+
+    ps_hash64_many_scalar(ps + i, out + i, n - i);
+}
+
+PS_TARGET("avx512f,avx512bw")
+u64 ps_ident_mask_avx512(const char* block) {
+    const __m512i v = _mm512_loadu_si512(block);
+
+    // Unsigned v - first <= last - first, one compare per range
+    const __m512i alpha = _mm512_sub_epi8(_mm512_andnot_si512(_mm512_set1_epi8(0x20), v),
+                                          _mm512_set1_epi8('A'));
+    const __m512i digit = _mm512_sub_epi8(v, _mm512_set1_epi8('0'));
+
+    return _mm512_cmple_epu8_mask(alpha, _mm512_set1_epi8('Z' - 'A'))
+         | _mm512_cmple_epu8_mask(digit, _mm512_set1_epi8(9))
+         | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('_'))
+         | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('$'));
+}
+
+#endif // PS_DISPATCH_X86
@@ -3,6 +3,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include "dispatch.h"
 #include "helper.h"
 
 // ============================================================================
@@ -16,30 +17,18 @@ PackedString ps_scan(const PackedString ps) {
 
     // Scan characters in lo (0-9)
     for (u8 i = 0; i < 10 && i < len; i++) {
-        const u8 sixbit = ps_get_lo(ps.lo, i);
-
-        if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+        flags |= ps_sixbit_flags(ps_get_lo(ps.lo, i));
     }
 
     // Process character 10 if exist
     if (len > 10) {
-        const u8 sixbit = ps_get_mid(ps.lo, ps.hi);
-
-        if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+        flags |= ps_sixbit_flags(ps_get_mid(ps.lo, ps.hi));
     }
 
     // Process characters 11-19 in hi
     const u8 hi_len = len < 11 ? 0 : len - 11;
     for (u8 i = 0; i < hi_len; i++) {
-        const u8 sixbit = ps_get_hi(ps.hi, i);
-
-        if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+        flags |= ps_sixbit_flags(ps_get_hi(ps.hi, i));
     }
 
     u64 hi = ps.hi;
@@ -48,34 +37,41 @@ PackedString ps_scan(const PackedString ps) {
 }
 
 PackedString ps_pack(const char* str) {
+    return ps_kernels.pack(str);
+}
+
+PackedString ps_pack_scalar(const char* str) {
     if (!str) return PACKED_STRING_INVALID;
 
-    u64 lo = 0, hi = 0;
-    u8 length = 0, flags = 0;
+    // Reads at most one char past the limit
+    u8 length = 0;
+    while (length <= PACKED_STRING_MAX_LEN && str[length]) length++;
 
-    // Scan and analyze string
-    while (str[length] && length < PACKED_STRING_MAX_LEN) {
-        const char c = str[length];
+    // String too long, return invalid
+    if (length > PACKED_STRING_MAX_LEN) return PACKED_STRING_INVALID;
 
-        // Track information
-        if ('A' <= c && c <= 'Z') flags |= PACKED_FLAG_CASE_SENSITIVE;
-        else if ('0' <= c && c <= '9') flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (c == '_' || c == '$') flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+    return ps_pack_n_scalar(str, length);
+}
 
-        const u8 sixbit = ps_char_to_sixbit(c);
+PackedString ps_pack_n(const char* str, const size_t length) {
+    if (!str || length > PACKED_STRING_MAX_LEN) return PACKED_STRING_INVALID;
+
+    return ps_kernels.pack_n(str, (u8)length);
+}
+
+PackedString ps_pack_n_scalar(const char* str, const u8 length) {
+    u64 lo = 0, hi = 0;
+    u8 flags = 0;
+
+    for (u8 i = 0; i < length; i++) {
+        const u8 sixbit = ps_char_to_sixbit(str[i]);
         if (sixbit == UINT8_MAX) {
             // Invalid character, return invalid
             return PACKED_STRING_INVALID;
         }
 
-        ps_write_sixbit(&lo, &hi, sixbit, length * 6);
-        length++;
-    }
-
-    // Check if too long
-    if (str[length] != '\0') {
-        // String too long, return invalid
-        return PACKED_STRING_INVALID;
+        flags |= ps_sixbit_flags(sixbit);
+        ps_write_sixbit(&lo, &hi, sixbit, i * 6);
     }
 
     // Insert metadata into hi
@@ -103,15 +99,15 @@ PackedString ps_pack_ex(const char* str, const u8 length, const u8 flags) {
             is_upper = 'A' <= c && c <= 'Z',
             is_special = c == '_' || c == '$';
 
-        // Track information
-        if (is_upper) new_flags |= PACKED_FLAG_CASE_SENSITIVE;
-        else if (is_digit) new_flags |= PACKED_FLAG_CONTAINS_DIGIT;
-        else if (is_special) new_flags |= PACKED_FLAG_CONTAINS_SPECIAL;
-
         // Apply case folding if not case-sensitive
         if (cannot_have_upper && is_upper)
             c += 'a' - 'A';
 
+        // Track information, folded chars are no longer uppercase
+        if (is_upper && !cannot_have_upper) new_flags |= PACKED_FLAG_CASE_SENSITIVE;
+        else if (is_digit) new_flags |= PACKED_FLAG_CONTAINS_DIGIT;
+        else if (is_special) new_flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+
         if (cannot_have_digit && is_digit)
             return PACKED_STRING_INVALID;
 
@@ -137,6 +133,31 @@ i32 ps_unpack(const PackedString ps, char* buffer) {
     if (!buffer || !ps_valid(ps))
         return -1;
 
+    ps_kernels.unpack(ps, buffer);
+    return ps_length(ps);
+}
+
+size_t ps_unpack_many(const PackedString* ps, const size_t n, char* arena, size_t* offsets) {
+    return ps_kernels.unpack_many(ps, n, arena, offsets);
+}
+
+size_t ps_unpack_many_scalar(const PackedString* ps, const size_t n, char* arena, size_t* offsets) {
+    size_t pos = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const u8 length = ps_valid(ps[i]) ? ps_length(ps[i]) : 0;
+        offsets[i] = pos;
+
+        for (u8 c = 0; c < length; c++) {
+            arena[pos++] = ps_sixbit_to_char(ps_get_n_sixbit(ps[i].lo, ps[i].hi, c));
+        }
+    }
+
+    offsets[n] = pos;
+    return pos;
+}
+
+void ps_unpack_scalar(const PackedString ps, char* buffer) {
     const u8 length = ps_length(ps);
 
     for (u8 i = 0; i < length; i++) {
@@ -145,7 +166,6 @@ i32 ps_unpack(const PackedString ps, char* buffer) {
     }
 
     buffer[length] = '\0';
-    return length;
 }
 
 i32 ps_unpack_ex(const PackedString ps, char* buffer, const u8 length, const u8 flags) {
@@ -206,15 +226,15 @@ u8 ps_last(const PackedString ps) {
 // ============================================================================
 
 bool ps_equal_nocase(const PackedString a, const PackedString b) {
-    // Equal match (including case)
-    if (ps_equal_nometa(a, b)) return true;
-
     const u8 len_a = ps_length(a);
     const u8 len_b = ps_length(b);
 
-    // Different lengths can't be equal
+    // Different lengths can't be equal, a trailing '0' has all bits clear
     if (len_a != len_b) return false;
 
+    // Equal match (including case)
+    if (ps_equal_nometa(a, b)) return true;
+
     const u8 lo_len = len_a > 10 ? 10 : len_a;
 
     // First, handle characters 0-9 in lo
@@ -228,8 +248,8 @@ bool ps_equal_nocase(const PackedString a, const PackedString b) {
 
     // Check character 10 if present
     if (len_a > 10) {
-        const u8 a_char10 = ps_get_mid(a.lo, b.lo);
-        const u8 b_char10 = ps_get_mid(a.lo, b.lo);
+        const u8 a_char10 = ps_get_mid(a.lo, a.hi);
+        const u8 b_char10 = ps_get_mid(b.lo, b.hi);
 
         if (TO_LOWER_TABLE[a_char10] != TO_LOWER_TABLE[b_char10])
             return false;
@@ -252,52 +272,7 @@ bool ps_equal_nocase(const PackedString a, const PackedString b) {
 }
 
 i32 ps_compare(const PackedString a, const PackedString b) {
-    // Fast equality check
-    if (ps_equal_nometa(a, b)) return 0;
-
-    const u8 la = ps_length(a);
-    const u8 lb = ps_length(b);
-
-    const u8 min = la < lb ? la : lb;
-
-    /* Compare first 10 characters */
-    if (min < 10) {
-        const u64 mask = (1ULL << (min * 6)) - 1;
-        const u64 da = a.lo & mask;
-        const u64 db = b.lo & mask;
-
-        if (da != db)
-            return da < db ? -1 : 1;
-
-        return (i32)la - (i32)lb;
-    }
-
-    if (a.lo != b.lo) {
-        return a.lo < b.lo ? -1 : 1;
-    }
-
-    /* Compare middle character (char 10) */
-    if (min > 10) {
-        const u8 ca = ((a.hi & 0x3) << 4) | (a.lo >> 60);
-        const u8 cb = ((b.hi & 0x3) << 4) | (b.lo >> 60);
-
-        if (ca != cb) return ca < cb ? -1 : 1;
-    } else if (min == 10) {
-        return (i32)la - (i32)lb;
-    }
-
-    /* Compare remaining high block (11–19) */
-    if (min > 11) {
-        const u32 bits = (min - 11) * 6;
-        const u64 mask = (1ULL << bits) - 1;
-
-        const u64 ha = (a.hi >> 2) & mask;
-        const u64 hb = (b.hi >> 2) & mask;
-
-        if (ha != hb) return ha < hb ? -1 : 1;
-    }
-
-    return (i32)la - (i32)lb;
+    return ps_compare_inline(a, b);
 }
 
 // ============================================================================
@@ -371,11 +346,11 @@ PackedString ps_skip(const PackedString ps, const u8 start) {
     const u8 len = ps_length(ps);
     if (start > len) return ps_empty();
 
-    u64 lo = ps.lo, hi = ps.hi & 0x00FFFFFFFFFFFFFFFFULL;
+    u64 lo = ps.lo, hi = ps.hi & 0x00FFFFFFFFFFFFFFULL;
     ps_shr128(&lo, &hi, start * 6);
 
-    ps_insert_metadata(&hi, ps_pack_metadata(len - start, 0));
-    return (PackedString){ .lo=lo, .hi=hi };
+    // Flags of the chars that are left, so the result equals ps_pack of its text
+    return ps_scan(ps_make(lo, hi, len - start, 0));
 }
 
 PackedString ps_trunc(const PackedString ps, const u8 length) {
@@ -385,8 +360,7 @@ PackedString ps_trunc(const PackedString ps, const u8 length) {
     u64 lo = ps.lo, hi = ps.hi;
     ps_limit(&lo, &hi, length);
 
-    ps_insert_metadata(&hi, ps_pack_metadata(length, 0));
-    return (PackedString){ .lo=lo, .hi=hi };
+    return ps_scan(ps_make(lo, hi, length, 0));
 }
 
 PackedString ps_substring(const PackedString ps, const u8 start, const u8 length) {
@@ -404,10 +378,7 @@ PackedString ps_substring(const PackedString ps, const u8 start, const u8 length
 
     ps_limit(&lo, &hi, length);
 
-    const u8 meta = ps_pack_metadata(length, 0);
-    ps_insert_metadata(&hi, meta);
-
-    return (PackedString){ .lo=lo, .hi=hi };
+    return ps_scan(ps_make(lo, hi, length, 0));
 }
 
 PackedString ps_concat(const PackedString a, const PackedString b) {
@@ -424,15 +395,23 @@ PackedString ps_concat(const PackedString a, const PackedString b) {
     lo |= a.lo;
     hi |= a.hi;
 
-    const u8 new_length = len_a + len_b > 20 ? 20 : len_a + len_b;
+    // Chars of b past 20 are cut off, and their flags with them
+    if (len_a + len_b > 20) return ps_scan(ps_make(lo, hi, 20, 0));
+
     const u8 new_flags = ps_flags(a) | ps_flags(b);
-    const u8 metadata = ps_pack_metadata(new_length, new_flags);
+    const u8 metadata = ps_pack_metadata(len_a + len_b, new_flags);
     ps_insert_metadata(&hi, metadata);
 
     return (PackedString){ .lo=lo, .hi=hi };
 }
 
 PackedString ps_to_lower(const PackedString ps) {
+    return ps_kernels.to_lower(ps);
+}
+
+PackedString ps_to_lower_scalar(const PackedString ps) {
+    if (!ps_valid(ps)) return ps;   // state codes, not a length
+
     const u8 len = ps_length(ps);
     u64 lo = ps.lo, hi = ps.hi;
 
@@ -451,7 +430,7 @@ PackedString ps_to_lower(const PackedString ps) {
     }
 
     // Process characters 11-19 in hi
-    for (u8 i = 0, l = len - 11; i < l; i++) {
+    for (u8 i = 0, l = len < 11 ? 0 : len - 11; i < l; i++) {
         u8 sixbit = ps_get_hi(hi, i);
         sixbit = TO_LOWER_TABLE[sixbit];
         ps_set_hi(&hi, i, sixbit);
@@ -466,6 +445,12 @@ PackedString ps_to_lower(const PackedString ps) {
 }
 
 PackedString ps_to_upper(const PackedString ps) {
+    return ps_kernels.to_upper(ps);
+}
+
+PackedString ps_to_upper_scalar(const PackedString ps) {
+    if (!ps_valid(ps)) return ps;   // state codes, not a length
+
     const u8 len = ps_length(ps);
     u64 lo = ps.lo, hi = ps.hi;
 
@@ -484,7 +469,7 @@ PackedString ps_to_upper(const PackedString ps) {
     }
 
     // Process characters 11-19 in hi
-    for (u8 i = 0, l = len - 11; i < l; i++) {
+    for (u8 i = 0, l = len < 11 ? 0 : len - 11; i < l; i++) {
         u8 sixbit = ps_get_hi(hi, i);
         sixbit = TO_UPPER_TABLE[sixbit];
         ps_set_hi(&hi, i, sixbit);
@@ -501,11 +486,8 @@ PackedString ps_to_upper(const PackedString ps) {
 PackedString ps_pad_left(const PackedString ps, const u8 sixbit, const u8 length) {
     const u8 len = ps_length(ps);
     if (len >= length) return ps;
-    u8 flags = ps_flags(ps);
 
-    if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+    const u8 flags = ps_flags(ps) | ps_sixbit_flags(sixbit);
 
     const u8 pad_len = length - len;
     u64 pad_lo, pad_hi, lo = ps.lo, hi = ps.hi;
@@ -523,11 +505,8 @@ PackedString ps_pad_left(const PackedString ps, const u8 sixbit, const u8 length
 PackedString ps_pad_right(const PackedString ps, const u8 sixbit, const u8 length) {
     const u8 len = ps_length(ps);
     if (len >= length) return ps;
-    u8 flags = ps_flags(ps);
 
-    if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+    const u8 flags = ps_flags(ps) | ps_sixbit_flags(sixbit);
 
     const u8 pad_len = length - len;
     u64 pad_lo, pad_hi, lo = ps.lo, hi = ps.hi;
@@ -545,11 +524,8 @@ PackedString ps_pad_right(const PackedString ps, const u8 sixbit, const u8 lengt
 PackedString ps_pad_center(const PackedString ps, const u8 sixbit, const u8 length) {
     const u8 len = ps_length(ps);
     if (len >= length) return ps;
-    u8 flags = ps_flags(ps);
 
-    if (36 <= sixbit && sixbit <= 61) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
-    else if (sixbit == 62 || sixbit == 63) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+    const u8 flags = ps_flags(ps) | ps_sixbit_flags(sixbit);
 
     const u8 pad_len = length - len;
     const u8 padl_len = pad_len / 2;
@@ -579,7 +555,9 @@ i8 ps_find_six(const PackedString ps, const u8 sixbit) {
     const u8 len = ps_length(ps);
     if (len == 0) return -1;
 
-    return ps_find(ps.lo, ps.hi, 0, sixbit);
+    // '0' is all zero bits, the kernel also matches it past the end
+    const i8 idx = ps_kernels.find(ps.lo, ps.hi, 0, sixbit);
+    return idx < len ? idx : -1;
 }
 
 i8 ps_find_from_six(const PackedString ps, const u8 sixbit, const u8 start) {
@@ -588,7 +566,8 @@ i8 ps_find_from_six(const PackedString ps, const u8 sixbit, const u8 start) {
     const u8 len = ps_length(ps);
     if (start >= len) return -1;
 
-    return ps_find(ps.lo, ps.hi, start, sixbit);
+    const i8 idx = ps_kernels.find(ps.lo, ps.hi, start, sixbit);
+    return idx < len ? idx : -1;
 }
 
 i8 ps_find_last_six(const PackedString ps, const u8 sixbit) {
@@ -597,7 +576,7 @@ i8 ps_find_last_six(const PackedString ps, const u8 sixbit) {
     const u8 len = ps_length(ps);
     if (len == 0) return -1;
 
-    return ps_reverse_find(ps.lo, ps.hi, len - 1, sixbit);
+    return ps_kernels.reverse_find(ps.lo, ps.hi, len - 1, sixbit);
 }
 
 bool ps_contains_six(const PackedString ps, const u8 sixbit) {
@@ -606,7 +585,15 @@ bool ps_contains_six(const PackedString ps, const u8 sixbit) {
     const u8 len = ps_length(ps);
     if (len == 0) return false;
 
-    return ps_reverse_find(ps.lo, ps.hi, len - 1, sixbit) != -1;
+    return ps_kernels.reverse_find(ps.lo, ps.hi, len - 1, sixbit) != -1;
+}
+
+i8 ps_find_scalar(const u64 lo, const u64 hi, const u8 idx, const u8 sixbit) {
+    return ps_find(lo, hi, idx, sixbit);
+}
+
+i8 ps_reverse_find_scalar(const u64 lo, const u64 hi, const u8 idx, const u8 sixbit) {
+    return ps_reverse_find(lo, hi, idx, sixbit);
 }
 
 bool ps_contains(const PackedString ps, const PackedString pat) {
@@ -655,6 +642,15 @@ u64 ps_hash64(const PackedString ps) {
     return h;
 }
 
+void ps_hash64_many(const PackedString* ps, u64* out, const size_t n) {
+    ps_kernels.hash64_many(ps, out, n);
+}
+
+void ps_hash64_many_scalar(const PackedString* ps, u64* out, const size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = ps_hash64(ps[i]);
+}
+
 PackedString ps_lock(const PackedString ps, const PackedString key) {
     const u64 mask_hi = 0x07FFFFFFFFFFFFFFULL;  // Lower 59 bits of hi
     u64 lo = ps.lo, hi = ps.hi;
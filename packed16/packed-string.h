@@ -9,75 +9,82 @@
  *  - Shorthands: packed, ps_t
  *
  * Functions and time complexity:
+ * (100x call time is regenerated by `ps-micro -u packed16/packed-string.h`)
  * | ID   | Function                  | Complexity | 100x call time |
  * |------|---------------------------|------------|----------------|
- * | 1    | char                      | O(1)       | ?              |
- * | 2    | six                       | O(1)       | ?              |
- * | 3    | alphabet                  | O(1)       | ?              |
- * | 4    | length                    | O(1)       | ?              |
- * | 5    | flags                     | O(1)       | ?              |
- * | 6    | valid                     | O(1)       | ?              |
- * | 7    | is_empty                  | O(1)       | ?              |
- * | 8    | empty                     | O(1)       | ?              |
- * | 9    | form                      | O(1)       | ?              |
- * | 10   | make                      | O(1)       | ?              |
- * | 11   | pack                      | O(N)       | ?              |
- * | 12   | unpack                    | O(N)       | ?              |
- * | 13   | pack_ex                   | O(N)       | ?              |
- * | 14   | unpack_ex                 | O(N)       | ?              |
- * | 15   | scan                      | O(N)       | ?              |
- * | 16   | is_case_sensitive         | O(1)       | ?              |
- * | 17   | contains_digit            | O(1)       | ?              |
- * | 18   | contains_special          | O(1)       | ?              |
- * | 19   | set                       | O(1)       | ?              |
- * | 20   | at                        | O(1)       | ?              |
- * | 21   | first                     | O(1)       | ?              |
- * | 22   | last                      | O(1)       | ?              |
- * | 23   | equal                     | O(1)       | ?              |
- * | 24   | equal_nometa              | O(1)       | ?              |
- * | 25   | equal_nocase              | O(N)       | ?              |
- * | 26   | packed_compare            | O(1)       | ?              |
- * | 27   | compare                   | O(1)       | ?              |
- * | 28   | starts_with               | O(1)       | ?              |
- * | 29   | ends_with                 | O(1)       | ?              |
- * | 30   | starts_with_at            | O(1)       | ?              |
- * | 31   | ends_with_at              | O(1)       | ?              |
- * | 32   | skip                      | O(1)       | ?              |
- * | 33   | trunc                     | O(1)       | ?              |
- * | 34   | substring                 | O(1)       | ?              |
- * | 35   | concat                    | O(1)       | ?              |
- * | 36   | to_lower                  | O(N)       | ?              |
- * | 37   | to_upper                  | O(N)       | ?              |
- * | 38   | pad_left                  | O(N)       | ?              |
- * | 39   | pad_right                 | O(N)       | ?              |
- * | 40   | pad_center                | O(N)       | ?              |
- * | 41   | find_six                  | O(1)       | ?              |
- * | 42   | find_from_six             | O(1)       | ?              |
- * | 43   | find_last_six             | O(1)       | ?              |
- * | 44   | contains_six              | O(1)       | ?              |
- * | 45   | contains                  | O(N)       | ?              |
- * | 46   | hash32                    | O(1)       | ?              |
- * | 47   | hash64                    | O(1)       | ?              |
- * | 48   | table_hash                | O(1)       | ?              |
- * | 49   | lock                      | O(1)       | ?              |
- * | 50   | unlock                    | O(1)       | ?              |
- * | 51   | hex                       | O(1)       | ?              |
- * | 52   | binary                    | O(?)       | ?              |
- * | 53   | encoding_binary           | O(?)       | ?              |
- * | 54   | info                      | O(?)       | ?              |
- * | 55   | visualize_bits            | O(?)       | ?              |
- * | 56   | psd_inspect               | O(?)       | ?              |
- * | 57   | psd_cstr                  | O(?)       | ?              |
- * | 58   | psd_warper                | O(?)       | ?              |
+ * | 1    | char                      | O(1)       | 89 ns          |
+ * | 2    | six                       | O(1)       | 84 ns          |
+ * | 3    | alphabet                  | O(1)       | 86 ns          |
+ * | 4    | length                    | O(1)       | 87 ns          |
+ * | 5    | flags                     | O(1)       | 53 ns          |
+ * | 6    | valid                     | O(1)       | 88 ns          |
+ * | 7    | is_empty                  | O(1)       | 88 ns          |
+ * | 8    | empty                     | O(1)       | 45 ns          |
+ * | 9    | form                      | O(1)       | 46 ns          |
+ * | 10   | make                      | O(1)       | 125 ns         |
+ * | 11   | pack                      | O(N)       | 1045 ns        |
+ * | 12   | unpack                    | O(N)       | 935 ns         |
+ * | 13   | pack_ex                   | O(N)       | 9663 ns        |
+ * | 14   | unpack_ex                 | O(N)       | 1558 ns        |
+ * | 15   | scan                      | O(N)       | 1949 ns        |
+ * | 16   | is_case_sensitive         | O(1)       | 51 ns          |
+ * | 17   | contains_digit            | O(1)       | 65 ns          |
+ * | 18   | contains_special          | O(1)       | 67 ns          |
+ * | 19   | set                       | O(1)       | 203 ns         |
+ * | 20   | at                        | O(1)       | 224 ns         |
+ * | 21   | first                     | O(1)       | 124 ns         |
+ * | 22   | last                      | O(1)       | 212 ns         |
+ * | 23   | equal                     | O(1)       | 124 ns         |
+ * | 24   | equal_nometa              | O(1)       | 109 ns         |
+ * | 25   | equal_nocase              | O(N)       | 224 ns         |
+ * | 26   | packed_compare            | O(1)       | 170 ns         |
+ * | 27   | compare                   | O(1)       | 343 ns         |
+ * | 28   | starts_with               | O(1)       | 233 ns         |
+ * | 29   | ends_with                 | O(1)       | 332 ns         |
+ * | 30   | starts_with_at            | O(1)       | 310 ns         |
+ * | 31   | ends_with_at              | O(1)       | 360 ns         |
+ * | 32   | skip                      | O(1)       | 268 ns         |
+ * | 33   | trunc                     | O(1)       | 229 ns         |
+ * | 34   | substring                 | O(1)       | 250 ns         |
+ * | 35   | concat                    | O(1)       | 393 ns         |
+ * | 36   | to_lower                  | O(N)       | 581 ns         |
+ * | 37   | to_upper                  | O(N)       | 594 ns         |
+ * | 38   | pad_left                  | O(N)       | 679 ns         |
+ * | 39   | pad_right                 | O(N)       | 571 ns         |
+ * | 40   | pad_center                | O(N)       | 843 ns         |
+ * | 41   | find_six                  | O(1)       | 584 ns         |
+ * | 42   | find_from_six             | O(1)       | 392 ns         |
+ * | 43   | find_last_six             | O(1)       | 638 ns         |
+ * | 44   | contains_six              | O(1)       | 668 ns         |
+ * | 45   | contains                  | O(N)       | 940 ns         |
+ * | 46   | hash32                    | O(1)       | 213 ns         |
+ * | 47   | hash64                    | O(1)       | 178 ns         |
+ * | 48   | table_hash                | O(1)       | 240 ns         |
+ * | 49   | lock                      | O(1)       | 274 ns         |
+ * | 50   | unlock                    | O(1)       | 319 ns         |
+ * | 51   | hex                       | O(1)       | 14437 ns       |
+ * | 52   | binary                    | O(?)       | 1771 ns        |
+ * | 53   | encoding_binary           | O(?)       | 3913 ns        |
+ * | 54   | info                      | O(?)       | 162895 ns      |
+ * | 55   | visualize_bits            | O(?)       | 260520 ns      |
+ * | 56   | psd_inspect               | O(?)       | 15439 ns       |
+ * | 57   | psd_cstr                  | O(?)       | 972 ns         |
+ * | 58   | psd_warper                | O(?)       | 1040 ns        |
+ * | 59   | pack_n                    | O(N)       | 970 ns         |
  * 
  */
 
 #ifndef PACKED_STRING_H
 #define PACKED_STRING_H
 
+#include <stddef.h>
 #include "encoding.h"
 #include "types.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -262,6 +269,20 @@ PackedString ps_scan(PackedString ps);
  */
 PackedString ps_pack(const char* str);
 
+/**
+ * Pack the first length bytes of str, which needs no terminator.
+ * Smart flags detection. Only [str, str + length) decides the result, but
+ * the SIMD tiers load 16 bytes at a time: up to 15 bytes past
+ * str + length, or before str when it sits near the end of a page, never
+ * in a 4 KiB page the string does not touch. ASan is told to ignore
+ * these loads; Valgrind may report them.
+ *
+ * @param str String to pack
+ * @param length Length in bytes
+ * @return Packed string (invalid if str is NULL, have invalid char or length > 20)
+ */
+PackedString ps_pack_n(const char* str, size_t length);
+
 /**
  * Pack a string with exact flags (advanced use).
  * 
@@ -281,6 +302,20 @@ PackedString ps_pack_ex(const char* str, u8 length, u8 flags);
  */
 i32 ps_unpack(PackedString ps, char* buffer);
 
+/**
+ * Unpack n strings back to back, without terminators (vectorized where
+ * the CPU allows). String i is arena[offsets[i], offsets[i + 1]), invalid
+ * strings are empty. Ready for writev or a JSON emitter as is.
+ *
+ * @param ps Packed strings
+ * @param n Number of strings
+ * @param arena Output chars (n * PACKED_STRING_MAX_LEN bytes min, the
+ *        bytes after the last string may be overwritten)
+ * @param offsets Output offsets (n + 1 values)
+ * @return Total length, offsets[n]
+ */
+size_t ps_unpack_many(const PackedString* ps, size_t n, char* arena, size_t* offsets);
+
 /**
  * Unpack exact length with specified flags (advanced use).
  *
@@ -350,6 +385,21 @@ u8 ps_set(PackedString* ps, u8 index, u8 sixbit);
  */
 u8 ps_at(PackedString ps, u8 index);
 
+/**
+ * Get sixbit at position, without the bounds check of ps_at.
+ * For loops that already know index < length; past the length it reads
+ * the zero padding ('0').
+ *
+ * @param ps Packed string
+ * @param index Sixbit position (0-19)
+ * @return Sixbit
+ */
+static inline u8 ps_sixbit_at(const PackedString ps, const u8 index) {
+    if (index < 10) return ps.lo >> (index * 6) & 0x3F;
+    if (index == 10) return (ps.hi & 0x3) << 4 | ps.lo >> 60;
+    return ps.hi >> ((index - 11) * 6 + 2) & 0x3F;
+}
+
 /**
  * Get first sixbit character.
  * Faster than ps_at(ps, 0) for first char.
@@ -444,6 +494,51 @@ static inline i32 ps_packed_compare(const PackedString a, const PackedString b)
  */
 i32 ps_compare(PackedString a, PackedString b);
 
+/**
+ * Count trailing zero bits.
+ *
+ * @param x Value, must not be 0
+ * @return Index of the lowest set bit
+ */
+static inline u8 ps_ctz64(const u64 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (u8)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return (u8)index;
+#else
+    u8 n = 0;
+    for (u64 v = x; (v & 1) == 0; v >>= 1) n++;
+    return n;
+#endif
+}
+
+/**
+ * Lexicographic comparison, inline.
+ * Same result as ps_compare, for search loops where the call matters.
+ * Char 0 is in the lowest bits, so the lowest differing bit belongs to
+ * the first differing char; past the shorter length the lengths decide.
+ *
+ * @param a First packed string
+ * @param b Second packed string
+ * @return
+ *      <0 if a < b,
+ *      =0 if equal,
+ *      >0 if a > b
+ */
+static inline i32 ps_compare_inline(const PackedString a, const PackedString b) {
+    const u8 la = ps_length(a);
+    const u8 lb = ps_length(b);
+    const u64 dlo = a.lo ^ b.lo;
+    const u64 dhi = (a.hi ^ b.hi) & 0x00FFFFFFFFFFFFFFULL;
+    const u8 index = (u8)((dlo ? ps_ctz64(dlo) : dhi ? 64u + ps_ctz64(dhi) : 120u) / 6);
+
+    // index 20: no char differs (null and invalid states have lengths past 20)
+    if (index >= PACKED_STRING_MAX_LEN || index >= la || index >= lb) return (i32)la - (i32)lb;
+    return ps_sixbit_at(a, index) < ps_sixbit_at(b, index) ? -1 : 1;
+}
+
 // ============================================================================
 // STRING OPERATIONS
 // ============================================================================
@@ -488,6 +583,7 @@ bool ps_ends_with_at(PackedString ps, PackedString suffix, u8 end);
 
 /**
  * Move start of string to specified start.
+ * Flags are recomputed from the chars that are left.
  *
  * @param ps Packed string
  * @param start Starting char
@@ -497,6 +593,7 @@ PackedString ps_skip(PackedString ps, u8 start);
 
 /**
  * Truncated a string to length.
+ * Flags are recomputed from the chars that are left.
  *
  * @param ps Packed string
  * @param length Desired length
@@ -507,6 +604,7 @@ PackedString ps_trunc(PackedString ps, u8 length);
 /**
  * Get substring as new packed string.
  * Returns empty string if start ≥ length.
+ * Flags are recomputed from the chars that are left.
  * 
  * @param ps Packed string
  * @param start Starting position (0-based)
@@ -527,7 +625,8 @@ PackedString ps_concat(PackedString a, PackedString b);
 
 /**
  * Convert to lowercase (returns new packed string).
- * CASE_SENSITIVE flag will be cleared.
+ * CASE_SENSITIVE flag will be cleared. Invalid, null and empty-state
+ * strings are returned unchanged.
  * 
  * @param ps Packed string to convert
  * @return Lowercase version
@@ -536,7 +635,8 @@ PackedString ps_to_lower(PackedString ps);
 
 /**
  * Convert to uppercase (returns new packed string).
- * CASE_SENSITIVE flag will be set.
+ * CASE_SENSITIVE flag will be set. Invalid, null and empty-state
+ * strings are returned unchanged.
  * 
  * @param ps Packed string to convert
  * @return Uppercase version
@@ -643,6 +743,35 @@ u32 ps_hash32(PackedString ps);
  */
 u64 ps_hash64(PackedString ps);
 
+/**
+ * ps_hash64 of n packed strings at once (vectorized where the CPU allows).
+ *
+ * @param ps Packed strings
+ * @param out Output hashes (n values)
+ * @param n Number of strings
+ */
+void ps_hash64_many(const PackedString* ps, u64* out, size_t n);
+
+/**
+ * 64-bit hash of two words, inline: lo ^ hi * 2^64/phi through the
+ * MurmurHash3 finalizer. The multiply keeps lo == hi from cancelling out.
+ * The key hash of psrh_map, psin_pool, psbf_filter, psph_map and
+ * ps::packed, whose stored tables and snapshots depend on its values.
+ *
+ * @param lo Lower 64 bits
+ * @param hi Upper 64 bits
+ * @return 64-bit hash value
+ */
+static inline u64 ps_mix64(const u64 lo, const u64 hi) {
+    u64 x = lo ^ hi * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
 /**
  * Hash suitable for hash tables (combines 32-bit hash with length).
  * 
@@ -685,6 +814,178 @@ PackedString ps_unlock(PackedString ps, PackedString key);
  */
 bool ps_is_valid_identifier(PackedString ps);
 
+// ============================================================================
+// TOKENIZER
+// ============================================================================
+
+/**
+ * Identifier run found by ps_tokenize: a maximal run of [0-9A-Za-z_$].
+ * Runs longer than PACKED_STRING_MAX_LEN are reported with their full
+ * length and ps = PACKED_STRING_INVALID.
+ */
+typedef struct {
+    PackedString ps;    // Packed run, exact flags
+    size_t offset;      // Byte offset of the run in the source
+    size_t length;      // Run length in bytes
+} PsToken;
+
+/**
+ * Resumable scan over a byte buffer. The buffer needs no terminator
+ * and is never written or copied; its end also ends a run.
+ */
+typedef struct {
+    const char* src;
+    size_t len;
+    size_t pos;         // Next byte to scan, never inside a run
+} PsTokenizer;
+
+/**
+ * Start scanning src.
+ *
+ * @param tk Tokenizer state
+ * @param src Source bytes
+ * @param len Source length in bytes
+ */
+void ps_tokenizer_init(PsTokenizer* tk, const char* src, size_t len);
+
+/**
+ * Find the next identifier runs in source order and pack them.
+ * Call again with the same state until it returns 0.
+ *
+ * @param tk Tokenizer state
+ * @param out Output tokens (cap entries)
+ * @param cap Output capacity, must be > 0
+ * @return Number of tokens written, 0 at the end of the source
+ */
+size_t ps_tokenize(PsTokenizer* tk, PsToken* out, size_t cap);
+
+// ============================================================================
+// SERIALIZATION
+// ============================================================================
+
+/**
+ * Compact records: the metadata byte (hi >> 56), then the length * 6
+ * char bits as ceil(length * 6 / 8) little-endian bytes. Unused bits of
+ * the last byte are zero. Lengths above 20 (PSC_INVALID and the other
+ * state codes) are the metadata byte alone. Records are 1 to 16 bytes.
+ */
+#define PS_ENCODED_MAX 16
+
+/**
+ * Record size from its first (metadata) byte.
+ *
+ * @param meta Metadata byte
+ * @return Record size in bytes, 1 to PS_ENCODED_MAX
+ */
+static inline size_t ps_record_size(const u8 meta) {
+    const u8 length = meta >> 3;
+    return length > PACKED_STRING_MAX_LEN ? 1 : 1 + (length * 6u + 7) / 8;
+}
+
+/** Bytes ps_encode writes for ps */
+static inline size_t ps_encoded_size(const PackedString ps) {
+    return ps_record_size((u8)(ps.hi >> 56));
+}
+
+/**
+ * Write one record.
+ *
+ * @param ps Packed string
+ * @param out Output (PS_ENCODED_MAX bytes min, all may be written)
+ * @return Record size (ps_encoded_size)
+ */
+size_t ps_encode(PackedString ps, u8* out);
+
+/**
+ * Read one record.
+ *
+ * @param in Input bytes
+ * @param len Input length
+ * @param out Decoded packed string
+ * @return Record size, 0 if in is shorter than ps_record_size(in[0])
+ *         or the record has bits set past its length
+ */
+size_t ps_decode(const u8* in, size_t len, PackedString* out);
+
+/**
+ * Write n records back to back.
+ *
+ * @param ps Packed strings
+ * @param n Number of strings
+ * @param out Output (n * PS_ENCODED_MAX bytes min)
+ * @return Bytes written
+ */
+size_t ps_encode_many(const PackedString* ps, size_t n, u8* out);
+
+/**
+ * Read up to n records (vectorized where the CPU allows).
+ * Stops early at a record cut off by the end of in, so a stream can be
+ * decoded chunk by chunk from *consumed, or at a malformed record
+ * (ps_record_size(in[*consumed]) <= len - *consumed).
+ *
+ * @param in Input bytes
+ * @param len Input length
+ * @param out Output packed strings (n entries)
+ * @param n Max records
+ * @param consumed Bytes read (records decoded in full)
+ * @return Number of records decoded
+ */
+size_t ps_decode_many(const u8* in, size_t len, PackedString* out, size_t n, size_t* consumed);
+
+// ============================================================================
+// CPU DISPATCH
+// ============================================================================
+
+/**
+ * Implementation tiers of the hot functions (pack, unpack, case
+ * conversion, find, hash64_many), from portable C to AVX-512.
+ * The best tier the CPU supports is picked once at load time,
+ * except BMI2 kernels are skipped where PDEP is microcoded (AMD
+ * before Zen 3) unless the bmi2 tier is forced.
+ *
+ * The PS_TIER environment variable (scalar, bmi2, avx2, avx512)
+ * forces a lower tier for testing and benchmarking.
+ * All tiers produce identical results.
+ */
+typedef enum {
+    PS_TIER_SCALAR,
+    PS_TIER_BMI2,
+    PS_TIER_AVX2,
+    PS_TIER_AVX512,
+    PS_TIER_COUNT
+} PsTier;
+
+/** Best tier supported by this CPU */
+PsTier ps_cpu_tier(void);
+
+/** Tier in use */
+PsTier ps_tier(void);
+
+/**
+ * Switch the tier in use.
+ * Not thread safe, call before other threads use the library.
+ *
+ * @param tier Tier to use
+ * @return false if the CPU does not support tier (tier in use is kept)
+ */
+bool ps_set_tier(PsTier tier);
+
+/**
+ * Tier name as accepted by PS_TIER.
+ *
+ * @param tier Tier
+ * @return Name, or "?" if tier is out of range
+ */
+const char* ps_tier_name(PsTier tier);
+
+/**
+ * Parse a tier name.
+ *
+ * @param name Tier name (scalar, bmi2, avx2 or avx512)
+ * @return Tier, or PS_TIER_COUNT if name is unknown
+ */
+PsTier ps_tier_parse(const char* name);
+
 // ============================================================================
 // DEBUGGING & FORMATTING
 // ============================================================================
@@ -0,0 +1,175 @@
+/**
+ * @file packed-string.hpp
+ * C++ value type over PackedString (C++20, header-only)
+ *
+ * ps::packed is a trivially copyable 16-byte wrapper with the C layout,
+ * so arrays of it can be passed to the ps_*_many functions as is.
+ *
+ *  - Construction from string literals is constexpr, "name"_ps rejects
+ *    bad literals at compile time.
+ *  - == compares chars and length (two 64-bit compares, flags masked
+ *    out), <=> is ps_compare: chars in sixbit order (0-9 < a-z < A-Z <
+ *    _ < $), then length. Both ignore the flags, so they always agree.
+ *  - std::hash<ps::packed> mixes both words without the flags, usable in
+ *    unordered containers as is.
+ *  - view() unpacks into a caller or thread-local buffer.
+ */
+
+#ifndef PACKED_STRING_HPP
+#define PACKED_STRING_HPP
+
+#include "packed-string.h"
+
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ps {
+
+namespace detail {
+
+// ps_char_to_sixbit, usable in constant expressions
+constexpr u8 sixbit(const char c) noexcept {
+    if ('0' <= c && c <= '9') return (u8)(c - '0');
+    if ('a' <= c && c <= 'z') return (u8)(c - 'a' + 10);
+    if ('A' <= c && c <= 'Z') return (u8)(c - 'A' + 36);
+    if (c == '_') return 62;
+    if (c == '$') return 63;
+    return UINT8_MAX;
+}
+
+// ps_pack_n_scalar, usable in constant expressions
+constexpr PackedString pack(const std::string_view s) noexcept {
+    constexpr PackedString invalid{0, (u64)PSC_INVALID << 59};
+    if (s.size() > PACKED_STRING_MAX_LEN) return invalid;
+
+    u64 lo = 0, hi = 0;
+    u8 flags = 0;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        const u8 six = sixbit(s[i]);
+        if (six == UINT8_MAX) return invalid;
+
+        if (36 <= six && six <= 61) flags |= PACKED_FLAG_CASE_SENSITIVE;
+        else if (six <= 9) flags |= PACKED_FLAG_CONTAINS_DIGIT;
+        else if (six >= 62) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+
+        // ps_write_sixbit, char 10 straddles lo and hi
+        const std::size_t bit = i * 6;
+        if (bit < 60) {
+            lo |= (u64)six << bit;
+        } else if (bit == 60) {
+            lo |= (u64)(six & 0xF) << 60;
+            hi |= six >> 4;
+        } else {
+            hi |= (u64)six << (bit - 64);
+        }
+    }
+
+    hi |= (u64)(s.size() << 3 | flags) << 56;
+    return PackedString{lo, hi};
+}
+
+} // namespace detail
+
+/** PackedString with value semantics, operators and constexpr construction. */
+class packed {
+public:
+    /** Empty string, same bits as ps_empty(). */
+    constexpr packed() noexcept = default;
+
+    /** Wrap a PackedString as is. */
+    constexpr packed(const PackedString v) noexcept : v_(v) {}
+
+    /** Pack a literal, invalid (like ps_pack) for bad chars or more than 20. */
+    template <std::size_t N>
+    constexpr packed(const char (&str)[N]) noexcept
+        : packed(std::string_view(str, std::char_traits<char>::length(str))) {}
+
+    /** Pack a string, at run time through the dispatched ps_pack_n. */
+    constexpr explicit packed(const std::string_view str) noexcept
+        : v_(std::is_constant_evaluated() ? detail::pack(str)
+                                          : ps_pack_n(str.data() ? str.data() : "", str.size())) {}
+
+    /** The wrapped PackedString, for the C API. */
+    constexpr operator PackedString() const noexcept { return v_; }
+    constexpr PackedString get() const noexcept { return v_; }
+
+    /** Length in chars, or the state code (21-31) of a non-string. */
+    constexpr u8 length() const noexcept { return (u8)(v_.hi >> 59); }
+    constexpr u8 flags() const noexcept { return (u8)(v_.hi >> 56 & 0x7); }
+    constexpr bool valid() const noexcept { return length() <= PACKED_STRING_MAX_LEN; }
+    constexpr bool empty() const noexcept { return length() == 0; }
+
+    /**
+     * Unpack into buffer, which needs PACKED_STRING_MAX_LEN + 1 bytes.
+     * Invalid strings give an empty view.
+     */
+    std::string_view view(char* buffer) const noexcept {
+        const i32 n = ps_unpack(v_, buffer);
+        return std::string_view(buffer, n < 0 ? 0 : (std::size_t)n);
+    }
+
+    /**
+     * Unpack into a thread-local buffer. Warning: the view is only valid
+     * until the next view() call on the same thread, copy it to keep it.
+     */
+    std::string_view view() const noexcept {
+        thread_local char buffer[PACKED_STRING_MAX_LEN + 1];
+        return view(buffer);
+    }
+
+    explicit operator std::string_view() const noexcept { return view(); }
+
+    std::string str() const {
+        char buffer[PACKED_STRING_MAX_LEN + 1];
+        return std::string(view(buffer));
+    }
+
+    /** 64-bit hash, ps_mix64 of both words without the flags. */
+    u64 hash() const noexcept { return ps_mix64(v_.lo, v_.hi & NO_FLAGS); }
+
+    /**
+     * Chars and length, flags left out: they only summarise the chars and
+     * may be stale after ps_set, so == stays consistent with <=>.
+     */
+    friend constexpr bool operator==(const packed a, const packed b) noexcept {
+        return a.v_.lo == b.v_.lo && (a.v_.hi & NO_FLAGS) == (b.v_.hi & NO_FLAGS);
+    }
+
+    /** ps_compare, weak because values with different flags compare equal. */
+    friend std::weak_ordering operator<=>(const packed a, const packed b) noexcept {
+        return ps_compare(a.v_, b.v_) <=> 0;
+    }
+
+private:
+    // hi without the flag bits 56-58, the length stays
+    static constexpr u64 NO_FLAGS = ~(0x7ULL << 56);
+
+    PackedString v_{};
+};
+
+static_assert(std::is_trivially_copyable_v<packed>);
+static_assert(sizeof(packed) == sizeof(PackedString));
+
+inline namespace literals {
+
+/** "name"_ps, a compile error for bad chars or more than 20. */
+consteval packed operator""_ps(const char* str, const std::size_t length) {
+    const packed p{detail::pack(std::string_view(str, length))};
+    if (!p.valid()) throw "not a PackedString literal: bad char or more than 20 chars";
+    return p;
+}
+
+} // namespace literals
+
+} // namespace ps
+
+template <>
+struct std::hash<ps::packed> {
+    std::size_t operator()(const ps::packed p) const noexcept { return (std::size_t)p.hash(); }
+};
+
+#endif // PACKED_STRING_HPP
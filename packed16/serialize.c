@@ -0,0 +1,96 @@
+#include "packed-string.h"
+
+#include <string.h>
+#include "dispatch.h"
+#include "helper.h"
+
+// Byte j of a record payload is bits 8j to 8j + 7 of the char stream,
+// lo first, then the low 56 bits of hi; the layout is the same on every
+// host. Records are written through a PS_ENCODED_MAX scratch block, so
+// ps_encode_many stores whole blocks and only advances by the record size.
+
+// ============================================================================
+// ENCODING
+// ============================================================================
+
+static inline void ps_store_le(u8* out, const u64 v, const size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (u8)(v >> (i * 8));
+}
+
+static inline u64 ps_load_le(const u8* in, const size_t n) {
+    u64 v = 0;
+    for (size_t i = 0; i < n; i++) v |= (u64)in[i] << (i * 8);
+    return v;
+}
+
+// Full PS_ENCODED_MAX block, bytes past the record size are zero
+static inline size_t ps_encode_block(const PackedString ps, u8 block[PS_ENCODED_MAX]) {
+    const u8 meta = (u8)(ps.hi >> 56);
+    const size_t size = ps_record_size(meta);
+
+    // Bits past the length are dropped, state codes keep no chars at all
+    u64 lo = ps.lo, hi = ps.hi;
+    ps_limit(&lo, &hi, size > 1 ? meta >> 3 : 0);
+
+    block[0] = meta;
+    ps_store_le(block + 1, lo, 8);
+    ps_store_le(block + 9, hi, 7);
+
+    return size;
+}
+
+size_t ps_encode(const PackedString ps, u8* out) {
+    return ps_encode_block(ps, out);
+}
+
+size_t ps_encode_many(const PackedString* ps, const size_t n, u8* out) {
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        pos += ps_encode_block(ps[i], out + pos);
+    }
+    return pos;
+}
+
+// ============================================================================
+// DECODING
+// ============================================================================
+
+size_t ps_decode(const u8* in, const size_t len, PackedString* out) {
+    if (len == 0) return 0;
+
+    const u8 meta = in[0];
+    const size_t size = ps_record_size(meta);
+    if (len < size) return 0;
+
+    const size_t payload = size - 1;
+    u64 lo = ps_load_le(in + 1, payload < 8 ? payload : 8);
+    u64 hi = payload > 8 ? ps_load_le(in + 9, payload - 8) : 0;
+
+    // Canonical records only: no bits past the length
+    const u64 raw_lo = lo, raw_hi = hi;
+    ps_limit(&lo, &hi, payload ? meta >> 3 : 0);
+    if (lo != raw_lo || hi != raw_hi) return 0;
+
+    ps_insert_metadata(&hi, meta);
+    *out = (PackedString){ .lo = lo, .hi = hi };
+    return size;
+}
+
+size_t ps_decode_many(const u8* in, const size_t len, PackedString* out, const size_t n,
+    size_t* consumed) {
+    return ps_kernels.decode_many(in, len, out, n, consumed);
+}
+
+size_t ps_decode_many_scalar(const u8* in, const size_t len, PackedString* out, const size_t n,
+    size_t* consumed) {
+    size_t pos = 0, i = 0;
+
+    for (; i < n; i++) {
+        const size_t size = ps_decode(in + pos, len - pos, &out[i]);
+        if (size == 0) break;
+        pos += size;
+    }
+
+    *consumed = pos;
+    return i;
+}
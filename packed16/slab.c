@@ -0,0 +1,104 @@
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "aligned.h"
+
+// Chunks are never returned to the system before ps_slab_destroy: a reset
+// only rewinds slab->used, so the next caches get the same chunks in the
+// same order and a rebuilt structure lands on warm, already faulted pages.
+
+// ============================================================================
+// SLAB
+// ============================================================================
+
+static inline void ps_slab_lock(PsSlab* slab) {
+    while (atomic_flag_test_and_set_explicit(&slab->lock, memory_order_acquire)) {
+    }
+}
+
+static inline void ps_slab_unlock(PsSlab* slab) {
+    atomic_flag_clear_explicit(&slab->lock, memory_order_release);
+}
+
+void ps_slab_init(PsSlab* slab) {
+    slab->chunks = NULL;
+    slab->used = 0;
+    slab->count = 0;
+    slab->capacity = 0;
+    atomic_flag_clear(&slab->lock);
+    atomic_init(&slab->generation, 0);
+}
+
+void ps_slab_destroy(PsSlab* slab) {
+    for (size_t i = 0; i < slab->count; i++) ps_aligned_free(slab->chunks[i]);
+    free(slab->chunks);
+
+    slab->chunks = NULL;
+    slab->used = 0;
+    slab->count = 0;
+    slab->capacity = 0;
+    atomic_fetch_add(&slab->generation, 1);
+}
+
+void ps_slab_reset(PsSlab* slab) {
+    ps_slab_lock(slab);
+    slab->used = 0;
+    atomic_fetch_add_explicit(&slab->generation, 1, memory_order_relaxed);
+    ps_slab_unlock(slab);
+}
+
+size_t ps_slab_bytes(const PsSlab* slab) {
+    return slab->count * (size_t)PS_SLAB_CHUNK;
+}
+
+// Grows chunks[] to hold one more chunk, called with the lock held
+static bool ps_slab_grow(PsSlab* slab) {
+    if (slab->count < slab->capacity) return true;
+
+    const size_t cap = slab->capacity ? slab->capacity * 2 : 16;
+    u8** chunks = realloc(slab->chunks, cap * sizeof(u8*));
+    if (!chunks) return false;
+
+    slab->chunks = chunks;
+    slab->capacity = cap;
+    return true;
+}
+
+// Next chunk, reused from before a reset when there is one
+static u8* ps_slab_chunk(PsSlab* slab) {
+    u8* chunk = NULL;
+    ps_slab_lock(slab);
+
+    if (slab->used < slab->count) {
+        chunk = slab->chunks[slab->used++];
+    } else if (ps_slab_grow(slab)) {
+        chunk = ps_aligned_alloc(PS_SLAB_CHUNK, PS_SLAB_ALIGN);
+        if (chunk) {
+            slab->chunks[slab->count++] = chunk;
+            slab->used = slab->count;
+        }
+    }
+
+    ps_slab_unlock(slab);
+    return chunk;
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+
+void ps_slab_cache_init(PsSlabCache* cache, PsSlab* slab) {
+    memset(cache, 0, sizeof(*cache));
+    cache->slab = slab;
+    cache->generation = atomic_load_explicit(&slab->generation, memory_order_relaxed);
+}
+
+void* ps_slab_refill(PsSlabCache* cache, const u8 c) {
+    u8* chunk = ps_slab_chunk(cache->slab);
+    if (!chunk) return NULL;
+
+    cache->next[c] = chunk + ((size_t)PS_SLAB_MIN << c);
+    cache->end[c] = chunk + PS_SLAB_CHUNK;
+    return chunk;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file slab.h
+ * Fixed-size object pool for PackedString-keyed nodes
+ *
+ * API prefix: 'ps_slab_'
+ *
+ * Objects come in three size classes, 32, 64 and 128 bytes: a 16-byte
+ * key plus up to 16, 48 or 112 bytes of payload. They are carved from
+ * 64 KiB chunks that are cache-line aligned, so a 64 or 128-byte object
+ * starts a cache line and a 32-byte object never straddles one.
+ *
+ * A PsSlab owns the chunks and is shared by all threads. Each thread
+ * allocates through its own PsSlabCache, which keeps one free list and
+ * one partly used chunk per class: ps_slab_alloc and ps_slab_free touch
+ * only the cache, the slab lock is taken once per chunk.
+ *
+ * ps_slab_reset returns every object at once and keeps the chunks for
+ * reuse; caches drop their lists on their next call. Objects from before
+ * a reset must not be freed after it.
+ */
+
+#ifndef PACKED_SLAB_H
+#define PACKED_SLAB_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "types.h"
+
+#define PS_SLAB_CLASSES 3
+#define PS_SLAB_MIN     32                // smallest class, in bytes
+#define PS_SLAB_MAX     128               // largest class, in bytes
+#define PS_SLAB_CHUNK   (64 * 1024)       // bytes per chunk
+#define PS_SLAB_ALIGN   64                // chunk alignment
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Chunk depot shared by the caches of all threads. */
+typedef struct {
+    u8**         chunks;      // every chunk, handed out in this order
+    size_t       used;        // chunks handed out since the last reset
+    size_t       count;       // chunks allocated
+    size_t       capacity;    // of chunks[]
+    atomic_flag  lock;        // guards the fields above
+    atomic_uint  generation;  // bumped by ps_slab_reset
+} PsSlab;
+
+/** Per-thread allocation state, never shared between threads. */
+typedef struct {
+    PsSlab*  slab;
+    void*    free[PS_SLAB_CLASSES];  // freed objects, linked through their first word
+    u8*      next[PS_SLAB_CLASSES];  // unused part of the current chunk
+    u8*      end[PS_SLAB_CLASSES];
+    unsigned generation;
+} PsSlabCache;
+
+/**
+ * Initialize an empty slab, no memory is allocated until the first object.
+ *
+ * @param slab Slab to initialize
+ */
+void ps_slab_init(PsSlab* slab);
+
+/**
+ * Release every chunk. Caches of the slab must not be used afterwards.
+ *
+ * @param slab Slab to destroy
+ */
+void ps_slab_destroy(PsSlab* slab);
+
+/**
+ * Free every object of every cache at once, keeping the chunks for reuse.
+ * No cache of the slab may be in use during the call.
+ *
+ * @param slab Slab to reset
+ */
+void ps_slab_reset(PsSlab* slab);
+
+/**
+ * Bytes held by the slab, in whole chunks.
+ *
+ * @param slab Slab to measure
+ * @return Chunk memory, used or not
+ */
+size_t ps_slab_bytes(const PsSlab* slab);
+
+/**
+ * Initialize a cache for the calling thread, or drop its state after a
+ * reset. Caches need no cleanup, their objects belong to the slab.
+ *
+ * @param cache Cache to initialize
+ * @param slab Slab to allocate from
+ */
+void ps_slab_cache_init(PsSlabCache* cache, PsSlab* slab);
+
+/**
+ * Take a new chunk for class c and carve the first object from it.
+ * Slow path of ps_slab_alloc.
+ *
+ * @param cache Cache of the calling thread
+ * @param c Size class index
+ * @return Object or NULL when out of memory
+ */
+void* ps_slab_refill(PsSlabCache* cache, u8 c);
+
+/** Drop the state of a cache that has not seen the last reset. */
+static inline void ps_slab_sync(PsSlabCache* cache) {
+    if (cache->generation != atomic_load_explicit(&cache->slab->generation, memory_order_relaxed))
+        ps_slab_cache_init(cache, cache->slab);
+}
+
+/**
+ * Size class index of an object size.
+ *
+ * @param size Object size in bytes, 1 to PS_SLAB_MAX
+ * @return 0 for 32 bytes, 1 for 64, 2 for 128
+ */
+static inline u8 ps_slab_class(const size_t size) {
+    return (u8)((size > PS_SLAB_MIN) + (size > PS_SLAB_MIN * 2));
+}
+
+/**
+ * Allocate one object of at least size bytes, aligned to its class size
+ * up to PS_SLAB_ALIGN.
+ *
+ * @param cache Cache of the calling thread
+ * @param size Object size, 1 to PS_SLAB_MAX
+ * @return Object or NULL when size is out of range or memory runs out
+ */
+static inline void* ps_slab_alloc(PsSlabCache* cache, const size_t size) {
+    if (size == 0 || size > PS_SLAB_MAX) return NULL;
+
+    ps_slab_sync(cache);
+    const u8 c = ps_slab_class(size);
+
+    void* obj = cache->free[c];
+    if (obj) {
+        cache->free[c] = *(void**)obj;
+        return obj;
+    }
+
+    if (cache->next[c] == cache->end[c]) return ps_slab_refill(cache, c);
+
+    obj = cache->next[c];
+    cache->next[c] += (size_t)PS_SLAB_MIN << c;
+    return obj;
+}
+
+/**
+ * Return an object to the free list of the calling thread's cache.
+ * Objects may be freed by another thread than the one that allocated
+ * them, the size must fall in the class they were allocated with.
+ *
+ * @param cache Cache of the calling thread
+ * @param obj Object from ps_slab_alloc on the same slab, or NULL
+ * @param size Size passed to ps_slab_alloc
+ */
+static inline void ps_slab_free(PsSlabCache* cache, void* obj, const size_t size) {
+    if (!obj) return;
+
+    ps_slab_sync(cache);
+    const u8 c = ps_slab_class(size);
+    *(void**)obj = cache->free[c];
+    cache->free[c] = obj;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKED_SLAB_H
@@ -0,0 +1,98 @@
+#include "packed-string.h"
+
+#include <string.h>
+#include "dispatch.h"
+#include "helper.h"
+
+// Runs are found 64 bytes at a time: ps_kernels.ident_mask turns a block
+// into one bit per identifier byte, run starts are the set bits whose
+// lower neighbour is clear. Only a run crossing the block end needs the
+// following blocks, everything else is bit arithmetic on one word.
+
+// ============================================================================
+// CHARACTER CLASSES
+// ============================================================================
+
+u64 ps_ident_mask_scalar(const char* block) {
+    u64 mask = 0;
+    for (u8 i = 0; i < 64; i++) {
+        mask |= (u64)ps_char_valid(block[i]) << i;
+    }
+    return mask;
+}
+
+// Identifier bytes of src[pos, pos + 64), bits past len are clear
+static inline u64 ps_ident_bits(const char* src, const size_t len, const size_t pos) {
+    if (len - pos >= 64) return ps_kernels.ident_mask(src + pos);
+
+    // NUL is not an identifier byte
+    char tail[64] = {0};
+    memcpy(tail, src + pos, len - pos);
+    return ps_kernels.ident_mask(tail);
+}
+
+// End of the run that covers all of src[pos, pos + 64) and goes on
+static size_t ps_run_end(const char* src, const size_t len, size_t pos) {
+    for (;;) {
+        const u64 ident = ps_ident_bits(src, len, pos);
+        if (~ident) return pos + ps_ctz64(~ident);
+        pos += 64;
+    }
+}
+
+// ============================================================================
+// TOKENIZER
+// ============================================================================
+
+void ps_tokenizer_init(PsTokenizer* tk, const char* src, const size_t len) {
+    tk->src = src;
+    tk->len = src ? len : 0;
+    tk->pos = 0;
+}
+
+size_t ps_tokenize(PsTokenizer* tk, PsToken* out, const size_t cap) {
+    const char* src = tk->src;
+    const size_t len = tk->len;
+    size_t pos = tk->pos;
+    size_t n = 0;
+
+    while (pos < len && n < cap) {
+        const u64 ident = ps_ident_bits(src, len, pos);
+
+        // src[pos - 1] is never part of a run, so bit 0 starts one if set
+        u64 starts = ident & ~(ident << 1);
+        size_t next = pos + 64;
+
+        while (starts) {
+            const u8 s = ps_ctz64(starts);
+            const size_t start = pos + s;
+
+            // Out of room, resume at this run
+            if (n == cap) {
+                tk->pos = start;
+                return n;
+            }
+
+            // Clear bits above s, or none when the run reaches bit 63
+            const u64 after = ~ident >> s;
+            const size_t end = after ? start + ps_ctz64(after) : ps_run_end(src, len, pos + 64);
+            const size_t length = end - start;
+
+            out[n++] = (PsToken){
+                .ps = length <= PACKED_STRING_MAX_LEN
+                    ? ps_kernels.pack_n(src + start, (u8)length)
+                    : PACKED_STRING_INVALID,
+                .offset = start,
+                .length = length,
+            };
+
+            if (end > next) next = end;
+            starts &= starts - 1;
+        }
+
+        pos = next;
+    }
+
+    tk->pos = pos < len ? pos : len;
+    return n;
+}
@@ -0,0 +1,290 @@
+#include "../packed16/packed-string.h"
+#include "../hash-table/ps-robinhood.h"
+#include "ps-stree.h"
+#include "ps-fcdict.h"
+#include "../bench/workload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Usage: benchmark [N]   (default 1000000, try up to 100000000)
+//
+// The front-coded dictionary is also built over N generated identifiers,
+// which share prefixes the way real symbol tables do, to report its size.
+
+#define STR_MAX 20
+#define BOUND_PROBES 64    // each is a linear pass over the keys
+
+static const char ALPHABET[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static ps_t random_ps(void) {
+    char buffer[STR_MAX + 1];
+    const int len = (int)(rng() % STR_MAX) + 1;
+
+    for (int i = 0; i < len; ++i)
+        buffer[i] = ALPHABET[rng() & 63];
+    buffer[len] = '\0';
+
+    return ps_pack(buffer);
+}
+
+static int compare_ps(const void* a, const void* b) {
+    return ps_compare(*(const ps_t*)a, *(const ps_t*)b);
+}
+
+int main(const int argc, char** argv) {
+    const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    ps_t* keys = malloc(n * sizeof(ps_t));
+    ps_t* queries = malloc(n * sizeof(ps_t));
+    ps_t* missing = malloc(n * sizeof(ps_t));
+    if (!keys || !queries || !missing) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = random_ps();
+        missing[i] = random_ps();
+    }
+
+    // Queries hit every key in random order
+    memcpy(queries, keys, n * sizeof(ps_t));
+    for (size_t i = n; i > 1; --i) {
+        const size_t j = rng() % i;
+        const ps_t tmp = queries[i - 1];
+        queries[i - 1] = queries[j];
+        queries[j] = tmp;
+    }
+
+    printf("N = %zu\n\n", n);
+
+    double t0, t1, t2;
+    size_t found = 0;
+    volatile uint64_t sink = 0;
+
+    // =========================
+    // S+ TREE
+    // =========================
+
+    psst_index tree;
+
+    t0 = now_seconds();
+    if (!psst_build(&tree, keys, n)) {
+        fprintf(stderr, "psst_build failed\n");
+        return 1;
+    }
+    t1 = now_seconds();
+
+    for (size_t i = 0; i < n; ++i)
+        sink += psst_lower_bound(&tree, queries[i]);
+    t2 = now_seconds();
+
+    for (size_t i = 0; i < n; ++i)
+        found += psst_contains(&tree, missing[i]);
+
+    printf("S+ tree (%zu nodes, height %u):\n", tree.offsets[tree.height], tree.height);
+    printf("  Build:   %.3f s\n", t1 - t0);
+    printf("  Lookup:  %.1f ns/op\n", (t2 - t1) * 1e9 / (double)n);
+    printf("  Missing: %.1f ns/op\n\n", (now_seconds() - t2) * 1e9 / (double)n);
+
+    // =========================
+    // BSEARCH
+    // =========================
+
+    t0 = now_seconds();
+    for (size_t i = 0; i < n; ++i) {
+        const ps_t* hit = bsearch(&queries[i], tree.keys, n, sizeof(ps_t), compare_ps);
+        sink += (uint64_t)(hit - tree.keys);
+    }
+    t1 = now_seconds();
+
+    for (size_t i = 0; i < n; ++i)
+        found -= bsearch(&missing[i], tree.keys, n, sizeof(ps_t), compare_ps) != NULL;
+    t2 = now_seconds();
+
+    printf("bsearch:\n");
+    printf("  Lookup:  %.1f ns/op\n", (t1 - t0) * 1e9 / (double)n);
+    printf("  Missing: %.1f ns/op\n\n", (t2 - t1) * 1e9 / (double)n);
+
+    // =========================
+    // PSRH MAP
+    // =========================
+
+    psrh_map map;
+    if (!psrh_init(&map, n * 2)) {
+        fprintf(stderr, "psrh_init failed\n");
+        return 1;
+    }
+
+    t0 = now_seconds();
+    for (size_t i = 0; i < n; ++i)
+        psrh_set(&map, keys[i], i);
+    t1 = now_seconds();
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) {
+        psrh_get(&map, queries[i], &value);
+        sink += value;
+    }
+    t2 = now_seconds();
+
+    for (size_t i = 0; i < n; ++i)
+        psrh_contains(&map, missing[i]);
+
+    printf("psrh_map:\n");
+    printf("  Build:   %.3f s\n", t1 - t0);
+    printf("  Lookup:  %.1f ns/op\n", (t2 - t1) * 1e9 / (double)n);
+    printf("  Missing: %.1f ns/op\n\n", (now_seconds() - t2) * 1e9 / (double)n);
+
+    // =========================
+    // FRONT-CODED DICTIONARY
+    // =========================
+
+    psfc_dict dict;
+
+    t0 = now_seconds();
+    if (!psfc_build(&dict, keys, n, 0)) {
+        fprintf(stderr, "psfc_build failed\n");
+        return 1;
+    }
+    t1 = now_seconds();
+
+#if PSFC_FILE
+    // Queried through a read-only mapping of the saved file
+    char path[] = "/tmp/psfc-XXXXXX";
+    const int fd = mkstemp(path);
+    const bool saved = fd >= 0 && psfc_save(&dict, fd);
+    if (fd >= 0) close(fd);
+
+    psfc_dict built = dict;
+    if (!saved || !psfc_open_mmap(path, &dict)) {
+        fprintf(stderr, "psfc snapshot failed\n");
+        return 1;
+    }
+    unlink(path);
+    psfc_free(&built);
+#endif
+
+    const double t_open = now_seconds();
+    for (size_t i = 0; i < n; ++i)
+        sink += psfc_rank(&dict, queries[i]);
+    t2 = now_seconds();
+
+    size_t fc_missing = 0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t index;
+        fc_missing += psfc_lookup(&dict, missing[i], &index);
+    }
+
+    printf("front-coded (%zu keys, %.2f bytes/key, %.1fx smaller than ps_t[]%s):\n",
+        dict.size, (double)psfc_bytes(&dict) / (double)dict.size,
+        (double)(dict.size * sizeof(ps_t)) / (double)psfc_bytes(&dict), PSFC_FILE ? ", mmap" : "");
+    printf("  Build:   %.3f s\n", t1 - t0);
+    printf("  Lookup:  %.1f ns/op\n", (t2 - t_open) * 1e9 / (double)n);
+    printf("  Missing: %.1f ns/op\n", (now_seconds() - t2) * 1e9 / (double)n);
+
+    // Size on the identifier workload
+    uint64_t ident_rng = 0x9E3779B97F4A7C15ULL;
+    ps_t* idents = malloc(n * sizeof(ps_t));
+    psfc_dict ident_dict;
+    if (!idents) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        char name[STR_MAX + 1];
+        bench_identifier(&ident_rng, name);
+        idents[i] = ps_pack(name);
+    }
+    if (!psfc_build(&ident_dict, idents, n, 0)) {
+        fprintf(stderr, "psfc_build failed\n");
+        return 1;
+    }
+    printf("  Identifiers: %zu keys, %.2f bytes/key, %.1fx smaller than ps_t[]\n\n",
+        ident_dict.size, (double)psfc_bytes(&ident_dict) / (double)ident_dict.size,
+        (double)(ident_dict.size * sizeof(ps_t)) / (double)psfc_bytes(&ident_dict));
+
+    // Every tree answer must agree with a plain sorted-array search
+    size_t mismatches = found;
+    for (size_t i = 0; i < n && i < 100000; ++i) {
+        const size_t r = psst_lower_bound(&tree, queries[i]);
+        if (r == n || ps_compare(tree.keys[r], queries[i]) != 0) mismatches++;
+        if (r > 0 && ps_compare(tree.keys[r - 1], queries[i]) >= 0) mismatches++;
+    }
+
+    // Bounds and ranges against linear counts over the sorted keys. Probes
+    // alternate between present keys and random strings, and one range in
+    // four may keep from > to, which must come back empty.
+    for (size_t p = 0; p < BOUND_PROBES && n > 0; ++p) {
+        const ps_t probe = p % 2 ? random_ps() : queries[rng() % n];
+        ps_t from = p % 2 ? queries[rng() % n] : random_ps(), to = random_ps();
+        if (p % 4 < 3 && ps_compare(from, to) > 0) {
+            const ps_t tmp = from;
+            from = to;
+            to = tmp;
+        }
+
+        size_t below = 0, not_above = 0, from_rank = 0, in_range = 0;
+        for (size_t i = 0; i < n; ++i) {
+            below += ps_compare(tree.keys[i], probe) < 0;
+            not_above += ps_compare(tree.keys[i], probe) <= 0;
+            from_rank += ps_compare(tree.keys[i], from) < 0;
+            in_range += ps_compare(tree.keys[i], from) >= 0 && ps_compare(tree.keys[i], to) <= 0;
+        }
+
+        size_t first;
+        const size_t count = psst_range(&tree, from, to, &first);
+        if (psst_lower_bound(&tree, probe) != below) mismatches++;
+        if (psst_upper_bound(&tree, probe) != not_above) mismatches++;
+        if (count != in_range || (count > 0 && first != from_rank)) mismatches++;
+    }
+
+    // The dictionary holds the distinct keys in order, and agrees with the tree
+    size_t distinct = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0 && ps_compare(tree.keys[i - 1], tree.keys[i]) == 0) continue;
+        if (distinct < 100000 && !ps_equal(psfc_select(&dict, distinct), tree.keys[i])) mismatches++;
+        distinct++;
+    }
+    if (distinct != dict.size || ps_valid(psfc_select(&dict, distinct))) mismatches++;
+
+    for (size_t i = 0; i < n && i < 100000; ++i) {
+        const size_t r = psfc_rank(&dict, queries[i]);
+        if (!ps_equal(psfc_select(&dict, r), queries[i])) mismatches++;
+        if (r > 0 && ps_compare(psfc_select(&dict, r - 1), queries[i]) >= 0) mismatches++;
+
+        size_t index;
+        if (psfc_lookup(&dict, missing[i], &index) != psst_contains(&tree, missing[i])) mismatches++;
+    }
+    printf("Mismatches: %zu\n", mismatches);
+
+    psrh_free(&map);
+    psfc_free(&ident_dict);
+    psfc_free(&dict);
+    psst_free(&tree);
+    free(idents);
+    free(keys);
+    free(queries);
+    free(missing);
+
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,421 @@
+#ifndef PACKED_STRING_PS_FCDICT_H
+#define PACKED_STRING_PS_FCDICT_H
+
+#include "../packed16/packed-string.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PSFC_FILE 1
+#else
+#define PSFC_FILE 0
+#endif
+
+// Front-coded dictionary: a sorted set of packed strings in one flat
+// image that is the same in memory and on disk.
+//
+// Keys are stored in ps_compare order, each one as the number of chars it
+// shares with the key before it plus the remaining chars:
+//
+//   u8  prefix * 21 + suffix length (prefix 0 at every restart)
+//   ceil(suffix * 6 / 8) bytes: the suffix chars, little-endian
+//
+// The shared prefix is found with xor and count-trailing-zeros on the
+// packed words (char 0 is the lowest 6 bits) and capped at
+// PSFC_MAX_PREFIX so both lengths fit one byte. Flags are not stored,
+// psfc_select recomputes them (ps_scan). Every block of `block` keys
+// starts with a restart, whose byte offset is in the restart table; a
+// search binary-searches the restart heads and then decodes at most one
+// block.
+//
+// Image layout, all integers in the byte order of the writer:
+//
+//   0   magic "PSFC"
+//   4   u16 version (1)
+//   6   u16 endian tag 0x0102
+//   8   u32 keys per block
+//   12  u32 header size (64, the restart table starts there)
+//   16  u64 size (keys)
+//   24  u64 blocks
+//   32  u64 data size (bytes of records)
+//   40  24 bytes reserved, zero
+//   64  blocks u64 restart offsets, relative to the records
+//   ..  records, then PSFC_PAD zero bytes so a record is read with two
+//       unaligned 8-byte loads
+//
+// psfc_open_mmap checks the header only, records are trusted like the
+// slots of a psrh_file.
+
+#define PSFC_MAGIC       "PSFC"
+#define PSFC_VERSION     1
+#define PSFC_ENDIAN      0x0102
+#define PSFC_HEADER_SIZE 64
+#define PSFC_BLOCK       16
+#define PSFC_PAD         16
+#define PSFC_MAX_PREFIX  11    // 12 * 21 codes fit a byte
+
+#define PSFC_CHARS  0x00FFFFFFFFFFFFFFULL   // hi without metadata
+
+typedef struct {
+  char     magic[4];
+  uint16_t version;
+  uint16_t endian;
+  uint32_t block;
+  uint32_t header_size;
+  uint64_t size;
+  uint64_t blocks;
+  uint64_t data_size;
+  uint8_t  reserved[24];
+} psfc_header;
+
+typedef struct {
+  const uint8_t*  base;       // whole image
+  size_t          length;
+  const uint64_t* restarts;   // block -> record offset
+  const uint8_t*  data;       // records
+  size_t          size;
+  size_t          blocks;
+  uint32_t        block;
+  bool            mapped;     // munmap instead of free
+} psfc_dict;
+
+// =========================
+// RECORDS
+// =========================
+
+// Chars a and b have in common from the start
+static inline uint8_t psfc_shared(const ps_t a, const ps_t b) {
+  const uint64_t x_lo = a.lo ^ b.lo;
+  const uint64_t x_hi = (a.hi ^ b.hi) & PSFC_CHARS;
+  const unsigned bit = x_lo ? ps_ctz64(x_lo) : x_hi ? 64u + ps_ctz64(x_hi) : 120u;
+
+  // '0' packs to zero bits, so chars past the shorter length can match
+  uint8_t n = (uint8_t)(bit / 6);
+  if (n > ps_length(a)) n = ps_length(a);
+  if (n > ps_length(b)) n = ps_length(b);
+  return n < PSFC_MAX_PREFIX ? n : PSFC_MAX_PREFIX;
+}
+
+static inline size_t psfc_record_size(const uint8_t prefix, const uint8_t length) {
+  return 1 + ((length - prefix) * 6u + 7) / 8;
+}
+
+// (lo, hi) << bits for bits in [0, 120]
+static inline void psfc_shl(uint64_t* lo, uint64_t* hi, const unsigned bits) {
+  if (bits == 0) return;
+  if (bits < 64) {
+    *hi = *hi << bits | *lo >> (64 - bits);
+    *lo <<= bits;
+  } else {
+    *hi = *lo << (bits - 64);
+    *lo = 0;
+  }
+}
+
+// Keeps the low bits of (lo, hi), bits a multiple of 6 in [0, 120] (never 64)
+static inline void psfc_keep(uint64_t* lo, uint64_t* hi, const unsigned bits) {
+  if (bits < 64) {
+    *lo &= bits ? ~0ULL >> (64 - bits) : 0;
+    *hi = 0;
+  } else {
+    *hi &= ~0ULL >> (128 - bits);
+  }
+}
+
+static inline uint64_t psfc_load_le(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline void psfc_store_le(uint8_t* p, uint64_t v, const size_t n) {
+  for (size_t i = 0; i < n; i++, v >>= 8) p[i] = (uint8_t)v;
+}
+
+// Writes key after prev (prefix shared chars), returns the record size
+static inline size_t psfc_write(uint8_t* p, const ps_t key, const uint8_t prefix) {
+  const uint8_t length = ps_length(key);
+  const size_t suffix = ((length - prefix) * 6u + 7) / 8;
+
+  uint64_t lo = key.lo, hi = key.hi & PSFC_CHARS;
+  psfc_keep(&lo, &hi, length * 6u);
+  const unsigned shift = prefix * 6u;
+  if (shift >= 64) {
+    lo = hi >> (shift - 64);
+    hi = 0;
+  } else if (shift > 0) {
+    lo = lo >> shift | hi << (64 - shift);
+    hi >>= shift;
+  }
+
+  p[0] = (uint8_t)(prefix * 21 + (length - prefix));
+  psfc_store_le(p + 1, lo, suffix < 8 ? suffix : 8);
+  if (suffix > 8) psfc_store_le(p + 9, hi, suffix - 8);
+  return 1 + suffix;
+}
+
+// Decodes the record at p into *cur (the key before it, flags clear),
+// returns the next one
+static inline const uint8_t* psfc_next(const uint8_t* p, ps_t* cur) {
+  const unsigned prefix = p[0] / 21u;
+  const unsigned suffix = p[0] - prefix * 21u;
+  const unsigned bits = suffix * 6u;
+
+  // Suffix chars, the bytes after them belong to the next record
+  uint64_t lo = psfc_load_le(p + 1), hi = psfc_load_le(p + 9);
+  psfc_keep(&lo, &hi, bits);
+  psfc_shl(&lo, &hi, prefix * 6u);
+
+  uint64_t plo = cur->lo, phi = cur->hi & PSFC_CHARS;
+  psfc_keep(&plo, &phi, prefix * 6u);
+
+  cur->lo = plo | lo;
+  cur->hi = (phi | hi) | (uint64_t)(prefix + suffix) << 59;
+  return p + 1 + (bits + 7) / 8;
+}
+
+// =========================
+// BUILD / ATTACH
+// =========================
+
+static inline bool psfc_header_valid(const psfc_header* h, const size_t length) {
+  if (memcmp(h->magic, PSFC_MAGIC, 4) != 0) return false;
+  if (h->version != PSFC_VERSION || h->endian != PSFC_ENDIAN) return false;
+  if (h->header_size != PSFC_HEADER_SIZE || h->block == 0) return false;
+  if (h->blocks != (h->size + h->block - 1) / h->block) return false;
+
+  // Every record is 1 to 16 bytes
+  if (h->size > SIZE_MAX / 16) return false;
+  if (h->data_size < h->size || h->data_size > h->size * 16) return false;
+  if (h->blocks > (SIZE_MAX - PSFC_HEADER_SIZE - PSFC_PAD - h->data_size) / 8) return false;
+
+  return length == PSFC_HEADER_SIZE + h->blocks * 8 + h->data_size + PSFC_PAD;
+}
+
+// Points d at an image (built or mapped), false if it is not one
+static inline bool psfc_attach(psfc_dict* d, const void* base, const size_t length) {
+  memset(d, 0, sizeof(*d));
+  if (length < PSFC_HEADER_SIZE) return false;
+
+  psfc_header h;
+  memcpy(&h, base, sizeof(h));
+  if (!psfc_header_valid(&h, length)) return false;
+
+  d->base = base;
+  d->length = length;
+  d->restarts = (const uint64_t*)((const uint8_t*)base + PSFC_HEADER_SIZE);
+  d->data = (const uint8_t*)(d->restarts + h.blocks);
+  d->size = (size_t)h.size;
+  d->blocks = (size_t)h.blocks;
+  d->block = h.block;
+  return true;
+}
+
+static inline int psfc_sort_compare(const void* a, const void* b) {
+  return ps_compare(*(const ps_t*)a, *(const ps_t*)b);
+}
+
+// Build from n keys (any order, copied, sorted with ps_compare and
+// deduplicated), restarts every block keys (0 = PSFC_BLOCK). Keys that
+// are not valid strings are left out.
+static inline bool psfc_build(psfc_dict* d, const ps_t* keys, const size_t n, uint32_t block) {
+  memset(d, 0, sizeof(*d));
+  if (block == 0) block = PSFC_BLOCK;
+
+  ps_t* sorted = malloc((n ? n : 1) * sizeof(ps_t));
+  if (!sorted) return false;
+
+  size_t m = 0;
+  for (size_t i = 0; i < n; i++)
+    if (ps_valid(keys[i])) sorted[m++] = keys[i];
+  qsort(sorted, m, sizeof(ps_t), psfc_sort_compare);
+
+  size_t size = 0;
+  for (size_t i = 0; i < m; i++)
+    if (size == 0 || ps_compare(sorted[size - 1], sorted[i]) != 0) sorted[size++] = sorted[i];
+
+  // Sizes first, so the image is one allocation
+  size_t data_size = 0;
+  for (size_t i = 0; i < size; i++) {
+    const uint8_t prefix = i % block ? psfc_shared(sorted[i - 1], sorted[i]) : 0;
+    data_size += psfc_record_size(prefix, ps_length(sorted[i]));
+  }
+
+  const size_t blocks = (size + block - 1) / block;
+  const size_t length = PSFC_HEADER_SIZE + blocks * 8 + data_size + PSFC_PAD;
+  uint8_t* image = calloc(1, length);
+  if (!image) {
+    free(sorted);
+    return false;
+  }
+
+  psfc_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, PSFC_MAGIC, 4);
+  h.version = PSFC_VERSION;
+  h.endian = PSFC_ENDIAN;
+  h.block = block;
+  h.header_size = PSFC_HEADER_SIZE;
+  h.size = size;
+  h.blocks = blocks;
+  h.data_size = data_size;
+  memcpy(image, &h, sizeof(h));
+
+  uint64_t* restarts = (uint64_t*)(image + PSFC_HEADER_SIZE);
+  uint8_t* data = (uint8_t*)(restarts + blocks);
+  size_t pos = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    if (i % block == 0) restarts[i / block] = pos;
+    const uint8_t prefix = i % block ? psfc_shared(sorted[i - 1], sorted[i]) : 0;
+    pos += psfc_write(data + pos, sorted[i], prefix);
+  }
+
+  free(sorted);
+  if (psfc_attach(d, image, length)) return true;
+
+  free(image);
+  return false;
+}
+
+static inline void psfc_free(psfc_dict* d) {
+#if PSFC_FILE
+  if (d->mapped) munmap((void*)d->base, d->length);
+  else
+#endif
+  free((void*)d->base);
+  memset(d, 0, sizeof(*d));
+}
+
+// Bytes of the whole image, header and restart table included
+static inline size_t psfc_bytes(const psfc_dict* d) {
+  return d->length;
+}
+
+// =========================
+// QUERIES
+// =========================
+
+// Restart key of block b
+static inline ps_t psfc_head(const psfc_dict* d, const size_t b) {
+  ps_t key = ps_empty();
+  psfc_next(d->data + d->restarts[b], &key);
+  return key;
+}
+
+// Keys less than key; *found tells if the key at that rank equals it
+static inline size_t psfc_search(const psfc_dict* d, const ps_t key, bool* found) {
+  *found = false;
+  if (d->size == 0) return 0;
+
+  // Last block whose head is <= key
+  size_t lo = 0, hi = d->blocks;
+  while (hi - lo > 1) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (ps_compare_inline(psfc_head(d, mid), key) <= 0) lo = mid;
+    else hi = mid;
+  }
+
+  const size_t first = lo * d->block;
+  const size_t end = first + d->block < d->size ? first + d->block : d->size;
+  const uint8_t* p = d->data + d->restarts[lo];
+  ps_t cur = ps_empty();
+
+  for (size_t i = first; i < end; i++) {
+    p = psfc_next(p, &cur);
+    const int c = ps_compare_inline(cur, key);
+    if (c >= 0) {
+      *found = c == 0;
+      return i;
+    }
+  }
+  return end;
+}
+
+// Number of keys less than key (ps_compare order)
+static inline size_t psfc_rank(const psfc_dict* d, const ps_t key) {
+  bool found;
+  return psfc_search(d, key, &found);
+}
+
+// True if key is in d, with its rank in *index
+static inline bool psfc_lookup(const psfc_dict* d, const ps_t key, size_t* index) {
+  bool found;
+  const size_t r = psfc_search(d, key, &found);
+  if (found) *index = r;
+  return found;
+}
+
+// Key of rank i (exact flags), PACKED_STRING_INVALID past the end
+static inline ps_t psfc_select(const psfc_dict* d, const size_t i) {
+  if (i >= d->size) return PACKED_STRING_INVALID;
+
+  const uint8_t* p = d->data + d->restarts[i / d->block];
+  ps_t cur = ps_empty();
+  for (size_t k = i % d->block; ; k--) {
+    p = psfc_next(p, &cur);
+    if (k == 0) return ps_scan(cur);
+  }
+}
+
+// =========================
+// FILES (POSIX)
+// =========================
+
+#if PSFC_FILE
+
+// Writes the image at the current offset of fd, false on a write error
+static inline bool psfc_save(const psfc_dict* d, const int fd) {
+  const uint8_t* p = d->base;
+  size_t len = d->length;
+
+  while (len > 0) {
+    const ssize_t w = write(fd, p, len);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    len -= (size_t)w;
+  }
+  return true;
+}
+
+// Maps a saved dictionary read-only, false if it cannot be opened or is not one
+static inline bool psfc_open_mmap(const char* path, psfc_dict* d) {
+  memset(d, 0, sizeof(*d));
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < PSFC_HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+
+  const size_t length = (size_t)st.st_size;
+  void* base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);   // the mapping keeps the file
+  if (base == MAP_FAILED) return false;
+
+  if (!psfc_attach(d, base, length)) {
+    munmap(base, length);
+    return false;
+  }
+  d->mapped = true;
+  return true;
+}
+
+#endif
+
+#endif // PACKED_STRING_PS_FCDICT_H
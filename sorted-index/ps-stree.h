@@ -0,0 +1,230 @@
+#ifndef PACKED_STRING_PS_STREE_H
+#define PACKED_STRING_PS_STREE_H
+
+#include "../packed16/packed-string.h"
+#include "../packed16/aligned.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Static B+ tree (S+ tree) over sorted packed strings.
+//
+// Every node is one cache line holding 4 keys. Keys are stored as
+// order keys: the 20 characters big-endian (char 0 most significant)
+// followed by the length, so plain 128-bit integer order is ps_compare
+// order. The sign bit of each half is flipped so signed 64-bit SIMD
+// compares give unsigned order.
+//
+// Layer 0 holds the sorted keys in blocks of 4, so the leaf reached by a
+// search directly gives the rank. Each upper node has 5 children, its key
+// i is the smallest key below child i + 1.
+
+#define PSST_B          4
+#define PSST_MAX_HEIGHT 32
+
+typedef struct {
+  int64_t hi[PSST_B];
+  int64_t lo[PSST_B];
+} psst_node;   // 64 bytes, one cache line
+
+typedef struct {
+  psst_node* nodes;                        // all layers, leaves first
+  ps_t*      keys;                         // rank -> key
+  size_t     size;
+  uint32_t   height;
+  size_t     offsets[PSST_MAX_HEIGHT + 1]; // layer -> first node
+} psst_index;
+
+#define PSST_BIAS  ((uint64_t)1 << 63)
+#define PSST_INF   INT64_MAX               // biased all-ones
+
+// Biased 128-bit order key of ps
+static inline void psst_key(const ps_t ps, int64_t* kh, int64_t* kl) {
+  const uint8_t len = ps_length(ps);
+  uint64_t a = 0, b = 0;   // chars 0-9 and 10-19, 60 bits each
+
+  for (uint8_t i = 0; i < 10; i++)
+    a = a << 6 | (i < len ? (uint64_t)ps_sixbit_at(ps, i) : 0);
+
+  for (uint8_t i = 10; i < 20; i++)
+    b = b << 6 | (i < len ? (uint64_t)ps_sixbit_at(ps, i) : 0);
+
+  *kh = (int64_t)((a << 4 | b >> 56) ^ PSST_BIAS);
+  *kl = (int64_t)((b << 8 | len) ^ PSST_BIAS);
+}
+
+// Number of node keys less than (kh, kl)
+static inline uint32_t psst_rank_node(const psst_node* node, const int64_t kh, const int64_t kl) {
+#if defined(__AVX2__)
+  const __m256i h = _mm256_load_si256((const __m256i*)node->hi);
+  const __m256i l = _mm256_load_si256((const __m256i*)node->lo);
+  const __m256i qh = _mm256_set1_epi64x(kh);
+  const __m256i ql = _mm256_set1_epi64x(kl);
+
+  // node < q  <=>  q.hi > hi || (q.hi == hi && q.lo > lo)
+  const __m256i lt = _mm256_or_si256(
+    _mm256_cmpgt_epi64(qh, h),
+    _mm256_and_si256(_mm256_cmpeq_epi64(qh, h), _mm256_cmpgt_epi64(ql, l)));
+
+  // Node keys are sorted, so the mask is 0b0000, 0b0001, 0b0011, ...
+  static const uint8_t count[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+  return count[_mm256_movemask_pd(_mm256_castsi256_pd(lt))];
+#else
+  uint32_t r = 0;
+  for (int i = 0; i < PSST_B; i++)
+    r += (node->hi[i] < kh) | ((node->hi[i] == kh) & (node->lo[i] < kl));
+  return r;
+#endif
+}
+
+static inline int psst_sort_compare(const void* a, const void* b) {
+  return ps_compare(*(const ps_t*)a, *(const ps_t*)b);
+}
+
+static inline void psst_free(psst_index* t) {
+  ps_aligned_free(t->nodes);
+  free(t->keys);
+  memset(t, 0, sizeof(*t));
+}
+
+// Build from n keys (any order, copied and sorted with ps_compare).
+static inline bool psst_build(psst_index* t, const ps_t* keys, const size_t n) {
+  memset(t, 0, sizeof(*t));
+  if (n == 0) return true;
+
+  // Layer sizes in nodes
+  size_t layer[PSST_MAX_HEIGHT];
+  size_t total = 0;
+
+  layer[0] = (n + PSST_B - 1) / PSST_B;
+  t->height = 1;
+  while (layer[t->height - 1] > 1) {
+    layer[t->height] = (layer[t->height - 1] + PSST_B) / (PSST_B + 1);
+    t->height++;
+  }
+
+  for (uint32_t h = 0; h < t->height; h++) {
+    t->offsets[h] = total;
+    total += layer[h];
+  }
+  t->offsets[t->height] = total;
+
+  t->keys = malloc(n * sizeof(ps_t));
+  t->nodes = ps_aligned_alloc(total * sizeof(psst_node), 64);
+  if (!t->keys || !t->nodes) {
+    psst_free(t);
+    return false;
+  }
+
+  memcpy(t->keys, keys, n * sizeof(ps_t));
+  qsort(t->keys, n, sizeof(ps_t), psst_sort_compare);
+  t->size = n;
+
+  // Leaves: sorted keys padded with +inf
+  for (size_t i = 0; i < layer[0] * PSST_B; i++) {
+    psst_node* node = &t->nodes[i / PSST_B];
+    if (i < n) {
+      psst_key(t->keys[i], &node->hi[i % PSST_B], &node->lo[i % PSST_B]);
+    } else {
+      node->hi[i % PSST_B] = PSST_INF;
+      node->lo[i % PSST_B] = PSST_INF;
+    }
+  }
+
+  // Upper layers: smallest key of child i + 1, found by always going left
+  for (uint32_t h = 1; h < t->height; h++) {
+    for (size_t k = 0; k < layer[h]; k++) {
+      psst_node* node = &t->nodes[t->offsets[h] + k];
+
+      for (size_t i = 0; i < PSST_B; i++) {
+        size_t child = k * (PSST_B + 1) + i + 1;
+        bool exists = child < layer[h - 1];
+
+        for (uint32_t l = h - 1; exists && l > 0; l--)
+          child *= PSST_B + 1;
+
+        if (exists) {
+          const psst_node* leaf = &t->nodes[child];
+          node->hi[i] = leaf->hi[0];
+          node->lo[i] = leaf->lo[0];
+        } else {
+          node->hi[i] = PSST_INF;
+          node->lo[i] = PSST_INF;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+// Rank of the first key not less than the order key (kh, kl)
+static inline size_t psst_lower_bound_key(const psst_index* t, const int64_t kh, const int64_t kl) {
+  if (t->size == 0) return 0;
+
+  size_t k = 0;
+  for (uint32_t h = t->height - 1; h > 0; h--) {
+    const uint32_t i = psst_rank_node(&t->nodes[t->offsets[h] + k], kh, kl);
+    k = k * (PSST_B + 1) + i;
+  }
+
+  const size_t rank = k * PSST_B + psst_rank_node(&t->nodes[k], kh, kl);
+  return rank < t->size ? rank : t->size;
+}
+
+// Rank of the first key >= key (ps_compare order), size if none
+static inline size_t psst_lower_bound(const psst_index* t, const ps_t key) {
+  int64_t kh, kl;
+  psst_key(key, &kh, &kl);
+  return psst_lower_bound_key(t, kh, kl);
+}
+
+// Rank of the first key > key (ps_compare order), size if none
+static inline size_t psst_upper_bound(const psst_index* t, const ps_t key) {
+  int64_t kh, kl;
+  psst_key(key, &kh, &kl);
+
+  // Next order key; the low byte holds the length so this never carries
+  return psst_lower_bound_key(t, kh, kl + 1);
+}
+
+static inline bool psst_find(const psst_index* t, const ps_t key, size_t* rank) {
+  int64_t kh, kl;
+  psst_key(key, &kh, &kl);
+
+  // Compare against the leaf just searched instead of touching t->keys
+  const size_t r = psst_lower_bound_key(t, kh, kl);
+  if (r == t->size) return false;
+
+  const psst_node* leaf = &t->nodes[r / PSST_B];
+  if (leaf->hi[r % PSST_B] != kh || leaf->lo[r % PSST_B] != kl) return false;
+
+  *rank = r;
+  return true;
+}
+
+static inline bool psst_contains(const psst_index* t, const ps_t key) {
+  size_t rank;
+  return psst_find(t, key, &rank);
+}
+
+// Keys in [from, to] are t->keys[*first .. *first + count)
+static inline size_t psst_range(const psst_index* t, const ps_t from, const ps_t to, size_t* first) {
+  const size_t a = psst_lower_bound(t, from);
+  const size_t b = psst_upper_bound(t, to);
+
+  *first = a;
+  return b > a ? b - a : 0;
+}
+
+static inline ps_t psst_at(const psst_index* t, const size_t rank) {
+  return rank < t->size ? t->keys[rank] : PACKED_STRING_INVALID;
+}
+
+#endif // PACKED_STRING_PS_STREE_H
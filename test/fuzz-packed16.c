@@ -0,0 +1,741 @@
+/**
+ * @file fuzz-packed16.c
+ * Differential fuzzer: every ps_* operation against a plain C-string model.
+ *
+ * Usage:
+ *   fuzz-packed16 [-n iterations] [-s seed]   random inputs
+ *   fuzz-packed16 file...                     replay inputs (AFL: @@)
+ *
+ * libFuzzer: compile with -DPS_FUZZ_LIBFUZZER -fsanitize=fuzzer
+ * (CMake: -DPS_FUZZ=ON with clang).
+ *
+ * Every implementation in FUZZ_IMPLS runs on the same input and must
+ * match the model; hashes must also match across implementations. An
+ * implementation is a table of function pointers where NULL means the
+ * library function, plus an enter() hook run before it is used. The
+ * default list has one entry per dispatch tier. To test your own
+ * functions side by side, build with -DPS_FUZZ_EXTRA='"my-impls.h"',
+ * a header that defines them and PS_FUZZ_EXTRA_IMPLS, e.g.
+ *
+ *   #define PS_FUZZ_EXTRA_IMPLS { .name = "my_pack", .pack = my_pack },
+ */
+#include "../packed16/packed-string.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// IMPLEMENTATIONS
+// ============================================================================
+
+typedef struct {
+    const char* name;
+    bool (*enter)(void);    // false skips the implementation
+
+    PackedString (*pack)(const char* str);
+    PackedString (*pack_ex)(const char* str, u8 length, u8 flags);
+    PackedString (*pack_n)(const char* str, size_t length);
+    i32 (*unpack)(PackedString ps, char* buffer);
+    size_t (*unpack_many)(const PackedString* ps, size_t n, char* arena, size_t* offsets);
+    i32 (*unpack_ex)(PackedString ps, char* buffer, u8 length, u8 flags);
+    PackedString (*scan)(PackedString ps);
+    u8 (*set)(PackedString* ps, u8 index, u8 sixbit);
+    u8 (*at)(PackedString ps, u8 index);
+    u8 (*first)(PackedString ps);
+    u8 (*last)(PackedString ps);
+    bool (*equal_nocase)(PackedString a, PackedString b);
+    i32 (*compare)(PackedString a, PackedString b);
+    bool (*starts_with)(PackedString ps, PackedString prefix);
+    bool (*ends_with)(PackedString ps, PackedString suffix);
+    bool (*starts_with_at)(PackedString ps, PackedString prefix, u8 start);
+    bool (*ends_with_at)(PackedString ps, PackedString suffix, u8 end);
+    PackedString (*skip)(PackedString ps, u8 start);
+    PackedString (*trunc)(PackedString ps, u8 length);
+    PackedString (*substring)(PackedString ps, u8 start, u8 length);
+    PackedString (*concat)(PackedString a, PackedString b);
+    PackedString (*to_lower)(PackedString ps);
+    PackedString (*to_upper)(PackedString ps);
+    PackedString (*pad_left)(PackedString ps, u8 sixbit, u8 length);
+    PackedString (*pad_right)(PackedString ps, u8 sixbit, u8 length);
+    PackedString (*pad_center)(PackedString ps, u8 sixbit, u8 length);
+    i8 (*find_six)(PackedString ps, u8 sixbit);
+    i8 (*find_from_six)(PackedString ps, u8 sixbit, u8 start);
+    i8 (*find_last_six)(PackedString ps, u8 sixbit);
+    bool (*contains_six)(PackedString ps, u8 sixbit);
+    bool (*contains)(PackedString ps, PackedString pat);
+    u32 (*hash32)(PackedString ps);
+    u64 (*hash64)(PackedString ps);
+    void (*hash64_many)(const PackedString* ps, u64* out, size_t n);
+    PackedString (*lock)(PackedString ps, PackedString key);
+    PackedString (*unlock)(PackedString ps, PackedString key);
+    bool (*is_valid_identifier)(PackedString ps);
+    size_t (*tokenize)(PsTokenizer* tk, PsToken* out, size_t cap);
+    size_t (*encode_many)(const PackedString* ps, size_t n, u8* out);
+    size_t (*decode_many)(const u8* in, size_t len, PackedString* out, size_t n, size_t* consumed);
+} fuzz_impl;
+
+#define FUZZ_TIER(tier, id) \
+    static bool fuzz_enter_##id(void) { return ps_set_tier(tier); }
+
+FUZZ_TIER(PS_TIER_SCALAR, scalar)
+FUZZ_TIER(PS_TIER_BMI2, bmi2)
+FUZZ_TIER(PS_TIER_AVX2, avx2)
+FUZZ_TIER(PS_TIER_AVX512, avx512)
+
+#ifdef PS_FUZZ_EXTRA
+#include PS_FUZZ_EXTRA
+#endif
+
+#ifndef PS_FUZZ_EXTRA_IMPLS
+#define PS_FUZZ_EXTRA_IMPLS
+#endif
+
+static fuzz_impl FUZZ_IMPLS[] = {
+    { .name = "scalar", .enter = fuzz_enter_scalar },
+    { .name = "bmi2",   .enter = fuzz_enter_bmi2 },
+    { .name = "avx2",   .enter = fuzz_enter_avx2 },
+    { .name = "avx512", .enter = fuzz_enter_avx512 },
+    PS_FUZZ_EXTRA_IMPLS
+};
+
+#define FUZZ_IMPL_COUNT (sizeof(FUZZ_IMPLS) / sizeof(*FUZZ_IMPLS))
+
+#define FUZZ_DEFAULT(field, fn) if (!impl->field) impl->field = fn
+
+// Fills NULL entries with the library functions
+static void fuzz_resolve(fuzz_impl* impl) {
+    FUZZ_DEFAULT(pack, ps_pack);
+    FUZZ_DEFAULT(pack_ex, ps_pack_ex);
+    FUZZ_DEFAULT(pack_n, ps_pack_n);
+    FUZZ_DEFAULT(unpack, ps_unpack);
+    FUZZ_DEFAULT(unpack_many, ps_unpack_many);
+    FUZZ_DEFAULT(unpack_ex, ps_unpack_ex);
+    FUZZ_DEFAULT(scan, ps_scan);
+    FUZZ_DEFAULT(set, ps_set);
+    FUZZ_DEFAULT(at, ps_at);
+    FUZZ_DEFAULT(first, ps_first);
+    FUZZ_DEFAULT(last, ps_last);
+    FUZZ_DEFAULT(equal_nocase, ps_equal_nocase);
+    FUZZ_DEFAULT(compare, ps_compare);
+    FUZZ_DEFAULT(starts_with, ps_starts_with);
+    FUZZ_DEFAULT(ends_with, ps_ends_with);
+    FUZZ_DEFAULT(starts_with_at, ps_starts_with_at);
+    FUZZ_DEFAULT(ends_with_at, ps_ends_with_at);
+    FUZZ_DEFAULT(skip, ps_skip);
+    FUZZ_DEFAULT(trunc, ps_trunc);
+    FUZZ_DEFAULT(substring, ps_substring);
+    FUZZ_DEFAULT(concat, ps_concat);
+    FUZZ_DEFAULT(to_lower, ps_to_lower);
+    FUZZ_DEFAULT(to_upper, ps_to_upper);
+    FUZZ_DEFAULT(pad_left, ps_pad_left);
+    FUZZ_DEFAULT(pad_right, ps_pad_right);
+    FUZZ_DEFAULT(pad_center, ps_pad_center);
+    FUZZ_DEFAULT(find_six, ps_find_six);
+    FUZZ_DEFAULT(find_from_six, ps_find_from_six);
+    FUZZ_DEFAULT(find_last_six, ps_find_last_six);
+    FUZZ_DEFAULT(contains_six, ps_contains_six);
+    FUZZ_DEFAULT(contains, ps_contains);
+    FUZZ_DEFAULT(hash32, ps_hash32);
+    FUZZ_DEFAULT(hash64, ps_hash64);
+    FUZZ_DEFAULT(hash64_many, ps_hash64_many);
+    FUZZ_DEFAULT(lock, ps_lock);
+    FUZZ_DEFAULT(unlock, ps_unlock);
+    FUZZ_DEFAULT(is_valid_identifier, ps_is_valid_identifier);
+    FUZZ_DEFAULT(tokenize, ps_tokenize);
+    FUZZ_DEFAULT(encode_many, ps_encode_many);
+    FUZZ_DEFAULT(decode_many, ps_decode_many);
+}
+
+// ============================================================================
+// REFERENCE MODEL
+// ============================================================================
+
+#define REF_MAX 32
+
+static const char ALPHABET[] = PACKED_STRING_ALPHABET;
+
+static int ref_six(const char c) {
+    const char* p = c ? strchr(ALPHABET, c) : NULL;
+    return p ? (int)(p - ALPHABET) : -1;
+}
+
+static bool ref_is_upper(const char c) { return c >= 'A' && c <= 'Z'; }
+static bool ref_is_digit(const char c) { return c >= '0' && c <= '9'; }
+static bool ref_is_special(const char c) { return c == '_' || c == '$'; }
+
+static char ref_lower(const char c) { return ref_is_upper(c) ? (char)(c - 'A' + 'a') : c; }
+static char ref_upper(const char c) { return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c; }
+
+static bool ref_packable(const char* s) {
+    const size_t n = strlen(s);
+    if (n > PACKED_STRING_MAX_LEN) return false;
+    for (size_t i = 0; i < n; i++) {
+        if (ref_six(s[i]) < 0) return false;
+    }
+    return true;
+}
+
+static u8 ref_flags(const char* s) {
+    u8 flags = 0;
+    for (; *s; s++) {
+        if (ref_is_upper(*s)) flags |= PACKED_FLAG_CASE_SENSITIVE;
+        if (ref_is_digit(*s)) flags |= PACKED_FLAG_CONTAINS_DIGIT;
+        if (ref_is_special(*s)) flags |= PACKED_FLAG_CONTAINS_SPECIAL;
+    }
+    return flags;
+}
+
+// Bit layout written out independently of the library: char i at bits 6i..6i+5
+static PackedString ref_encode(const char* s, const u8 flags) {
+    u64 w[2] = {0, 0};
+    const size_t n = strlen(s);
+
+    for (size_t i = 0; i < n; i++) {
+        const u64 six = (u64)ref_six(s[i]);
+        for (unsigned b = 0; b < 6; b++) {
+            const size_t bit = i * 6 + b;
+            w[bit / 64] |= (six >> b & 1) << (bit % 64);
+        }
+    }
+
+    w[1] |= (u64)((n << 3 | flags) & 0xFF) << 56;
+    return (PackedString){ .lo = w[0], .hi = w[1] };
+}
+
+static void ref_decode(const PackedString ps, char* out) {
+    const u64 w[2] = { ps.lo, ps.hi };
+    const unsigned n = (unsigned)(ps.hi >> 59);
+
+    for (unsigned i = 0; i < n && i < PACKED_STRING_MAX_LEN; i++) {
+        unsigned six = 0;
+        for (unsigned b = 0; b < 6; b++) {
+            const unsigned bit = i * 6 + b;
+            six |= (unsigned)(w[bit / 64] >> (bit % 64) & 1) << b;
+        }
+        out[i] = ALPHABET[six];
+    }
+    out[n < PACKED_STRING_MAX_LEN ? n : PACKED_STRING_MAX_LEN] = '\0';
+}
+
+// Sixbit order: 0-9 < a-z < A-Z < _ < $, then shorter first
+static int ref_compare(const char* a, const char* b) {
+    for (; *a && *b; a++, b++) {
+        if (*a != *b) return ref_six(*a) < ref_six(*b) ? -1 : 1;
+    }
+    return *a ? 1 : *b ? -1 : 0;
+}
+
+static int ref_sign(const i32 x) { return (x > 0) - (x < 0); }
+
+static void ref_slice(const char* s, const size_t start, const size_t length, char* out) {
+    memcpy(out, s + start, length);
+    out[length] = '\0';
+}
+
+static int ref_find(const char* s, const char c, const size_t from) {
+    for (size_t i = from; s[i]; i++) {
+        if (s[i] == c) return (int)i;
+    }
+    return -1;
+}
+
+static int ref_find_last(const char* s, const char c) {
+    for (size_t i = strlen(s); i-- > 0;) {
+        if (s[i] == c) return (int)i;
+    }
+    return -1;
+}
+
+// ============================================================================
+// INPUT
+// ============================================================================
+
+typedef struct {
+    const u8* data;
+    size_t    size;
+    size_t    pos;
+} fuzz_reader;
+
+static u8 fuzz_byte(fuzz_reader* r) {
+    return r->pos < r->size ? r->data[r->pos++] : 0;
+}
+
+// 0-22 chars, mostly from the alphabet; returns false when not packable
+static bool fuzz_string(fuzz_reader* r, char out[REF_MAX]) {
+    static const char INVALID[] = "?@ -.\x7f\x80\xff";
+    const u8 n = fuzz_byte(r) % 23;
+
+    for (u8 i = 0; i < n; i++) {
+        const u8 b = fuzz_byte(r);
+        out[i] = b < 0xF0 ? ALPHABET[b & 63] : INVALID[b & 7];
+    }
+    memset(out + n, 0, REF_MAX - n);
+    return ref_packable(out);
+}
+
+typedef struct {
+    char a[REF_MAX], b[REF_MAX], k[REF_MAX];
+    bool a_ok, b_ok, k_ok;
+    u8 idx, len, six, flags, pad;
+} fuzz_input;
+
+static fuzz_input fuzz_current;
+static const char* fuzz_impl_name = "";
+
+static void fuzz_decode(const u8* data, const size_t size, fuzz_input* in) {
+    fuzz_reader r = { data, size, 0 };
+    in->a_ok = fuzz_string(&r, in->a);
+    in->b_ok = fuzz_string(&r, in->b);
+    in->k_ok = fuzz_string(&r, in->k);
+    in->idx = fuzz_byte(&r) % 22;
+    in->len = fuzz_byte(&r) % 22;
+    in->six = fuzz_byte(&r) & 63;
+    in->flags = fuzz_byte(&r) & 7;
+    in->pad = fuzz_byte(&r) % (PACKED_STRING_MAX_LEN + 1);
+}
+
+// ============================================================================
+// CHECKS
+// ============================================================================
+
+static void fuzz_fail(const char* op, const char* what) {
+    const fuzz_input* in = &fuzz_current;
+    fprintf(stderr,
+        "MISMATCH impl=%s op=%s: %s\n"
+        "  a=\"%s\" b=\"%s\" key=\"%s\" idx=%u len=%u six=%u flags=%u pad=%u\n",
+        fuzz_impl_name, op, what, in->a, in->b, in->k,
+        in->idx, in->len, in->six, in->flags, in->pad);
+    abort();
+}
+
+#define CHECK(cond, op) do { if (!(cond)) fuzz_fail(op, #cond); } while (0)
+
+enum { FLAGS_EXACT, FLAGS_SOUND, FLAGS_ANY };
+
+// Content, unused bits and flags of got against the model string want.
+// FLAGS_SOUND: flags may claim more than the content has, never less.
+static void fuzz_expect(const char* op, const PackedString got, const char* want, const int mode) {
+    const PackedString ref = ref_encode(want, 0);
+    char decoded[REF_MAX];
+
+    CHECK(ps_valid(got), op);
+    CHECK(ps_length(got) == strlen(want), op);
+    ref_decode(got, decoded);
+    CHECK(strcmp(decoded, want) == 0, op);
+
+    // Bits past the length must be zero, or equal strings hash differently
+    CHECK(got.lo == ref.lo && (got.hi & 0x00FFFFFFFFFFFFFFULL) == (ref.hi & 0x00FFFFFFFFFFFFFFULL), op);
+
+    const u8 flags = ps_flags(got), exact = ref_flags(want);
+    if (mode == FLAGS_EXACT) CHECK(flags == exact, op);
+    if (mode == FLAGS_SOUND) CHECK((flags & exact) == exact, op);
+}
+
+static void fuzz_core(const fuzz_impl* f, const fuzz_input* in, const PackedString A) {
+    const char* a = in->a;
+    const size_t la = strlen(a);
+    char buf[REF_MAX], want[REF_MAX];
+
+    // pack
+    const PackedString packed = f->pack(a);
+    if (in->a_ok) fuzz_expect("pack", packed, a, FLAGS_EXACT);
+    else CHECK(!ps_valid(packed), "pack");
+    CHECK(!ps_valid(f->pack(NULL)), "pack");
+
+    // pack_ex reads exactly len chars, folds case and rejects chars the flags exclude
+    {
+        const u8 n = in->len > PACKED_STRING_MAX_LEN ? PACKED_STRING_MAX_LEN : in->len;
+        bool ok = true;
+        for (u8 i = 0; i < n; i++) {
+            char c = a[i];
+            if (ref_six(c) < 0) ok = false;
+            if (ref_is_digit(c) && !(in->flags & PACKED_FLAG_CONTAINS_DIGIT)) ok = false;
+            if (ref_is_special(c) && !(in->flags & PACKED_FLAG_CONTAINS_SPECIAL)) ok = false;
+            if (!(in->flags & PACKED_FLAG_CASE_SENSITIVE)) c = ref_lower(c);
+            want[i] = c;
+        }
+        want[n] = '\0';
+
+        const PackedString ex = f->pack_ex(a, n, in->flags);
+        if (ok) fuzz_expect("pack_ex", ex, want, FLAGS_EXACT);
+        else CHECK(!ps_valid(ex), "pack_ex");
+    }
+
+    // pack_n on an exact-size copy of the first len bytes, NULs included
+    {
+        const u8 n = in->len;
+        char* slice = malloc(n ? n : 1);
+        if (slice) {
+            memcpy(slice, a, n);
+            memcpy(want, a, n);
+            want[n] = '\0';
+
+            const PackedString sliced = f->pack_n(slice, n);
+            if (n <= PACKED_STRING_MAX_LEN && strlen(want) == n && ref_packable(want))
+                fuzz_expect("pack_n", sliced, want, FLAGS_EXACT);
+            else
+                CHECK(!ps_valid(sliced), "pack_n");
+            free(slice);
+        }
+        CHECK(!ps_valid(f->pack_n(NULL, 0)), "pack_n");
+    }
+
+    if (!in->a_ok) return;
+
+    // unpack
+    memset(buf, '#', sizeof(buf));
+    CHECK(f->unpack(A, buf) == (i32)la && strcmp(buf, a) == 0, "unpack");
+    CHECK(f->unpack(PACKED_STRING_INVALID, buf) == -1, "unpack");
+
+    // unpack_ex: chars the flags exclude are dropped, upper case folded
+    {
+        const u8 n = in->len < la ? in->len : (u8)la;
+        size_t m = 0;
+        for (u8 i = 0; i < n; i++) {
+            const char c = a[i];
+            if (ref_is_digit(c) && !(in->flags & PACKED_FLAG_CONTAINS_DIGIT)) continue;
+            if (ref_is_special(c) && !(in->flags & PACKED_FLAG_CONTAINS_SPECIAL)) continue;
+            want[m++] = in->flags & PACKED_FLAG_CASE_SENSITIVE ? c : ref_lower(c);
+        }
+        want[m] = '\0';
+        CHECK(f->unpack_ex(A, buf, n, in->flags) == (i32)m && strcmp(buf, want) == 0, "unpack_ex");
+    }
+
+    // scan fixes deliberately wrong flags
+    fuzz_expect("scan", f->scan(ps_make(A.lo, A.hi, (u8)la, in->flags)), a, FLAGS_EXACT);
+
+    // set leaves the flags alone
+    {
+        PackedString s = A;
+        const u8 r = f->set(&s, in->idx, in->six);
+        if (in->idx < la) {
+            strcpy(want, a);
+            want[in->idx] = ALPHABET[in->six];
+            CHECK(r == in->six, "set");
+            fuzz_expect("set", s, want, FLAGS_ANY);
+        } else {
+            CHECK(r == UINT8_MAX && ps_equal(s, A), "set");
+        }
+    }
+
+    // at, first, last
+    CHECK(f->at(A, in->idx) == (in->idx < la ? ref_six(a[in->idx]) : UINT8_MAX), "at");
+    CHECK(f->first(A) == (la ? ref_six(a[0]) : UINT8_MAX), "first");
+    CHECK(f->last(A) == (la ? ref_six(a[la - 1]) : UINT8_MAX), "last");
+
+    // case
+    for (size_t i = 0; i <= la; i++) want[i] = ref_lower(a[i]);
+    fuzz_expect("to_lower", f->to_lower(A), want, FLAGS_SOUND);
+    CHECK(!ps_is_case_sensitive(f->to_lower(A)), "to_lower");
+    for (size_t i = 0; i <= la; i++) want[i] = ref_upper(a[i]);
+    fuzz_expect("to_upper", f->to_upper(A), want, FLAGS_SOUND);
+
+    // skip, trunc, substring
+    if (in->idx > la) want[0] = '\0';
+    else ref_slice(a, in->idx, la - in->idx, want);
+    fuzz_expect("skip", f->skip(A, in->idx), want, FLAGS_EXACT);
+
+    ref_slice(a, 0, in->len < la ? in->len : la, want);
+    fuzz_expect("trunc", f->trunc(A, in->len), want, FLAGS_EXACT);
+
+    if (in->len == 0 || in->idx + in->len > la) want[0] = '\0';
+    else ref_slice(a, in->idx, in->len, want);
+    const PackedString sub = f->substring(A, in->idx, in->len);
+    fuzz_expect("substring", sub, want, FLAGS_EXACT);
+
+    // Hash stability: a derived string hashes like the same string packed fresh
+    CHECK(f->hash64(f->scan(sub)) == f->hash64(ref_encode(want, ref_flags(want))), "hash64");
+    CHECK(f->hash32(f->scan(sub)) == f->hash32(ref_encode(want, ref_flags(want))), "hash32");
+
+    // pad: the pad char is a sixbit, lengths up to 20
+    {
+        const char c = ALPHABET[in->six];
+        const size_t n = in->pad > la ? in->pad - la : 0;
+        const size_t left = n / 2;
+
+        memset(want, c, n);
+        strcpy(want + n, a);
+        fuzz_expect("pad_left", f->pad_left(A, in->six, in->pad), want, FLAGS_EXACT);
+
+        strcpy(want, a);
+        memset(want + la, c, n);
+        want[la + n] = '\0';
+        fuzz_expect("pad_right", f->pad_right(A, in->six, in->pad), want, FLAGS_EXACT);
+
+        memset(want, c, left);
+        strcpy(want + left, a);
+        memset(want + left + la, c, n - left);
+        want[la + n] = '\0';
+        fuzz_expect("pad_center", f->pad_center(A, in->six, in->pad), want, FLAGS_EXACT);
+    }
+
+    // find
+    const char c = ALPHABET[in->six];
+    CHECK(f->find_six(A, in->six) == ref_find(a, c, 0), "find_six");
+    CHECK(f->find_from_six(A, in->six, in->idx) == (in->idx < la ? ref_find(a, c, in->idx) : -1), "find_from_six");
+    CHECK(f->find_last_six(A, in->six) == ref_find_last(a, c), "find_last_six");
+    CHECK(f->contains_six(A, in->six) == (ref_find(a, c, 0) >= 0), "contains_six");
+    CHECK(f->find_six(A, 64) == -1 && !f->contains_six(A, 64), "find_six");
+
+    // validation
+    CHECK(f->is_valid_identifier(A) == (la > 0 && !ref_is_digit(a[0])), "is_valid_identifier");
+}
+
+static void fuzz_pair(const fuzz_impl* f, const fuzz_input* in, const PackedString A, const PackedString B) {
+    const char *a = in->a, *b = in->b;
+    const size_t la = strlen(a), lb = strlen(b);
+    char want[2 * REF_MAX];
+
+    bool nocase = la == lb;
+    for (size_t i = 0; nocase && i < la; i++) nocase = ref_lower(a[i]) == ref_lower(b[i]);
+    CHECK(f->equal_nocase(A, B) == nocase, "equal_nocase");
+    CHECK(f->equal_nocase(A, f->to_upper(A)), "equal_nocase");
+
+    CHECK(ref_sign(f->compare(A, B)) == ref_compare(a, b), "compare");
+    CHECK(f->compare(A, A) == 0, "compare");
+
+    CHECK(f->starts_with(A, B) == (lb <= la && memcmp(a, b, lb) == 0), "starts_with");
+    CHECK(f->ends_with(A, B) == (lb <= la && memcmp(a + la - lb, b, lb) == 0), "ends_with");
+    CHECK(f->starts_with_at(A, B, in->idx)
+        == (in->idx + lb <= la && memcmp(a + in->idx, b, lb) == 0), "starts_with_at");
+    CHECK(f->ends_with_at(A, B, in->idx)
+        == (in->idx + lb <= la && memcmp(a + la - lb - in->idx, b, lb) == 0), "ends_with_at");
+
+    CHECK(f->contains(A, B) == (strstr(a, b) != NULL), "contains");
+
+    // concat keeps the first 20 chars
+    if (la == PACKED_STRING_MAX_LEN) {
+        CHECK(ps_equal(f->concat(A, B), A), "concat");
+    } else {
+        strcpy(want, a);
+        strcat(want, b);
+        want[PACKED_STRING_MAX_LEN] = '\0';
+        fuzz_expect("concat", f->concat(A, B), want, FLAGS_EXACT);
+    }
+
+    // hash64_many agrees with hash64
+    const PackedString both[2] = { A, B };
+    u64 many[2];
+    f->hash64_many(both, many, 2);
+    CHECK(many[0] == f->hash64(A) && many[1] == f->hash64(B), "hash64_many");
+}
+
+static void fuzz_lock(const fuzz_impl* f, const fuzz_input* in, const PackedString A, const PackedString K) {
+    if (strlen(in->k) == 0) {
+        CHECK(ps_is_empty(f->lock(A, K)) && ps_is_empty(f->unlock(A, K)), "lock");
+        return;
+    }
+
+    const PackedString locked = f->lock(A, K);
+    CHECK(ps_length(locked) == ps_length(A), "lock");
+    CHECK(ps_equal(f->unlock(locked, K), A), "unlock");
+}
+
+// Source text from the raw input: separators 1 in 4 or 1 in 32 bytes,
+// in an exact-size allocation so ASan sees any read past the end
+static void fuzz_tokenize(const fuzz_impl* f, const fuzz_input* in, const u8* data, const size_t size) {
+    static const char SEPARATORS[] = " (.\n@\x80\xff\0";
+    const u8 sep_below = size && data[0] & 1 ? 0xC0 : 0xF8;
+    char* src = malloc(size ? size : 1);
+    if (!src) return;
+
+    for (size_t i = 0; i < size; i++) {
+        src[i] = data[i] < sep_below ? ALPHABET[data[i] & 63] : SEPARATORS[data[i] & 7];
+    }
+
+    PsTokenizer tk;
+    PsToken out[8];
+    const size_t cap = in->idx % 8 + 1;
+    size_t pos = 0, got;
+    ps_tokenizer_init(&tk, src, size);
+
+    while ((got = f->tokenize(&tk, out, cap)) > 0) {
+        CHECK(got <= cap, "tokenize");
+        for (size_t t = 0; t < got; t++) {
+            // Next run of the model
+            while (pos < size && ref_six(src[pos]) < 0) pos++;
+            size_t end = pos;
+            while (end < size && ref_six(src[end]) >= 0) end++;
+
+            CHECK(pos < size && out[t].offset == pos && out[t].length == end - pos, "tokenize");
+            if (end - pos <= PACKED_STRING_MAX_LEN) {
+                char want[REF_MAX];
+                memcpy(want, src + pos, end - pos);
+                want[end - pos] = '\0';
+                fuzz_expect("tokenize", out[t].ps, want, FLAGS_EXACT);
+            } else {
+                CHECK(!ps_valid(out[t].ps), "tokenize");
+            }
+            pos = end;
+        }
+    }
+
+    while (pos < size && ref_six(src[pos]) < 0) pos++;
+    CHECK(pos == size, "tokenize end");
+    free(src);
+}
+
+// The strings back to back, the invalid one empty
+static void fuzz_unpack_many(const fuzz_impl* f, const PackedString A, const PackedString B,
+    const PackedString K) {
+    const PackedString in[4] = { A, B, K, PACKED_STRING_INVALID };
+    char arena[4 * PACKED_STRING_MAX_LEN];
+    size_t offsets[5];
+    char a[REF_MAX], b[REF_MAX], k[REF_MAX];
+    ref_decode(A, a);
+    ref_decode(B, b);
+    ref_decode(K, k);
+    const size_t la = strlen(a), lb = strlen(b), lk = strlen(k);
+    CHECK(f->unpack_many(in, 4, arena, offsets) == la + lb + lk, "unpack_many");
+    CHECK(offsets[0] == 0 && offsets[1] == la && offsets[2] == la + lb, "unpack_many");
+    CHECK(offsets[3] == la + lb + lk && offsets[4] == offsets[3], "unpack_many");
+    CHECK(memcmp(arena, a, la) == 0 && memcmp(arena + la, b, lb) == 0
+        && memcmp(arena + la + lb, k, lk) == 0, "unpack_many");
+}
+
+// Round trip of the input strings, then the raw input read as a stream:
+// whatever decodes must encode back to the same bytes, and decoding must
+// stop exactly where record-by-record ps_decode stops
+static void fuzz_serialize(const fuzz_impl* f, const PackedString A, const PackedString B,
+    const PackedString K, const u8* data, const size_t size) {
+    const PackedString in[4] = { A, B, K, PACKED_STRING_INVALID };
+    PackedString out[4];
+    u8 stream[4 * PS_ENCODED_MAX];
+    size_t consumed = 0;
+
+    const size_t bytes = f->encode_many(in, 4, stream);
+    CHECK(f->decode_many(stream, bytes, out, 4, &consumed) == 4 && consumed == bytes, "decode_many");
+    CHECK(memcmp(in, out, sizeof(in)) == 0, "decode_many");
+
+    enum { RECORDS = 64 };
+    u8* src = malloc(size ? size : 1);
+    PackedString* ps = malloc(RECORDS * sizeof(PackedString));
+    if (!src || !ps) {
+        free(src);
+        free(ps);
+        return;
+    }
+    memcpy(src, data, size);
+
+    size_t pos = 0, n = 0;
+    while (n < RECORDS) {
+        PackedString one;
+        const size_t record = ps_decode(src + pos, size - pos, &one);
+        if (record == 0) break;
+        pos += record;
+        n++;
+    }
+
+    CHECK(f->decode_many(src, size, ps, RECORDS, &consumed) == n && consumed == pos, "decode_many raw");
+    for (size_t i = 0, at = 0; i < n; i++) {
+        u8 block[PS_ENCODED_MAX];
+        const size_t record = ps_encode(ps[i], block);
+        CHECK(memcmp(block, src + at, record) == 0, "decode_many raw");
+        at += record;
+    }
+
+    free(src);
+    free(ps);
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+
+static void fuzz_one(const u8* data, const size_t size) {
+    fuzz_input* in = &fuzz_current;
+    fuzz_decode(data, size, in);
+
+    const PsTier initial = ps_tier();
+    const PackedString A = ref_encode(in->a_ok ? in->a : "", ref_flags(in->a_ok ? in->a : ""));
+    const PackedString B = ref_encode(in->b_ok ? in->b : "", ref_flags(in->b_ok ? in->b : ""));
+    const PackedString K = ref_encode(in->k_ok ? in->k : "", ref_flags(in->k_ok ? in->k : ""));
+
+    bool first = true;
+    u64 hash64 = 0;
+    u32 hash32 = 0;
+
+    for (size_t i = 0; i < FUZZ_IMPL_COUNT; i++) {
+        fuzz_impl* f = &FUZZ_IMPLS[i];
+        if (f->enter && !f->enter()) continue;
+        fuzz_resolve(f);
+        fuzz_impl_name = f->name;
+
+        fuzz_core(f, in, A);
+        if (in->a_ok && in->b_ok) fuzz_pair(f, in, A, B);
+        if (in->a_ok && in->k_ok) fuzz_lock(f, in, A, K);
+        fuzz_tokenize(f, in, data, size);
+        fuzz_unpack_many(f, A, B, K);
+        fuzz_serialize(f, A, B, K, data, size);
+
+        // Every implementation hashes alike
+        if (first) {
+            hash64 = f->hash64(A);
+            hash32 = f->hash32(A);
+            first = false;
+        }
+        CHECK(f->hash64(A) == hash64 && f->hash32(A) == hash32, "hash stability");
+    }
+
+    ps_set_tier(initial);
+}
+
+#ifdef PS_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const u8* data, const size_t size) {
+    fuzz_one(data, size);
+    return 0;
+}
+
+#else
+
+static int fuzz_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    u8 data[4096];
+    const size_t size = fread(data, 1, sizeof(data), f);
+    fclose(f);
+
+    fuzz_one(data, size);
+    return 0;
+}
+
+int main(const int argc, char** argv) {
+    unsigned long long iterations = 100000, seed = 1;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) iterations = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else {
+            if (fuzz_file(argv[i]) != 0) return 1;
+            files++;
+        }
+    }
+
+    if (files > 0) return 0;
+
+    u64 rng = seed * 0x9E3779B97F4A7C15ULL | 1;
+    u8 data[128];
+
+    for (unsigned long long n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < sizeof(data); i++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            data[i] = (u8)rng;
+        }
+        fuzz_one(data, sizeof(data));
+    }
+
+    printf("fuzz-packed16: %llu inputs, %zu implementations, no mismatches\n",
+        iterations, FUZZ_IMPL_COUNT);
+    return 0;
+}
+
+#endif
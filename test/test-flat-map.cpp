@@ -0,0 +1,229 @@
+/**
+ * @file test-flat-map.cpp
+ * Test suite for ps::flat_map (hash-table/ps-flat-map.hpp)
+ */
+#include "../hash-table/ps-flat-map.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TEST(cond, msg) do \
+    { \
+        if (!(cond)) { \
+            printf("❌ FAIL: %s\n", msg); \
+            failures++; \
+        } else { \
+            printf("✅ OK: %s\n", msg); \
+        } \
+    } while(0)
+
+#define TEST_EQ(a, b, msg) TEST((a) == (b), msg)
+
+using namespace ps::literals;
+
+static void section(const char* name) {
+    printf( "\n═══════════════════════════════════════════════════\n"
+            "  %s"
+            "\n═══════════════════════════════════════════════════\n", name);
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static ps::packed make_key(const std::size_t i) {
+    char key[PACKED_STRING_MAX_LEN + 1];
+    snprintf(key, sizeof(key), "key%zu", i);
+    return ps::packed(std::string_view(key));
+}
+
+// 64 home slots whatever the capacity, so clusters are long and most
+// inserts and erases shift entries; the fingerprint bits are kept
+struct crowded_hash {
+    std::size_t operator()(const ps::packed& k) const noexcept {
+        return std::hash<ps::packed>{}(k) & 0xFFFF00000000003FULL;
+    }
+};
+
+// Every reference key found with its value, nothing else counted
+template <class Map>
+static bool same_contents(const Map& m, const std::unordered_map<ps::packed, std::string>& ref) {
+    if (m.size() != ref.size()) return false;
+    for (const auto& [key, value] : ref) {
+        const auto it = m.find(key);
+        if (it == m.end() || it->second != value) return false;
+    }
+    std::size_t walked = 0;
+    for (const auto& kv : m) {
+        const auto it = ref.find(kv.first);
+        if (it == ref.end() || it->second != kv.second) return false;
+        walked++;
+    }
+    return walked == ref.size();
+}
+
+// Random insert, assign, erase and find against std::unordered_map
+template <class Map>
+static bool random_ops(const std::size_t ops, const std::size_t keys) {
+    Map m;
+    std::unordered_map<ps::packed, std::string> ref;
+    bool ok = true;
+
+    for (std::size_t i = 0; ok && i < ops; i++) {
+        const ps::packed key = make_key(rng() % keys);
+        const std::string value = std::to_string(i);
+
+        switch (rng() % 5) {
+            case 0: {
+                const bool added = m.try_emplace(key, value).second;
+                ok = added == ref.try_emplace(key, value).second;
+                break;
+            }
+            case 1:
+                m.insert_or_assign(key, value);
+                ref.insert_or_assign(key, value);
+                break;
+            case 2:
+                ok = m.erase(key) == ref.erase(key);
+                break;
+            case 3:
+                m[key] += "x";
+                ref[key] += "x";
+                break;
+            default: {
+                const auto it = m.find(key);
+                const auto want = ref.find(key);
+                ok = (it == m.end()) == (want == ref.end()) && (it == m.end() || it->second == want->second)
+                    && m.contains(key) == (want != ref.end());
+                break;
+            }
+        }
+        if (i % 1024 == 0) ok = ok && same_contents(m, ref);
+    }
+    return ok && same_contents(m, ref);
+}
+
+// Erase every third key, the rest must still be found where close_gap put them
+template <class Map>
+static bool partial_erase(const std::size_t n) {
+    Map m;
+    for (std::size_t i = 0; i < n; i++) m.try_emplace(make_key(i), std::to_string(i));
+
+    std::size_t erased = 0;
+    for (std::size_t i = 0; i < n; i += 3) erased += m.erase(make_key(i));
+
+    bool ok = m.size() == n - erased;
+    for (std::size_t i = 0; ok && i < n; i++) {
+        const auto it = m.find(make_key(i));
+        ok = i % 3 == 0 ? it == m.end() : it != m.end() && it->second == std::to_string(i);
+    }
+    return ok;
+}
+
+int test_against_std() {
+    section("Against std::unordered_map");
+    int failures = 0;
+
+    using map = ps::flat_map<std::string>;
+    using crowded = ps::flat_map<std::string, ps::packed, crowded_hash>;
+
+    TEST(random_ops<map>(200000, 3000), "200000 random ops over 3000 keys match");
+    TEST(random_ops<crowded>(100000, 1500), "100000 random ops, 64 home slots, match");
+    TEST(partial_erase<map>(5000), "erase every third of 5000 keys, the rest are found");
+    TEST(partial_erase<crowded>(2000), "erase every third of 2000 crowded keys, the rest are found");
+
+    map m;
+    TEST(m.find("key1"_ps) == m.end() && m.erase("key1"_ps) == 0, "empty map: find and erase miss");
+    m["key1"_ps] = "one";
+    TEST(m.erase("key1"_ps) == 1 && m.empty() && !m.contains("key1"_ps), "erase the only key");
+
+    return failures;
+}
+
+// Constructor throws on a negative value; moves never throw
+struct fragile {
+    int value;
+
+    explicit fragile(const int v) : value(v) {
+        if (v < 0) throw std::runtime_error("fragile");
+    }
+    fragile(fragile&&) noexcept = default;
+    fragile& operator=(fragile&&) noexcept = default;
+};
+
+// After each throwing try_emplace the map is unchanged
+template <class Map>
+static bool throwing_inserts(const std::size_t n) {
+    Map m;
+    bool ok = true;
+
+    for (std::size_t i = 0; ok && i < n; i++) {
+        m.try_emplace(make_key(i), (int)i);
+
+        bool thrown = false;
+        try {
+            m.try_emplace(make_key(n + i), -1);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ok = thrown && m.size() == i + 1 && !m.contains(make_key(n + i));
+    }
+
+    for (std::size_t i = 0; ok && i < n; i++) {
+        const auto it = m.find(make_key(i));
+        ok = it != m.end() && it->second.value == (int)i;
+    }
+    return ok;
+}
+
+int test_exceptions() {
+    section("Throwing Values");
+    int failures = 0;
+
+    using map = ps::flat_map<fragile>;
+    using crowded = ps::flat_map<fragile, ps::packed, crowded_hash>;
+
+    TEST(throwing_inserts<map>(3000), "throwing try_emplace keeps size and every key");
+    TEST(throwing_inserts<crowded>(1500), "throwing try_emplace in long clusters keeps every key");
+
+    map m;
+    m.try_emplace("key1"_ps, 1);
+    bool thrown = false;
+    try {
+        m.try_emplace("key1"_ps, -1);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    TEST(!thrown && m.at("key1"_ps).value == 1, "try_emplace of a present key constructs nothing");
+
+    return failures;
+}
+
+int main() {
+    printf( "=================================================\n"
+            "            ps::flat_map Tests\n"
+            "=================================================\n");
+
+    int failed = 0;
+    failed += test_against_std();
+    failed += test_exceptions();
+
+    section("Summary");
+
+    if (failed == 0) {
+        printf("✅ All tests passed!\n");
+    } else {
+        printf("❌ %d test(s) failed\n", failed);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
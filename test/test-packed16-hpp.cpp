@@ -0,0 +1,161 @@
+/**
+ * @file test-packed16-hpp.cpp
+ * Test suite for the C++ wrapper
+ */
+#include "../packed16/packed-string.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TEST(cond, msg) do \
+    { \
+        if (!(cond)) { \
+            printf("❌ FAIL: %s\n", msg); \
+            failures++; \
+        } else { \
+            printf("✅ OK: %s\n", msg); \
+        } \
+    } while(0)
+
+#define TEST_EQ(a, b, msg) TEST((a) == (b), msg)
+
+using namespace ps::literals;
+
+// Packed at compile time
+constexpr ps::packed HELLO = "hello";
+constexpr ps::packed MIXED = "Get_value2";
+static_assert(HELLO.length() == 5);
+static_assert(HELLO == "hello"_ps);
+static_assert(HELLO != ps::packed("hellO"));
+static_assert(MIXED.flags() == (PACKED_FLAG_CASE_SENSITIVE | PACKED_FLAG_CONTAINS_DIGIT
+                                | PACKED_FLAG_CONTAINS_SPECIAL));
+static_assert(!ps::packed("no spaces").valid());
+static_assert(!ps::packed("abcdefghijklmnopqrstu").valid());
+static_assert(ps::packed().empty() && ps::packed("").empty());
+static_assert(std::is_trivially_copyable_v<ps::packed>);
+
+static void section(const char* name) {
+    printf( "\n═══════════════════════════════════════════════════\n"
+            "  %s"
+            "\n═══════════════════════════════════════════════════\n", name);
+}
+
+int test_construction() {
+    section("Construction");
+    int failures = 0;
+
+    static const char* const words[] = {
+        "", "a", "hello", "HeLLo_World", "x0", "$", "abcdefghij", "abcdefghijk",
+        "ABCDEFGHIJKLMNOPQRST", "a1_$B2c3D4e5F6g7H8i9", "bad char", "abcdefghijklmnopqrstu"
+    };
+
+    // The constexpr packer gives the same bits as the library
+    bool same = true;
+    for (const char* w : words) {
+        const PackedString c = ps_pack(w);
+        const PackedString cx = ps::detail::pack(w);
+        const ps::packed p{std::string_view(w)};
+        same = same && ps_equal(c, cx) && ps_equal(c, p);
+    }
+    TEST(same, "constexpr and run-time packing match ps_pack");
+
+    TEST(ps_equal(HELLO, ps_pack("hello")), "constexpr literal = ps_pack");
+    TEST(ps_equal("a1_$B2c3D4e5F6g7H8i9"_ps, ps_pack("a1_$B2c3D4e5F6g7H8i9")), "_ps literal = ps_pack");
+    TEST(ps_equal(ps::packed(std::string_view()), ps_empty()), "empty string_view packs to ps_empty");
+    TEST(ps_equal(ps::packed(std::string_view("hello world", 5)), HELLO), "string_view needs no terminator");
+    TEST_EQ(ps_length(MIXED), 10, "ps::packed passes to the C API");
+
+    return failures;
+}
+
+int test_operators() {
+    section("Operators");
+    int failures = 0;
+
+    static const char* const words[] = {
+        "b", "a", "ab", "a0", "A", "Z", "_", "$", "aa", "zz", "getValue", "get_value",
+        "getvalue", "GETVALUE", "x9", "x10", "abcdefghijklmnopqrst"
+    };
+    std::vector<ps::packed> sorted;
+    for (const char* w : words) sorted.emplace_back(std::string_view(w));
+    std::sort(sorted.begin(), sorted.end());
+
+    bool ordered = true;
+    for (std::size_t i = 1; i < sorted.size(); i++)
+        ordered = ordered && ps_compare(sorted[i - 1], sorted[i]) < 0;
+    TEST(ordered, "std::sort orders like ps_compare");
+
+    TEST("a"_ps < "a0"_ps, "prefix sorts first");
+    TEST("z"_ps < "A"_ps, "lowercase sorts before uppercase");
+    TEST(("abc"_ps <=> "abc"_ps) == 0, "<=> equal");
+    TEST("abc"_ps != "abd"_ps, "!= differs");
+
+    // Results of the C API against literals, flags set or stale
+    const ps::packed get = ps_trunc(ps_pack("getName"), 3);
+    TEST(get == "get"_ps && (get <=> "get"_ps) == 0, "ps_trunc result == and <=> a literal");
+    const ps::packed stale = ps_make(ps_pack("get").lo, ps_pack("get").hi, 3, PACKED_FLAG_CASE_SENSITIVE);
+    TEST(stale == "get"_ps && (stale <=> "get"_ps) == 0, "stale flags: == agrees with <=>");
+    TEST(stale.hash() == "get"_ps.hash(), "stale flags: same hash");
+    TEST("get"_ps != "get0"_ps, "'0' padding: lengths still differ");
+
+    return failures;
+}
+
+int test_hash_and_view() {
+    section("Hash and View");
+    int failures = 0;
+
+    std::unordered_map<ps::packed, int> map;
+    char key[PACKED_STRING_MAX_LEN + 1];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        map[ps::packed(std::string_view(key))] = i;
+    }
+    TEST_EQ(map.size(), 1000u, "std::unordered_map stores every key");
+    TEST_EQ(map.at("key517"_ps), 517, "std::unordered_map finds a key");
+    TEST(map.find("key1000"_ps) == map.end(), "std::unordered_map misses an absent key");
+    TEST_EQ(map.at(ps_trunc(ps_pack("key5170"), 6)), 517, "std::unordered_map finds a ps_trunc result");
+    TEST_EQ(map.at(ps_skip(ps_pack("Xkey42"), 1)), 42, "std::unordered_map finds a ps_skip result");
+
+    // Strings differing in one char land in different low bits
+    std::size_t buckets[64] = {};
+    for (int i = 0; i < 64 * 64; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        buckets[std::hash<ps::packed>{}(ps::packed(std::string_view(key))) & 63]++;
+    }
+    TEST(*std::max_element(buckets, buckets + 64) < 2 * 64, "std::hash spreads sequential keys");
+
+    char buffer[PACKED_STRING_MAX_LEN + 1];
+    TEST(MIXED.view(buffer) == "Get_value2", "view into a caller buffer");
+    TEST(HELLO.view() == "hello", "view into the thread-local buffer");
+    TEST(static_cast<std::string_view>(MIXED) == "Get_value2", "string_view conversion");
+    TEST(HELLO.str() == "hello", "str copies");
+    TEST(ps::packed("bad char").view().empty(), "invalid strings view as empty");
+
+    return failures;
+}
+
+int main() {
+    printf( "=================================================\n"
+            "        PackedString C++ Wrapper Tests\n"
+            "=================================================\n");
+
+    int failed = 0;
+    failed += test_construction();
+    failed += test_operators();
+    failed += test_hash_and_view();
+
+    section("Summary");
+
+    if (failed == 0) {
+        printf("✅ All tests passed!\n");
+    } else {
+        printf("❌ %d test(s) failed\n", failed);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -3,12 +3,19 @@
  * Test suite for PackedString library
  */
 #include "../packed16/packed-string.h"
+#include "../packed16/slab.h"
 
 #include <assert.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define PS_TEST_GUARD_PAGES 1
+#endif
+
 #define TEST(cond, msg) do \
     { \
         if (!(cond)) { \
@@ -120,6 +127,17 @@ int test_core_operations() {
     PackedString too_long_packed = ps_pack(too_long);
     TEST(!ps_valid(too_long_packed), "ps_valid(ps_pack(>20 chars)) = false");
 
+    // Test ps_pack_n on slices of a longer, unterminated buffer
+    const char source[] = { 'g', 'e', 't', 'V', 'a', 'l', 'u', 'e', '(', 'x', '_', '1', ')' };
+    TEST(ps_equal(ps_pack_n(source, 8), ps_pack("getValue")), "ps_pack_n('getValue(', 8) = 'getValue'");
+    TEST(ps_equal(ps_pack_n(source + 9, 3), ps_pack("x_1")), "ps_pack_n('x_1)', 3) = 'x_1'");
+    TEST(ps_equal(ps_pack_n(source, 0), ps_empty()), "ps_pack_n(str, 0) = empty");
+    TEST(!ps_valid(ps_pack_n(source, 9)), "ps_pack_n('getValue(', 9) = invalid");
+    TEST(!ps_valid(ps_pack_n(NULL, 0)), "ps_pack_n(NULL) = invalid");
+    TEST(!ps_valid(ps_pack_n(too_long, 21)), "ps_pack_n(str, 21) = invalid");
+    TEST(ps_equal(ps_pack_n(too_long, 20), ps_pack("thisstringisdefinite")), "ps_pack_n(str, 20) = first 20 chars");
+    TEST_EQ(ps_flags(ps_pack_n("Ab_1", 4)), ps_flags(ps_pack("Ab_1")), "ps_pack_n flags = ps_pack flags");
+
     return failures;
 }
 
@@ -172,6 +190,15 @@ int test_character_access() {
     TEST_EQ(ps_at(ps, 13), ps_char('3'), "ps_at(14) = '3'");
     TEST_EQ(ps_at(ps, 15), UINT8_MAX, "ps_at(15) = UINT8_MAX");
 
+    // Every position, char 10 straddles lo and hi
+    const char* full = "abcdefghijKLMNOPQR_$";
+    const PackedString ps_full = ps_pack(full);
+    bool sixbit_ok = true;
+    for (u8 i = 0; i < PACKED_STRING_MAX_LEN; i++)
+        sixbit_ok &= ps_sixbit_at(ps_full, i) == ps_char(full[i]) && ps_sixbit_at(ps_full, i) == ps_at(ps_full, i);
+    TEST(sixbit_ok, "ps_sixbit_at = ps_at at every position of a 20-char string");
+    TEST_EQ(ps_sixbit_at(ps, 15), 0, "ps_sixbit_at(15) past the length = 0");
+
     TEST_EQ(ps_first(ps), ps_char('h'), "ps_first() = 'h'");
     TEST_EQ(ps_last(ps), ps_char('3'), "ps_last() = '3'");
 
@@ -214,6 +241,29 @@ int test_comparisons() {
     TEST(ps_compare(ps1, ps5) > 0, "ps_compare('hello', 'hell') > 0");
     TEST(ps_compare(ps5, ps1) < 0, "ps_compare('hell', 'hello') < 0");
     TEST_EQ(ps_compare(ps1, ps2), 0, "ps_compare('hello', 'hello') = 0");
+    TEST(ps_compare(ps_pack("ab"), ps_pack("ba")) < 0, "ps_compare('ab', 'ba') < 0");
+    TEST(ps_compare(ps_pack("b"), ps_pack("ab")) > 0, "ps_compare('b', 'ab') > 0");
+    TEST(ps_compare(ps_pack("abcdefghijkZ"), ps_pack("abcdefghijka")) > 0,
+        "ps_compare('abcdefghijkZ', 'abcdefghijka') > 0");
+
+    // ps_compare_inline is ps_compare, for every pair of a few tricky strings
+    const PackedString order[] = {
+        ps_pack(""), ps_pack("0"), ps_pack("00"), ps_pack("a"), ps_pack("a0"), ps_pack("ab"),
+        ps_pack("abcdefghij"), ps_pack("abcdefghijk"), ps_pack("abcdefghijl"),
+        ps_pack("abcdefghijkZ"), ps_pack("abcdefghijklmnopqrst"), ps_pack("abcdefghijklmnopqrs$"),
+        PACKED_STRING_NULL, PACKED_STRING_INVALID,
+    };
+    const size_t count = sizeof(order) / sizeof(order[0]);
+    bool inline_ok = true;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < count; j++) {
+            const i32 c = ps_compare(order[i], order[j]);
+            inline_ok &= ps_compare_inline(order[i], order[j]) == c;
+            inline_ok &= (c == 0) == (i == j);
+        }
+    }
+    TEST(inline_ok, "ps_compare_inline = ps_compare on every pair");
+    TEST(ps_compare_inline(ps_pack("a"), ps_pack("a0")) < 0, "ps_compare_inline('a', 'a0') < 0");
 
     return failures;
 }
@@ -285,6 +335,10 @@ int test_case_conversion() {
     TEST_STR_EQ(buffer, "HELLOWORLD", "ps_to_upper('HelloWorld') = 'HELLOWORLD'");
     TEST(ps_is_case_sensitive(upper), "ps_to_upper() flags |= CASE");
 
+    // Strings shorter than 11 chars have nothing in hi to convert
+    TEST(ps_equal(ps_to_lower(ps_pack("AbC")), ps_pack("abc")), "ps_to_lower('AbC') = 'abc'");
+    TEST(ps_equal(ps_to_upper(ps_pack("x")), ps_pack("X")), "ps_to_upper('x') = 'X'");
+
     return failures;
 }
 
@@ -373,6 +427,352 @@ int test_hashing() {
     return failures;
 }
 
+// ============================================================================
+// CPU DISPATCH TESTS
+// ============================================================================
+
+int test_dispatch() {
+    section("CPU Dispatch");
+    int failures = 0;
+
+    static const char* const words[] = {
+        "", "a", "Z", "0", "_", "$", "hello", "HeLLo_World", "abcdefghij", "abcdefghijK",
+        "ABCDEFGHIJKLMNOPQRST", "abcdefghijklmnopqrst", "a1_$B2c3D4e5F6g7H8i9",
+        "getValue", "MAX_BUFFER_SIZE", "x0", "hello@world", "abcdefghijklmnopqrstu"
+    };
+    enum { WORDS = sizeof(words) / sizeof(*words) };
+
+    PackedString packed[WORDS], packed_n[WORDS], lower[WORDS], upper[WORDS];
+    char unpacked[WORDS][PACKED_STRING_MAX_LEN + 1];
+    char arena[WORDS * PACKED_STRING_MAX_LEN];
+    size_t offsets[WORDS + 1];
+    i8 found[WORDS][64], found_last[WORDS][64];
+    u64 hashes[WORDS];
+
+    const PsTier initial = ps_tier();
+    TEST(ps_tier() <= ps_cpu_tier(), "ps_tier() <= ps_cpu_tier()");
+    TEST(ps_set_tier(PS_TIER_SCALAR), "ps_set_tier(PS_TIER_SCALAR) = true");
+    TEST(!ps_set_tier(PS_TIER_COUNT), "ps_set_tier(PS_TIER_COUNT) = false");
+    TEST_EQ(ps_tier_parse("avx2"), PS_TIER_AVX2, "ps_tier_parse('avx2') = PS_TIER_AVX2");
+    TEST_EQ(ps_tier_parse("sse9"), PS_TIER_COUNT, "ps_tier_parse('sse9') = PS_TIER_COUNT");
+    TEST_STR_EQ(ps_tier_name(PS_TIER_BMI2), "bmi2", "ps_tier_name(PS_TIER_BMI2) = 'bmi2'");
+
+    // Scalar results are the reference for every other tier
+    for (u8 i = 0; i < WORDS; i++) {
+        packed[i] = ps_pack(words[i]);
+        packed_n[i] = ps_pack_n(words[i], strlen(words[i]) - i % 2);
+        lower[i] = ps_to_lower(packed[i]);
+        upper[i] = ps_to_upper(packed[i]);
+        ps_unpack(packed[i], unpacked[i]);
+        for (u8 six = 0; six < 64; six++) {
+            found[i][six] = ps_find_from_six(packed[i], six, i % 3);
+            found_last[i][six] = ps_find_last_six(packed[i], six);
+        }
+    }
+    ps_hash64_many(packed, hashes, WORDS);
+
+    // Back to back, the 21-char word is invalid and stays empty
+    const size_t total = ps_unpack_many(packed, WORDS, arena, offsets);
+    bool joined = total == offsets[WORDS] && offsets[0] == 0;
+    for (u8 i = 0; joined && i < WORDS; i++) {
+        const size_t length = ps_valid(packed[i]) ? strlen(words[i]) : 0;
+        joined = offsets[i + 1] - offsets[i] == length
+            && memcmp(arena + offsets[i], words[i], length) == 0;
+    }
+    TEST(joined, "ps_unpack_many writes every string back to back");
+
+    for (u8 t = PS_TIER_BMI2; t <= ps_cpu_tier(); t++) {
+        char msg[64];
+        bool same = ps_set_tier((PsTier)t);
+
+        for (u8 i = 0; same && i < WORDS; i++) {
+            char buffer[PACKED_STRING_MAX_LEN + 1] = "";
+            same = ps_equal(ps_pack(words[i]), packed[i])
+                && ps_equal(ps_pack_n(words[i], strlen(words[i]) - i % 2), packed_n[i])
+                && ps_equal(ps_to_lower(packed[i]), lower[i])
+                && ps_equal(ps_to_upper(packed[i]), upper[i])
+                && (!ps_valid(packed[i]) || (ps_unpack(packed[i], buffer) >= 0 && strcmp(buffer, unpacked[i]) == 0));
+
+            for (u8 six = 0; same && six < 64; six++) {
+                same = ps_find_from_six(packed[i], six, i % 3) == found[i][six]
+                    && ps_find_last_six(packed[i], six) == found_last[i][six];
+            }
+        }
+
+        u64 many[WORDS];
+        ps_hash64_many(packed, many, WORDS);
+        same = same && memcmp(many, hashes, sizeof(many)) == 0;
+
+        char other[WORDS * PACKED_STRING_MAX_LEN];
+        size_t other_offsets[WORDS + 1];
+        same = same && ps_unpack_many(packed, WORDS, other, other_offsets) == total
+            && memcmp(other_offsets, offsets, sizeof(offsets)) == 0
+            && memcmp(other, arena, total) == 0;
+
+        snprintf(msg, sizeof(msg), "tier %s matches scalar", ps_tier_name((PsTier)t));
+        TEST(same, msg);
+    }
+
+    // Case folding leaves every non-string as it is, on every tier
+    const PackedString states[] = { ps_pack("hello@world"), ps_pack("abcdefghijklmnopqrstu"), PACKED_STRING_NULL,
+                                    PACKED_STRING_EMPTY, ps_make(~0ULL, ~0ULL, PSC_INVALID, 7) };
+    for (u8 t = PS_TIER_SCALAR; t <= ps_cpu_tier(); t++) {
+        char msg[64];
+        bool same = ps_set_tier((PsTier)t);
+        for (u8 i = 0; same && i < sizeof(states) / sizeof(*states); i++)
+            same = ps_equal(ps_to_lower(states[i]), states[i]) && ps_equal(ps_to_upper(states[i]), states[i]);
+
+        snprintf(msg, sizeof(msg), "tier %s: case folding keeps non-strings", ps_tier_name((PsTier)t));
+        TEST(same, msg);
+    }
+
+    bool hashed = true;
+    for (u8 i = 0; i < WORDS; i++) hashed = hashed && hashes[i] == ps_hash64(packed[i]);
+    TEST(hashed, "ps_hash64_many = ps_hash64");
+    TEST(ps_set_tier(initial), "ps_set_tier(initial) = true");
+
+    return failures;
+}
+
+// ============================================================================
+// TOKENIZER TESTS
+// ============================================================================
+
+int test_tokenizer() {
+    section("Tokenizer");
+    int failures = 0;
+
+    // Not terminated, runs of every length around the 20-char limit and the
+    // 64-byte blocks, one crossing a block end, one touching the buffer end
+    char src[256];
+    size_t len = 0;
+    const char* parts[] = {
+        "int ", "getValue", "(x1, $y_2);\n", "abcdefghijklmnopqrst", " ",
+        "abcdefghijklmnopqrstu", "+-", "MAX_BUFFER_SIZE", "\xC3\xA9", "ok", ".",
+        "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", "@", "Z9"
+    };
+    for (u8 i = 0; i < sizeof(parts) / sizeof(*parts); i++) {
+        memcpy(src + len, parts[i], strlen(parts[i]));
+        len += strlen(parts[i]);
+    }
+
+    static const char* const expected[] = {
+        "int", "getValue", "x1", "$y_2", "abcdefghijklmnopqrst", NULL,
+        "MAX_BUFFER_SIZE", "ok", NULL, "Z9"
+    };
+    enum { EXPECTED = sizeof(expected) / sizeof(*expected) };
+
+    PsTokenizer tk;
+    PsToken tokens[32];
+    ps_tokenizer_init(&tk, src, len);
+    const size_t n = ps_tokenize(&tk, tokens, 32);
+    TEST_EQ(n, EXPECTED, "ps_tokenize finds every run");
+    TEST_EQ(ps_tokenize(&tk, tokens + n, 32 - n), 0, "ps_tokenize = 0 at the end");
+
+    bool same = n == EXPECTED;
+    for (size_t i = 0; same && i < n; i++) {
+        char buffer[PACKED_STRING_MAX_LEN + 1];
+        same = tokens[i].length == (expected[i] ? strlen(expected[i]) : tokens[i].length)
+            && (expected[i]
+                ? ps_unpack(tokens[i].ps, buffer) >= 0 && strcmp(buffer, expected[i]) == 0
+                    && ps_equal(tokens[i].ps, ps_pack(expected[i]))
+                    && memcmp(src + tokens[i].offset, expected[i], tokens[i].length) == 0
+                : !ps_valid(tokens[i].ps) && tokens[i].length > PACKED_STRING_MAX_LEN)
+            && tokens[i].offset + tokens[i].length <= len;
+    }
+    TEST(same, "ps_tokenize tokens, offsets and flags match ps_pack");
+    TEST_EQ(tokens[5].length, 21, "21-char run keeps its length");
+    TEST_EQ(tokens[8].length, 76, "run across a block end keeps its length");
+    TEST_EQ(tokens[9].offset, len - 2, "run ends at the buffer end");
+
+    // One token per call resumes where it stopped
+    PsToken one;
+    size_t count = 0;
+    bool resumed = true;
+    ps_tokenizer_init(&tk, src, len);
+    while (ps_tokenize(&tk, &one, 1) == 1) {
+        resumed = resumed && count < n && one.offset == tokens[count].offset
+            && one.length == tokens[count].length && ps_equal(one.ps, tokens[count].ps);
+        count++;
+    }
+    TEST(resumed && count == n, "ps_tokenize with cap 1 resumes");
+
+    ps_tokenizer_init(&tk, NULL, 10);
+    TEST_EQ(ps_tokenize(&tk, tokens, 32), 0, "ps_tokenize(NULL) = 0");
+
+    // Every tier finds the same tokens
+    const PsTier initial = ps_tier();
+    for (u8 t = PS_TIER_SCALAR; t <= ps_cpu_tier(); t++) {
+        char msg[64];
+        PsToken other[32];
+        ps_set_tier((PsTier)t);
+        ps_tokenizer_init(&tk, src, len);
+        same = ps_tokenize(&tk, other, 32) == n;
+        for (size_t i = 0; same && i < n; i++) {
+            same = other[i].offset == tokens[i].offset && other[i].length == tokens[i].length
+                && ps_equal(other[i].ps, tokens[i].ps);
+        }
+        snprintf(msg, sizeof(msg), "ps_tokenize on tier %s", ps_tier_name((PsTier)t));
+        TEST(same, msg);
+    }
+    ps_set_tier(initial);
+
+    return failures;
+}
+
+// ============================================================================
+// SERIALIZATION TESTS
+// ============================================================================
+
+int test_serialization() {
+    section("Serialization");
+    int failures = 0;
+
+    static const char* const words[] = {
+        "", "a", "ab", "abc", "abcd", "HeLLo_World", "x0", "$", "abcdefghijklmnopqrs",
+        "ABCDEFGHIJKLMNOPQRST", "a1_$B2c3D4e5F6g7H8i9", "getValue", "MAX_BUFFER_SIZE"
+    };
+    enum { WORDS = sizeof(words) / sizeof(*words), COUNT = WORDS + 2 };
+
+    PackedString in[COUNT], out[COUNT];
+    for (u8 i = 0; i < WORDS; i++) in[i] = ps_pack(words[i]);
+    in[WORDS] = PACKED_STRING_INVALID;
+    in[WORDS + 1] = ps_pack("abcdefghijklmnopqrstu");
+
+    u8 block[PS_ENCODED_MAX];
+    TEST_EQ(ps_encode(ps_pack(""), block), 1, "ps_encode('') = 1 byte");
+    TEST_EQ(ps_encode(ps_pack("a"), block), 2, "ps_encode('a') = 2 bytes");
+    TEST_EQ(ps_encode(ps_pack("abcd"), block), 4, "ps_encode('abcd') = 4 bytes");
+    TEST_EQ(ps_encode(ps_pack("abcdefghijklmnopqrst"), block), 16, "20 chars = 16 bytes");
+    TEST_EQ(ps_encode(PACKED_STRING_INVALID, block), 1, "PSC_INVALID = 1 byte");
+    TEST_EQ(block[0], (u8)(PACKED_STRING_INVALID.hi >> 56), "PSC_INVALID keeps its metadata");
+
+    // Bits past the length are not written
+    ps_encode(ps_make(0xFFFFFFFFFFFFFFFFULL, 0, 1, 0), block);
+    TEST_EQ(block[1], 0x3F, "ps_encode drops bits past the length");
+
+    u8 stream[COUNT * PS_ENCODED_MAX];
+    size_t bytes = 0;
+    for (u8 i = 0; i < COUNT; i++) bytes += ps_encoded_size(in[i]);
+    TEST_EQ(ps_encode_many(in, COUNT, stream), bytes, "ps_encode_many = sum of ps_encoded_size");
+
+    size_t consumed = 0;
+    TEST_EQ(ps_decode_many(stream, bytes, out, COUNT, &consumed), COUNT, "ps_decode_many decodes all");
+    TEST_EQ(consumed, bytes, "ps_decode_many consumes the stream");
+    TEST(memcmp(in, out, sizeof(in)) == 0, "ps_decode_many round trip is exact");
+
+    size_t pos = 0;
+    bool single = true;
+    for (u8 i = 0; i < COUNT; i++) {
+        PackedString ps;
+        const size_t size = ps_decode(stream + pos, bytes - pos, &ps);
+        single = single && size == ps_encoded_size(in[i]) && ps_equal(ps, in[i]);
+        pos += size;
+    }
+    TEST(single && pos == bytes, "ps_decode round trip is exact");
+
+    // Cut off mid-record, then resumed from consumed
+    PackedString ps;
+    TEST_EQ(ps_decode(stream, 0, &ps), 0, "ps_decode of nothing = 0");
+    const size_t cut = ps_encoded_size(in[0]) + 1;
+    size_t got = ps_decode_many(stream, cut, out, COUNT, &consumed);
+    TEST(got == 1 && consumed == ps_encoded_size(in[0]), "ps_decode_many stops at a cut-off record");
+    got += ps_decode_many(stream + consumed, bytes - consumed, out + got, COUNT - got, &consumed);
+    TEST(got == COUNT && memcmp(in, out, sizeof(in)) == 0, "ps_decode_many resumes from consumed");
+
+    TEST_EQ(ps_decode_many(stream, bytes, out, 3, &consumed), 3, "ps_decode_many stops at n");
+
+    // A set bit past the length of 'a' (6 bits in one byte)
+    u8 bad[PS_ENCODED_MAX];
+    ps_encode(ps_pack("a"), bad);
+    bad[1] |= 0x40;
+    TEST_EQ(ps_decode(bad, 2, &ps), 0, "ps_decode rejects bits past the length");
+
+    // Every tier decodes the same and stops at the same bad record
+    u8 big[64 * PS_ENCODED_MAX + 2];
+    PackedString many[64], back[64];
+    for (u8 i = 0; i < 64; i++) many[i] = in[i % COUNT];
+    const size_t half = ps_encode_many(many, 32, big);
+    const size_t rest = ps_encode_many(many + 32, 32, big + half + 2);
+    memcpy(big + half, bad, 2);
+
+    const PsTier initial = ps_tier();
+    for (u8 t = PS_TIER_SCALAR; t <= ps_cpu_tier(); t++) {
+        char msg[64];
+        ps_set_tier((PsTier)t);
+        bool same = ps_decode_many(big, half + 2 + rest, back, 64, &consumed) == 32 && consumed == half;
+        same = same && ps_decode_many(big + half + 2, rest, back + 32, 32, &consumed) == 32
+            && consumed == rest && memcmp(back, many, sizeof(many)) == 0;
+        snprintf(msg, sizeof(msg), "ps_decode_many on tier %s", ps_tier_name((PsTier)t));
+        TEST(same, msg);
+    }
+    ps_set_tier(initial);
+
+    return failures;
+}
+
+// ============================================================================
+// SLAB ALLOCATOR TESTS
+// ============================================================================
+
+int test_slab() {
+    section("Slab Allocator");
+    int failures = 0;
+
+    TEST_EQ(ps_slab_class(1), 0, "ps_slab_class(1) = 32 bytes");
+    TEST_EQ(ps_slab_class(32), 0, "ps_slab_class(32) = 32 bytes");
+    TEST_EQ(ps_slab_class(33), 1, "ps_slab_class(33) = 64 bytes");
+    TEST_EQ(ps_slab_class(128), 2, "ps_slab_class(128) = 128 bytes");
+
+    PsSlab slab;
+    ps_slab_init(&slab);
+    TEST_EQ(ps_slab_bytes(&slab), 0, "ps_slab_init allocates nothing");
+
+    PsSlabCache a, b;
+    ps_slab_cache_init(&a, &slab);
+    ps_slab_cache_init(&b, &slab);
+    TEST(ps_slab_alloc(&a, 0) == NULL, "ps_slab_alloc(0) = NULL");
+    TEST(ps_slab_alloc(&a, PS_SLAB_MAX + 1) == NULL, "ps_slab_alloc past PS_SLAB_MAX = NULL");
+
+    // More than one chunk per class, objects aligned, distinct and writable
+    enum { OBJECTS = PS_SLAB_CHUNK / PS_SLAB_MIN + 8 };
+    static void* objs[PS_SLAB_CLASSES][OBJECTS];
+    bool aligned = true, written = true;
+    for (u8 c = 0; c < PS_SLAB_CLASSES; c++) {
+        const size_t size = (size_t)PS_SLAB_MIN << c;
+        const size_t align = size < PS_SLAB_ALIGN ? size : PS_SLAB_ALIGN;
+        for (size_t i = 0; i < OBJECTS; i++) {
+            objs[c][i] = ps_slab_alloc(i & 1 ? &b : &a, size);
+            aligned = aligned && objs[c][i] && (uintptr_t)objs[c][i] % align == 0;
+            if (objs[c][i]) memset(objs[c][i], (int)(i & 0xFF), size);
+        }
+        for (size_t i = 0; i < OBJECTS; i++)
+            written = written && ((u8*)objs[c][i])[size - 1] == (u8)i;
+    }
+    TEST(aligned, "ps_slab_alloc objects are aligned to their class");
+    TEST(written, "ps_slab_alloc objects do not overlap");
+
+    // Freed objects come back first, to the cache that freed them
+    ps_slab_free(&b, objs[0][0], 16);
+    ps_slab_free(&b, objs[0][2], 20);
+    TEST(ps_slab_alloc(&b, 32) == objs[0][2], "ps_slab_alloc reuses the last freed object");
+    TEST(ps_slab_alloc(&b, 1) == objs[0][0], "ps_slab_alloc reuses freed objects in LIFO order");
+    ps_slab_free(&a, NULL, 32);
+
+    // Reset keeps the chunks and hands them out again
+    ps_slab_free(&a, objs[2][4], 128);
+    const size_t bytes = ps_slab_bytes(&slab);
+    ps_slab_reset(&slab);
+    TEST(ps_slab_alloc(&a, 64) != NULL && ps_slab_alloc(&b, 64) != NULL, "ps_slab_alloc works after ps_slab_reset");
+    TEST_EQ(ps_slab_bytes(&slab), bytes, "ps_slab_reset reuses chunks");
+    TEST(ps_slab_alloc(&a, 128) != objs[2][4], "ps_slab_reset drops the cache free lists");
+
+    ps_slab_destroy(&slab);
+    TEST_EQ(ps_slab_bytes(&slab), 0, "ps_slab_destroy releases every chunk");
+
+    return failures;
+}
+
 // ============================================================================
 // LOCK/UNLOCK TESTS
 // ============================================================================
@@ -522,6 +922,61 @@ int test_edge_cases() {
     PackedString null_ex = ps_pack_ex(NULL, 5, 0);
     TEST(!ps_valid(null_ex), "ps_valid(ps_pack_ex(NULL)) = false");
 
+    // Found by fuzz-packed16
+    PackedString long_id = ps_pack("abcdefghijkLmnopqrst");
+    TEST_EQ(ps_length(ps_skip(long_id, 5)), 15, "ps_skip(20-char, 5) has length 15");
+    TEST_EQ(ps_length(ps_skip(long_id, 0)), 20, "ps_skip(20-char, 0) keeps length");
+    TEST(ps_is_case_sensitive(ps_trunc(long_id, 12)), "ps_trunc keeps CASE_SENSITIVE");
+    TEST(ps_is_case_sensitive(ps_substring(long_id, 10, 3)), "ps_substring keeps CASE_SENSITIVE");
+    TEST(ps_equal(ps_trunc(ps_pack("getName"), 3), ps_pack("get")),
+        "ps_trunc('getName', 3) = ps_pack('get'), flags included");
+    TEST(ps_equal(ps_skip(ps_pack("m_count"), 2), ps_pack("count")),
+        "ps_skip('m_count', 2) = ps_pack('count')");
+    TEST(ps_equal(ps_substring(ps_pack("Get2nd_value"), 7, 5), ps_pack("value")),
+        "ps_substring('Get2nd_value', 7, 5) = ps_pack('value')");
+    TEST(ps_equal(ps_substring(long_id, 10, 3), ps_pack("kLm")),
+        "ps_substring across char 10 = ps_pack('kLm')");
+    TEST(ps_equal(ps_concat(ps_pack("abcdefghijklmnopq"), ps_pack("rsT_")), ps_pack("abcdefghijklmnopqrsT")),
+        "ps_concat cut at 20 chars = ps_pack of the kept text");
+    TEST_EQ(ps_find_six(ps_pack("ab"), ps_char('0')), -1, "ps_find_six('ab', '0') = -1");
+    TEST_EQ(ps_find_from_six(ps_pack("a0b"), ps_char('0'), 2), -1,
+        "ps_find_from_six('a0b', '0', 2) = -1");
+    TEST(!ps_equal_nocase(ps_pack("a"), ps_pack("a0")), "ps_equal_nocase('a', 'a0') = false");
+    TEST(!ps_equal_nocase(ps_pack("abcdefghijk"), ps_pack("abcdefghijZ")),
+        "ps_equal_nocase compares char 10");
+    TEST(ps_equal_nocase(ps_pack("abcdefghijK"), ps_pack("ABCDEFGHIJk")),
+        "ps_equal_nocase folds char 10");
+    TEST(!ps_is_case_sensitive(ps_pack_ex("ABC", 3, 0)), "ps_pack_ex folded has no CASE_SENSITIVE");
+    TEST(ps_contains_special(ps_scan(ps_pack_ex("a_", 2, PACKED_FLAG_CONTAINS_SPECIAL))),
+        "ps_scan finds '_'");
+    TEST(!ps_contains_digit(ps_pad_left(ps_pack("a"), ps_char('Z'), 4)),
+        "ps_pad_left('a', 'Z') has no CONTAINS_DIGIT");
+    TEST(ps_is_case_sensitive(ps_pad_left(ps_pack("a"), ps_char('Z'), 4)),
+        "ps_pad_left('a', 'Z') is CASE_SENSITIVE");
+    TEST(ps_starts_with(long_id, ps_pack("abcdefghijkL")), "ps_starts_with 12-char prefix");
+
+#ifdef PS_TEST_GUARD_PAGES
+    // ps_pack_n on strings touching unmapped pages on either side
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char* pages = mmap(NULL, 3 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages != MAP_FAILED) {
+        mprotect(pages, page, PROT_NONE);
+        mprotect(pages + 2 * page, page, PROT_NONE);
+        char* first = pages + page;
+        char* end = pages + 2 * page;
+        memset(first, 'x', page);
+
+        bool guarded = true;
+        for (u8 n = 0; n <= PACKED_STRING_MAX_LEN; n++) {
+            const PackedString want = ps_pack_ex("xxxxxxxxxxxxxxxxxxxx", n, 0);
+            guarded = guarded && ps_equal(ps_pack_n(end - n, n), want)
+                && ps_equal(ps_pack_n(first, n), want);
+        }
+        TEST(guarded, "ps_pack_n next to unmapped pages");
+        munmap(pages, 3 * page);
+    }
+#endif
+
     return failures;
 }
 
@@ -586,6 +1041,10 @@ int main() {
     failed += test_padding();
     failed += test_search();
     failed += test_hashing();
+    failed += test_dispatch();
+    failed += test_tokenizer();
+    failed += test_serialization();
+    failed += test_slab();
     failed += test_lock_unlock();
     failed += test_validation();
     failed += test_debugging();
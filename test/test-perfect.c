@@ -0,0 +1,224 @@
+/**
+ * @file test-perfect.c
+ * Test suite for the minimal perfect hash (hash-table/ps-perfect.h)
+ *
+ * Usage: test-perfect <keywords.txt>
+ *
+ * c_keywords.h is generated from the same keyword list by perfect-gen at
+ * build time, so both the emitted tables and psph_build are checked.
+ */
+#include "../packed16/packed-string.h"
+#include "../hash-table/ps-perfect.h"
+#include "c_keywords.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST(cond, msg) do \
+    { \
+        if (!(cond)) { \
+            printf("❌ FAIL: %s\n", msg); \
+            failures++; \
+        } else { \
+            printf("✅ OK: %s\n", msg); \
+        } \
+    } while(0)
+
+#define TEST_EQ(a, b, msg) TEST((a) == (b), msg)
+
+// Helper to print test section
+static void section(const char* name) {
+    printf( "\n═══════════════════════════════════════════════════\n"
+            "  %s"
+            "\n═══════════════════════════════════════════════════\n", name);
+}
+
+// Words that are not C keywords, some of them one character off
+static const char* const absent_words[] = {
+    "main", "Auto", "bool", "static_assert", "_Bool_", "integer", "whil", "x", "$",
+    "abcdefghijklmnopqrstu",
+};
+
+#define ABSENT_WORDS (sizeof(absent_words) / sizeof(absent_words[0]))
+
+// Keywords as perfect-gen reads them: one per line, blank lines skipped
+static size_t load_keywords(const char* path, ps_t* keys, const size_t cap) {
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return 0;
+    }
+
+    size_t n = 0;
+    char line[256];
+    while (n < cap && fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') keys[n++] = ps_pack(line);
+    }
+
+    fclose(in);
+    return n;
+}
+
+// Every key gets its own id, equal to its index, and nothing else hits
+static int check_map(const psph_map* m, const ps_t* keys, const size_t n,
+                     const ps_t* absent, const size_t absent_count) {
+    uint8_t* seen = calloc(n ? n : 1, 1);
+    size_t hits = 0, exact = 0, distinct = 0, misses = 0;
+
+    for (size_t i = 0; seen && i < n; i++) {
+        uint32_t id = UINT32_MAX;
+        if (!psph_get(m, keys[i], &id)) continue;
+
+        hits++;
+        if (id == i) exact++;
+        if (id < n && !seen[id]) {
+            seen[id] = 1;
+            distinct++;
+        }
+    }
+
+    for (size_t i = 0; i < absent_count; i++) {
+        uint32_t id = UINT32_MAX;
+        if (!psph_get(m, absent[i], &id) && !psph_contains(m, absent[i]) && id == UINT32_MAX)
+            misses++;
+    }
+
+    free(seen);
+    return hits == n && exact == n && distinct == n && misses == absent_count;
+}
+
+// ============================================================================
+// GENERATED HEADER TESTS
+// ============================================================================
+
+int test_generated(const ps_t* keys, const size_t n) {
+    section("Generated Header");
+    int failures = 0;
+
+    ps_t absent[ABSENT_WORDS];
+    for (size_t i = 0; i < ABSENT_WORDS; i++) absent[i] = ps_pack(absent_words[i]);
+
+    TEST_EQ(n, 44, "keyword list has the 44 C11 keywords");
+    TEST_EQ(c_keywords.capacity, n, "generated map holds every keyword");
+    TEST(check_map(&c_keywords, keys, n, absent, ABSENT_WORDS),
+         "generated map: every keyword hits its line, absent words miss");
+
+    uint32_t id = UINT32_MAX;
+    TEST(psph_get(&c_keywords, ps_pack("_Thread_local"), &id) && id == n - 1,
+         "psph_get(\"_Thread_local\") = last line");
+    TEST(!psph_contains(&c_keywords, PACKED_STRING_EMPTY), "empty string misses");
+
+    return failures;
+}
+
+// ============================================================================
+// RUNTIME BUILD TESTS
+// ============================================================================
+
+int test_build_keywords(const ps_t* keys, const size_t n) {
+    section("Build Over Keywords");
+    int failures = 0;
+
+    ps_t absent[ABSENT_WORDS];
+    for (size_t i = 0; i < ABSENT_WORDS; i++) absent[i] = ps_pack(absent_words[i]);
+
+    psph_map m;
+    TEST(psph_build(&m, keys, n), "psph_build over the keyword list");
+    TEST_EQ(m.capacity, n, "capacity == n");
+    TEST(check_map(&m, keys, n, absent, ABSENT_WORDS),
+         "every keyword maps to a distinct id < n, absent words miss");
+    psph_free(&m);
+
+    // Smaller prefixes leave buckets empty or nearly so
+    int prefixes_ok = 1;
+    for (size_t k = 1; k <= n; k++) {
+        prefixes_ok &= psph_build(&m, keys, k);
+        prefixes_ok &= check_map(&m, keys, k, keys + k, n - k);
+        psph_free(&m);
+    }
+    TEST(prefixes_ok, "every prefix of the list builds, the rest of the list misses");
+
+    return failures;
+}
+
+int test_build_large() {
+    section("Build Over Generated Keys");
+    int failures = 0;
+
+    const size_t n = 20000;
+    ps_t* keys = malloc(n * sizeof(ps_t));
+    ps_t* absent = malloc(n * sizeof(ps_t));
+    TEST(keys && absent, "allocate keys");
+    if (!keys || !absent) {
+        free(keys);
+        free(absent);
+        return failures;
+    }
+
+    char buffer[32];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%zu", i * 7919);
+        keys[i] = ps_pack(buffer);
+        snprintf(buffer, sizeof(buffer), "key_%zu", i * 7919 + 1);
+        absent[i] = ps_pack(buffer);
+    }
+
+    psph_map m;
+    TEST(psph_build(&m, keys, n), "psph_build over 20000 keys");
+    TEST(check_map(&m, keys, n, absent, n), "20000 keys: distinct ids < n, 20000 absent keys miss");
+    psph_free(&m);
+
+    free(keys);
+    free(absent);
+    return failures;
+}
+
+int test_build_rejects() {
+    section("Degenerate Input");
+    int failures = 0;
+
+    const ps_t keys[] = { ps_pack("if"), ps_pack("else"), ps_pack("while"), ps_pack("else") };
+
+    psph_map m;
+    TEST(!psph_build(&m, keys, 4), "duplicate key makes psph_build fail");
+    TEST(m.keys == NULL && m.capacity == 0, "failed build leaves the map empty");
+    TEST(!psph_contains(&m, keys[0]), "failed build: lookups miss");
+
+    TEST(psph_build(&m, keys, 0), "empty set builds");
+    TEST(!psph_contains(&m, keys[0]), "empty set: lookups miss");
+    psph_free(&m);
+
+    return failures;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(const int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <keywords.txt>\n", argv[0]);
+        return 2;
+    }
+
+    ps_t keys[256];
+    const size_t n = load_keywords(argv[1], keys, 256);
+
+    int failed = 0;
+    failed += test_generated(keys, n);
+    failed += test_build_keywords(keys, n);
+    failed += test_build_large();
+    failed += test_build_rejects();
+
+    section("Summary");
+
+    if (failed == 0) {
+        printf("✅ All tests passed!\n");
+    } else {
+        printf("❌ %d test(s) failed\n", failed);
+    }
+
+    return failed > 0 ? 1 : 0;
+}
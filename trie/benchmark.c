@@ -0,0 +1,174 @@
+#include "../packed16/packed-string.h"
+#include "ps-trie.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Usage: benchmark [N] [Q]   (default 1000000 keys, 200 prefixes)
+//
+// Exits with 1 unless every key is found, the trie holds the distinct
+// keys, its prefix counts equal a scan of those keys, and each prefix
+// listing returns exactly the sorted keys that start with the prefix, in
+// order.
+
+static const char ALPHABET[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_$";
+
+// Identifier-like keys share a few common prefixes
+static const char* PREFIXES[] = {
+    "get", "set", "is", "has", "m_", "on", "to", "make", "new", "_", "", "", "", ""
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static ps_t random_identifier(void) {
+    char buffer[PACKED_STRING_MAX_LEN + 1];
+    const char* prefix = PREFIXES[rng() % (sizeof(PREFIXES) / sizeof(*PREFIXES))];
+    const size_t plen = strlen(prefix);
+    const size_t len = plen + rng() % (PACKED_STRING_MAX_LEN - plen) + 1;
+
+    memcpy(buffer, prefix, plen);
+    for (size_t i = plen; i < len; ++i)
+        buffer[i] = ALPHABET[10 + rng() % 54];
+    buffer[len] = '\0';
+
+    return ps_pack(buffer);
+}
+
+static int compare_keys(const void* a, const void* b) {
+    return ps_compare(*(const ps_t*)a, *(const ps_t*)b);
+}
+
+// Sorts keys and drops duplicates, returns how many are left
+static size_t dedupe(ps_t* keys, const size_t n) {
+    qsort(keys, n, sizeof(ps_t), compare_keys);
+
+    size_t distinct = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (distinct == 0 || !ps_equal(keys[distinct - 1], keys[i])) keys[distinct++] = keys[i];
+    return distinct;
+}
+
+int main(const int argc, char** argv) {
+    const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    const size_t q = argc > 2 ? strtoull(argv[2], NULL, 10) : 200;
+
+    ps_t* keys = malloc(n * sizeof(ps_t));
+    ps_t* prefixes = malloc(q * sizeof(ps_t));
+    if (!keys || !prefixes || n == 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = random_identifier();
+
+    for (size_t i = 0; i < q; ++i)
+        prefixes[i] = ps_trunc(keys[rng() % n], (uint8_t)(1 + rng() % 4));
+
+    printf("N = %zu, Q = %zu\n\n", n, q);
+
+    double t0, t1, t2, t3;
+    size_t trie_total = 0, scan_total = 0, hits = 0;
+    volatile uint64_t sink = 0;
+
+    pstrie trie;
+    pstrie_init(&trie, n);
+
+    t0 = now_seconds();
+    for (size_t i = 0; i < n; ++i)
+        pstrie_insert(&trie, keys[i]);
+    t1 = now_seconds();
+
+    for (size_t i = 0; i < n; ++i)
+        hits += pstrie_exact(&trie, keys[i]);
+    t2 = now_seconds();
+
+    for (size_t i = 0; i < q; ++i)
+        trie_total += pstrie_count_prefix(&trie, prefixes[i]);
+    t3 = now_seconds();
+
+    size_t listed = 0;
+    for (size_t i = 0; i < q; ++i) {
+        pstrie_iter it;
+        ps_t key;
+        pstrie_prefix_iter(&trie, prefixes[i], &it);
+        while (pstrie_next(&it, &key)) {
+            sink += key.lo;
+            listed++;
+        }
+    }
+    const double t4 = now_seconds();
+
+    printf("Bitmap trie (%zu keys, %zu nodes):\n", trie.size, trie.used);
+    printf("  Memory:        %.1f MB (%.1f B/key, raw array %.1f MB)\n",
+        (double)trie.used * sizeof(pstrie_node) / 1e6,
+        (double)trie.used * sizeof(pstrie_node) / (double)trie.size,
+        (double)n * sizeof(ps_t) / 1e6);
+    printf("  Insert:        %.1f ns/op\n", (t1 - t0) * 1e9 / (double)n);
+    printf("  Exact:         %.1f ns/op\n", (t2 - t1) * 1e9 / (double)n);
+    printf("  count_prefix:  %.1f ns/op\n", (t3 - t2) * 1e9 / (double)q);
+    printf("  prefix_iter:   %.1f ns/key (%zu keys)\n\n",
+        listed ? (t4 - t3) * 1e9 / (double)listed : 0.0, listed);
+
+    // =========================
+    // LINEAR SCAN
+    // =========================
+
+    // Over the distinct keys, as the trie holds them, so the counts must agree
+    const size_t distinct = dedupe(keys, n);
+
+    t0 = now_seconds();
+    for (size_t i = 0; i < q; ++i) {
+        for (size_t j = 0; j < distinct; ++j)
+            scan_total += ps_starts_with(keys[j], prefixes[i]);
+    }
+    t1 = now_seconds();
+
+    printf("ps_starts_with scan (%zu distinct keys):\n", distinct);
+    printf("  Memory:        %.1f MB\n", (double)distinct * sizeof(ps_t) / 1e6);
+    printf("  count_prefix:  %.1f ns/op\n\n", (t1 - t0) * 1e9 / (double)q);
+
+    // Listings walk the sorted keys: each match must be the next key listed
+    size_t misordered = 0;
+    for (size_t i = 0; i < q; ++i) {
+        pstrie_iter it;
+        ps_t key;
+        pstrie_prefix_iter(&trie, prefixes[i], &it);
+        for (size_t j = 0; j < distinct; ++j) {
+            if (ps_starts_with(keys[j], prefixes[i]) && !(pstrie_next(&it, &key) && ps_equal(key, keys[j])))
+                misordered++;
+        }
+        misordered += pstrie_next(&it, &key);   // listed a key the scan did not
+    }
+
+    printf("Exact hits: %zu of %zu\n", hits, n);
+    printf("Prefix matches: trie %zu, scan %zu, listed %zu (%zu out of order)\n",
+        trie_total, scan_total, listed, misordered);
+
+    const size_t trie_size = trie.size;
+
+    pstrie_free(&trie);
+    free(keys);
+    free(prefixes);
+
+    const bool ok = hits == n && trie_size == distinct && trie_total == scan_total && listed == trie_total
+        && misordered == 0;
+    if (!ok) fprintf(stderr, "trie and scan disagree\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+#ifndef PACKED_STRING_PS_TRIE_H
+#define PACKED_STRING_PS_TRIE_H
+
+#include "../packed16/packed-string.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Bitmap trie keyed on sixbit characters.
+//
+// The alphabet has exactly 64 symbols, so a node is a 64-bit presence
+// bitmap plus the index of its first child: children of a node are
+// stored contiguously in sixbit order and child c sits at
+// popcount(bitmap & ((1 << c) - 1)). Each node also counts the keys
+// ending at or below it, so count_prefix is one walk down the prefix.
+
+#define PSTRIE_NONE UINT32_MAX
+
+typedef struct {
+  uint64_t bitmap;        // bit c set = child for sixbit c
+  uint32_t children;      // index of the lowest child
+  uint32_t count : 31;    // keys ending at or below this node
+  uint32_t terminal : 1;  // a key ends here
+} pstrie_node;
+
+typedef struct {
+  pstrie_node* nodes;     // root is nodes[0]
+  size_t   used;          // nodes handed out, including freed blocks
+  size_t   capacity;
+  size_t   size;          // keys stored
+  uint32_t free_blocks[65];  // size -> first freed children block
+} pstrie;
+
+typedef struct {
+  const pstrie* t;
+  uint64_t lo, hi;               // current path
+  uint32_t node[PACKED_STRING_MAX_LEN + 1];
+  uint64_t pending[PACKED_STRING_MAX_LEN + 1];  // children not yet visited
+  uint8_t  flags[PACKED_STRING_MAX_LEN + 1];
+  uint8_t  depth;
+  uint8_t  base;                 // prefix length
+  bool     enter;                // next step enters node[depth]
+  bool     done;
+} pstrie_iter;
+
+static inline uint32_t pstrie_popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (uint32_t)__builtin_popcountll(x);
+#else
+  x = x - (x >> 1 & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + (x >> 2 & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (uint32_t)(x * 0x0101010101010101ULL >> 56);
+#endif
+}
+
+static inline void pstrie_put(uint64_t* lo, uint64_t* hi, const uint8_t i, const uint64_t c) {
+  if (i < 10) {
+    *lo = (*lo & ~(0x3FULL << (i * 6))) | c << (i * 6);
+  } else if (i == 10) {
+    *lo = (*lo & ~(0xFULL << 60)) | (c & 0xF) << 60;
+    *hi = (*hi & ~0x3ULL) | c >> 4;
+  } else {
+    const uint8_t shift = (i - 11) * 6 + 2;
+    *hi = (*hi & ~(0x3FULL << shift)) | c << shift;
+  }
+}
+
+static inline uint8_t pstrie_class(const uint8_t c) {
+  if (c <= 9) return PACKED_FLAG_CONTAINS_DIGIT;
+  if (36 <= c && c <= 61) return PACKED_FLAG_CASE_SENSITIVE;
+  if (c >= 62) return PACKED_FLAG_CONTAINS_SPECIAL;
+  return 0;
+}
+
+static inline bool pstrie_init(pstrie* t, const size_t capacity) {
+  t->capacity = capacity < 16 ? 16 : capacity;
+  t->nodes = malloc(t->capacity * sizeof(pstrie_node));
+  if (!t->nodes) return false;
+
+  memset(&t->nodes[0], 0, sizeof(pstrie_node));
+  t->used = 1;
+  t->size = 0;
+  for (int i = 0; i <= 64; i++) t->free_blocks[i] = PSTRIE_NONE;
+  return true;
+}
+
+static inline void pstrie_free(pstrie* t) {
+  free(t->nodes);
+  t->nodes = NULL;
+  t->used = 0;
+  t->capacity = 0;
+  t->size = 0;
+}
+
+static inline void pstrie_clear(pstrie* t) {
+  memset(&t->nodes[0], 0, sizeof(pstrie_node));
+  t->used = 1;
+  t->size = 0;
+  for (int i = 0; i <= 64; i++) t->free_blocks[i] = PSTRIE_NONE;
+}
+
+// Bytes held by the node pool
+static inline size_t pstrie_memory(const pstrie* t) {
+  return t->capacity * sizeof(pstrie_node);
+}
+
+// Block of n consecutive nodes, reusing a freed block of that size first
+static inline uint32_t pstrie_alloc_block(pstrie* t, const uint32_t n) {
+  const uint32_t freed = t->free_blocks[n];
+  if (freed != PSTRIE_NONE) {
+    t->free_blocks[n] = t->nodes[freed].children;
+    return freed;
+  }
+
+  if (t->used + n > t->capacity) {
+    size_t cap = t->capacity * 2;
+    while (t->used + n > cap) cap *= 2;
+    if (cap >= PSTRIE_NONE) return PSTRIE_NONE;
+
+    pstrie_node* nodes = realloc(t->nodes, cap * sizeof(pstrie_node));
+    if (!nodes) return PSTRIE_NONE;
+
+    t->nodes = nodes;
+    t->capacity = cap;
+  }
+
+  const uint32_t block = (uint32_t)t->used;
+  t->used += n;
+  return block;
+}
+
+static inline void pstrie_free_block(pstrie* t, const uint32_t block, const uint32_t n) {
+  t->nodes[block].children = t->free_blocks[n];
+  t->free_blocks[n] = block;
+}
+
+// Index of child c of node, PSTRIE_NONE if absent
+static inline uint32_t pstrie_child(const pstrie* t, const uint32_t node, const uint8_t c) {
+  const pstrie_node* n = &t->nodes[node];
+  if (!(n->bitmap >> c & 1)) return PSTRIE_NONE;
+
+  return n->children + pstrie_popcount(n->bitmap & ((1ULL << c) - 1));
+}
+
+// Node reached by walking all chars of key, PSTRIE_NONE if it does not exist
+static inline uint32_t pstrie_walk(const pstrie* t, const ps_t key) {
+  const uint8_t len = ps_length(key);
+  uint32_t node = 0;
+
+  for (uint8_t i = 0; i < len && node != PSTRIE_NONE; i++)
+    node = pstrie_child(t, node, ps_sixbit_at(key, i));
+
+  return node;
+}
+
+static inline bool pstrie_exact(const pstrie* t, const ps_t key) {
+  if (!ps_valid(key)) return false;
+
+  const uint32_t node = pstrie_walk(t, key);
+  return node != PSTRIE_NONE && t->nodes[node].terminal;
+}
+
+// Number of stored keys starting with prefix
+static inline size_t pstrie_count_prefix(const pstrie* t, const ps_t prefix) {
+  if (!ps_valid(prefix)) return 0;
+
+  const uint32_t node = pstrie_walk(t, prefix);
+  return node != PSTRIE_NONE ? t->nodes[node].count : 0;
+}
+
+// Add child c to node, returns the child or PSTRIE_NONE on allocation failure
+static inline uint32_t pstrie_add_child(pstrie* t, const uint32_t node, const uint8_t c) {
+  const uint64_t bitmap = t->nodes[node].bitmap;
+  const uint32_t size = pstrie_popcount(bitmap);
+  const uint32_t rank = pstrie_popcount(bitmap & ((1ULL << c) - 1));
+
+  const uint32_t block = pstrie_alloc_block(t, size + 1);
+  if (block == PSTRIE_NONE) return PSTRIE_NONE;
+
+  // t->nodes may have moved
+  pstrie_node* n = &t->nodes[node];
+  if (size > 0) {
+    memcpy(&t->nodes[block], &t->nodes[n->children], rank * sizeof(pstrie_node));
+    memcpy(&t->nodes[block + rank + 1], &t->nodes[n->children + rank],
+      (size - rank) * sizeof(pstrie_node));
+    pstrie_free_block(t, n->children, size);
+  }
+
+  memset(&t->nodes[block + rank], 0, sizeof(pstrie_node));
+  n->children = block;
+  n->bitmap |= 1ULL << c;
+  return block + rank;
+}
+
+// Insert key. Returns false on invalid key or allocation failure,
+// inserting an existing key is a no-op.
+static inline bool pstrie_insert(pstrie* t, const ps_t key) {
+  if (!ps_valid(key)) return false;
+  if (pstrie_exact(t, key)) return true;
+
+  const uint8_t len = ps_length(key);
+  uint32_t node = 0;
+
+  // Create the missing part of the path first so a failure leaves counts intact
+  for (uint8_t i = 0; i < len; i++) {
+    const uint8_t c = ps_sixbit_at(key, i);
+    uint32_t child = pstrie_child(t, node, c);
+
+    if (child == PSTRIE_NONE) {
+      child = pstrie_add_child(t, node, c);
+      if (child == PSTRIE_NONE) return false;
+    }
+    node = child;
+  }
+
+  t->nodes[node].terminal = 1;
+
+  node = 0;
+  t->nodes[0].count++;
+  for (uint8_t i = 0; i < len; i++) {
+    node = pstrie_child(t, node, ps_sixbit_at(key, i));
+    t->nodes[node].count++;
+  }
+
+  t->size++;
+  return true;
+}
+
+// Start enumerating keys with prefix in ps_compare order
+static inline bool pstrie_prefix_iter(const pstrie* t, const ps_t prefix, pstrie_iter* it) {
+  memset(it, 0, sizeof(*it));
+  it->t = t;
+  it->done = true;
+
+  if (!ps_valid(prefix)) return false;
+
+  const uint32_t node = pstrie_walk(t, prefix);
+  if (node == PSTRIE_NONE) return false;
+
+  const uint8_t len = ps_length(prefix);
+  uint8_t flags = 0;
+  for (uint8_t i = 0; i < len; i++) {
+    const uint8_t c = ps_sixbit_at(prefix, i);
+    pstrie_put(&it->lo, &it->hi, i, c);
+    flags |= pstrie_class(c);
+  }
+
+  it->depth = it->base = len;
+  it->node[len] = node;
+  it->pending[len] = t->nodes[node].bitmap;
+  it->flags[len] = flags;
+  it->enter = true;
+  it->done = false;
+  return true;
+}
+
+// Next key of the iteration, false when exhausted
+static inline bool pstrie_next(pstrie_iter* it, ps_t* out) {
+  while (!it->done) {
+    const uint8_t d = it->depth;
+    const pstrie_node* n = &it->t->nodes[it->node[d]];
+
+    if (it->enter) {
+      it->enter = false;
+      if (n->terminal) {
+        // Drop chars left over from a deeper path
+        const uint32_t bits = (uint32_t)d * 6;
+        uint64_t lo = it->lo, hi = it->hi;
+        if (bits < 64) {
+          lo &= (1ULL << bits) - 1;
+          hi = 0;
+        } else {
+          hi &= (1ULL << (bits - 64)) - 1;
+        }
+
+        *out = ps_make(lo, hi, d, it->flags[d]);
+        return true;
+      }
+    }
+
+    if (it->pending[d] == 0 || d == PACKED_STRING_MAX_LEN) {
+      if (d == it->base) it->done = true;
+      else it->depth--;
+      continue;
+    }
+
+    const uint8_t c = ps_ctz64(it->pending[d]);
+    it->pending[d] &= it->pending[d] - 1;
+
+    const uint32_t child = n->children + pstrie_popcount(n->bitmap & ((1ULL << c) - 1));
+    pstrie_put(&it->lo, &it->hi, d, c);
+
+    it->depth = d + 1;
+    it->node[d + 1] = child;
+    it->pending[d + 1] = it->t->nodes[child].bitmap;
+    it->flags[d + 1] = it->flags[d] | pstrie_class(c);
+    it->enter = true;
+  }
+
+  return false;
+}
+
+#endif // PACKED_STRING_PS_TRIE_H